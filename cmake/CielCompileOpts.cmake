@@ -11,8 +11,19 @@ else()
     add_compile_options(-Wall -Wextra -Wreturn-type -pedantic) # -Werror
 endif()
 
+# SIMD ray packet width (4, 8 or 16 lanes)
+set(CIEL_PACKET_WIDTH 8 CACHE STRING "Number of rays marched together in SIMD lanes")
+set_property(CACHE CIEL_PACKET_WIDTH PROPERTY STRINGS 4 8 16)
+add_compile_definitions(CIEL_PACKET_WIDTH=${CIEL_PACKET_WIDTH})
+
+# Microbenchmarks (src/bench)
+option(CIEL_BUILD_BENCH "Build the microbenchmarks" OFF)
+
 # OpenMP
 set (CIEL_BUILD_WITH_OMP 1)
 
+# GUI viewer (GLFW + OpenGL). Turn off for headless render nodes.
+option(CIEL_BUILD_WITH_GUI "Build the GLFW/OpenGL viewer app" ON)
+
 # ImGui
 set (CIEL_BUILD_WITH_IMGUI 1)
@@ -6,7 +6,16 @@ if (CIEL_BUILD_WITH_OMP)
 endif()
 
 # Core GUI
-find_library(COCOA_LIBRARY Cocoa REQUIRED)
-find_package(glfw3 3.3 REQUIRED FATAL_ERROR)
-find_library(IOKIT_LIBRARY IOKit REQUIRED)
-find_library(OPENGL_LIBRARY OpenGL REQUIRED)
+if (CIEL_BUILD_WITH_GUI)
+    find_package(glfw3 3.3 QUIET)
+    if (NOT glfw3_FOUND)
+        message(WARNING "glfw3 not found, only headless targets are built")
+        set(CIEL_BUILD_WITH_GUI OFF)
+    endif()
+endif()
+
+if (CIEL_BUILD_WITH_GUI AND APPLE)
+    find_library(COCOA_LIBRARY Cocoa REQUIRED)
+    find_library(IOKIT_LIBRARY IOKit REQUIRED)
+    find_library(OPENGL_LIBRARY OpenGL REQUIRED)
+endif()
@@ -0,0 +1,216 @@
+#include "asyncImageWriter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+namespace ciel {
+
+AsyncImageWriter::AsyncImageWriter()
+: m_thread(&AsyncImageWriter::ioLoop, this)
+{
+}
+
+AsyncImageWriter::~AsyncImageWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_ready.notify_one();
+    m_thread.join();
+}
+
+bool AsyncImageWriter::begin(const std::string& path,
+                             unsigned           width,
+                             unsigned           height)
+{
+    if (m_accepting) {
+        end();
+    }
+    const std::optional<ImageFormat> format = imageFormat(path);
+    if (!format) {
+        return false;
+    }
+    m_accepting = true;
+    m_width = width;
+    m_height = height;
+    Job job{Job::Begin};
+    job.path = path;
+    job.format = *format;
+    job.width = width;
+    job.height = height;
+    push(std::move(job));
+    return true;
+}
+
+void AsyncImageWriter::writeTile(const Tile&               tile,
+                                 const std::vector<float>& pixmap)
+{
+    if (!m_accepting || tile.x1 > m_width || tile.y1 > m_height ||
+        pixmap.size() < (size_t)m_width * m_height * 4) {
+        return;
+    }
+    Job job{Job::Pixels};
+    job.tile = tile;
+    job.pixels.resize((size_t)tile.pixelCount() * 4);
+    const size_t rowFloats = (size_t)tile.width() * 4;
+    for (unsigned j = tile.y0; j < tile.y1; j++) {
+        const float* row = &pixmap[((size_t)j * m_width + tile.x0) * 4];
+        std::copy(row,
+                  row + rowFloats,
+                  job.pixels.begin() + (j - tile.y0) * rowFloats);
+    }
+    push(std::move(job));
+}
+
+void AsyncImageWriter::end()
+{
+    if (!m_accepting) {
+        return;
+    }
+    m_accepting = false;
+    push(Job{Job::End});
+}
+
+bool AsyncImageWriter::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_queue.empty() && !m_busy; });
+    const bool failed = m_failed;
+    m_failed = false;
+    return !failed;
+}
+
+AsyncImageWriter::Stats AsyncImageWriter::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void AsyncImageWriter::push(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(job));
+    }
+    m_ready.notify_one();
+}
+
+void AsyncImageWriter::ioLoop()
+{
+    using Clock = std::chrono::steady_clock;
+    using Seconds = std::chrono::duration<double>;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_ready.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if (m_queue.empty()) {
+            break; // m_stop with nothing left
+        }
+        const Job job = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_busy = true;
+        lock.unlock();
+
+        const auto startTime = Clock::now();
+        switch (job.kind) {
+        case Job::Begin:
+            open(job);
+            break;
+        case Job::Pixels:
+            write(job);
+            break;
+        case Job::End:
+            close(true);
+            break;
+        }
+        const double seconds = Seconds(Clock::now() - startTime).count();
+
+        lock.lock();
+        m_busy = false;
+        m_stats.ioSeconds += seconds;
+        if (job.kind == Job::Pixels && m_layout) {
+            m_stats.tiles++;
+        }
+        if (m_queue.empty()) {
+            m_idle.notify_all();
+        }
+    }
+    lock.unlock();
+    // begun but never ended
+    close(false);
+}
+
+void AsyncImageWriter::open(const Job& job)
+{
+    close(false);
+    m_path = job.path;
+    m_file.open(m_path + ".tmp", std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+        std::cerr << "[ciel][io] Failed to open " << m_path << ".tmp"
+                  << std::endl;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_failed = true;
+        return;
+    }
+    m_layout.emplace(job.format, job.width, job.height);
+    m_row.resize((size_t)job.width * m_layout->pixelBytes());
+
+    // full size up front, tiles then land anywhere in it
+    m_file << m_layout->header();
+    if (m_layout->fileBytes() > m_layout->header().size()) {
+        m_file.seekp(m_layout->fileBytes() - 1);
+        m_file.put(0);
+    }
+}
+
+void AsyncImageWriter::write(const Job& job)
+{
+    if (!m_layout || !m_file) {
+        return;
+    }
+    const Tile&  tile = job.tile;
+    const size_t rowFloats = (size_t)tile.width() * 4;
+    for (unsigned j = tile.y0; j < tile.y1; j++) {
+        m_layout->encode(&job.pixels[(j - tile.y0) * rowFloats],
+                         tile.width(),
+                         m_row.data());
+        m_file.seekp(m_layout->offset(tile.x0, j));
+        m_file.write(m_row.data(), tile.width() * m_layout->pixelBytes());
+    }
+}
+
+void AsyncImageWriter::close(bool complete)
+{
+    if (!m_layout) {
+        return;
+    }
+    const std::string temporary = m_path + ".tmp";
+    const size_t      bytes = m_layout->fileBytes();
+    m_layout.reset();
+    m_file.close();
+    if (!complete) {
+        std::remove(temporary.c_str());
+        return;
+    }
+
+    const bool written = m_file &&
+                         std::rename(temporary.c_str(), m_path.c_str()) == 0;
+    if (!written) {
+        std::cerr << "[ciel][io] Failed to write " << m_path << std::endl;
+        std::remove(temporary.c_str());
+    }
+    m_file.clear();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (written) {
+        m_stats.images++;
+        m_stats.bytes += bytes;
+    }
+    else {
+        m_failed = true;
+    }
+}
+
+} // namespace ciel
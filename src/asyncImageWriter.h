@@ -0,0 +1,116 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Writes rendered images on a background I/O thread.
+//
+//  begin() starts an image file, writeTile() hands over the
+//  pixels of a finished tile, end() completes the image.
+//  The calls only queue work: each tile is encoded and
+//  written in place while the next ones render, so little
+//  of the disk time is left once the last tile is done.
+//  Images go to a temporary file renamed over the path at
+//  end(), so a file at the path is always complete.
+//
+//  Formats are those of imageIO.h (.pfm float, .ppm 8-bit).
+//
+// -------------------------------------------------------
+
+#include "imageIO.h"
+#include "tile.h"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ciel {
+
+class AsyncImageWriter
+{
+public:
+    struct Stats
+    {
+        size_t images{0};    // completed
+        size_t tiles{0};     // written
+        size_t bytes{0};     // of the image files
+        double ioSeconds{0}; // the I/O thread spent encoding and writing
+    };
+
+    AsyncImageWriter();
+    // Finishes what is queued. An image without end() is discarded.
+    ~AsyncImageWriter();
+
+    AsyncImageWriter(const AsyncImageWriter&) = delete;
+    AsyncImageWriter& operator=(const AsyncImageWriter&) = delete;
+
+    // Starts an image of width x height at `path`, ending the previous one
+    // if it was not. Returns false (and prints the reason) if the format is
+    // unknown, the tiles of the image are then ignored.
+    bool begin(const std::string& path, unsigned width, unsigned height);
+    // Queues the pixels of `tile` from `pixmap`, in the layout of Renderer,
+    // for the current image. Safe to call from several threads, e.g. as a
+    // Renderer tile callback.
+    void writeTile(const Tile& tile, const std::vector<float>& pixmap);
+    // Completes the current image once its tiles are written
+    void end();
+    // Blocks until everything queued is on disk. Returns false if an image
+    // since the last wait() failed to write.
+    bool wait();
+
+    Stats stats() const;
+
+private:
+    struct Job
+    {
+        enum Kind
+        {
+            Begin,
+            Pixels,
+            End
+        };
+
+        Kind               kind;
+        std::string        path{};                   // Begin
+        ImageFormat        format{ImageFormat::PFM}; // Begin
+        unsigned           width{0};                 // Begin
+        unsigned           height{0};                // Begin
+        Tile               tile{};                   // Pixels
+        std::vector<float> pixels{};                 // Pixels, RGBA by row
+    };
+
+    void push(Job job);
+    void ioLoop();
+    // run on the I/O thread
+    void open(const Job& job);
+    void write(const Job& job);
+    void close(bool complete);
+
+    // the image being queued, as of the producer side
+    bool     m_accepting{false};
+    unsigned m_width{0};
+    unsigned m_height{0};
+
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_ready; // a job was queued or m_stop set
+    std::condition_variable m_idle;  // the queue ran empty
+    std::deque<Job>         m_queue;
+    bool                    m_busy{false}; // the I/O thread is on a job
+    bool                    m_stop{false};
+    bool                    m_failed{false};
+    Stats                   m_stats;
+
+    // the image being written, touched by the I/O thread only
+    std::ofstream              m_file;
+    std::string                m_path;
+    std::optional<ImageLayout> m_layout;
+    std::vector<char>          m_row;
+
+    std::thread m_thread;
+};
+
+} // namespace ciel
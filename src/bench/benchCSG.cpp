@@ -0,0 +1,134 @@
+// -------------------------------------------------------
+//
+//  Microbenchmark of the ways a CSG tree can be evaluated:
+//  the dynamic shared_ptr tree (eval and evalBatch), the
+//  compiled VolumeProgram, and the compile-time csg:: tree
+//  (inline, and wrapped as a VolumeScalar).
+//
+// -------------------------------------------------------
+
+#include "bench/benchUtil.h"
+#include "volume/staticCSG.h"
+#include "volume/volumeProgram.h"
+#include "volume/volumeScalarCSG.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace ciel;
+using namespace ciel::bench;
+
+namespace {
+
+constexpr size_t kCount = 1 << 16; // points per run
+constexpr int    kRepeats = 20;
+
+float randomFloat() { return (float)std::rand() / RAND_MAX * 3.f - 1.5f; }
+
+// Union(Sphere, Cutout(Box, Torus)), shelled and intersected with an
+// ellipse, built both ways from the same parameters
+const Vector kSphereCenter(-0.5, 0, 0);
+const Vector kBoxCenter(0.5, 0, 0);
+const Vector kBoxBound(0.5, 0.5, 0.5);
+const Vector kTorusNormal(0, 1, 0);
+const Vector kEllipseStretch(0, 0, 1);
+
+VolumeScalar::Ptr makeDynamic()
+{
+    VolumeScalar::Ptr sphere = VolumeScalarSphere::create(kSphereCenter, 0.5);
+    VolumeScalar::Ptr box = VolumeScalarBox::create(kBoxCenter, kBoxBound, 0.1);
+    VolumeScalar::Ptr torus = VolumeScalarTorus::create(
+        kBoxCenter, kTorusNormal, 0.4, 0.15);
+    VolumeScalar::Ptr ellipse = VolumeScalarEllipse::create(
+        Vector(0, 0, 0), kEllipseStretch, 1.2, 0.8);
+    VolumeScalar::Ptr cutout = std::make_shared<VolumeScalarCutout>(box, torus);
+    VolumeScalar::Ptr shape = std::make_shared<VolumeScalarUnion>(sphere,
+                                                                  cutout);
+    VolumeScalar::Ptr shell = std::make_shared<VolumeScalarShell>(shape, 0.2);
+    return std::make_shared<VolumeScalarIntersection>(shell, ellipse);
+}
+
+auto makeStatic()
+{
+    return csg::Intersection(
+        csg::Shell(csg::Union(csg::Sphere(kSphereCenter, 0.5f),
+                              csg::Cutout(csg::Box(kBoxCenter, kBoxBound, 0.1f),
+                                          csg::Torus(kBoxCenter,
+                                                     kTorusNormal,
+                                                     0.4f,
+                                                     0.15f))),
+                   0.2f),
+        csg::Ellipse(Vector(0, 0, 0), kEllipseStretch, 1.2f, 0.8f));
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<Vector> points;
+    for (size_t i = 0; i < kCount; i++) {
+        points.emplace_back(randomFloat(), randomFloat(), randomFloat());
+    }
+    std::vector<float> reference(kCount), values(kCount);
+
+    const VolumeScalar::Ptr dynamicTree = makeDynamic();
+    const VolumeScalar::Ptr program = VolumeScalarProgram::create(dynamicTree);
+    const auto              staticTree = makeStatic();
+    const VolumeScalar::Ptr staticVolume = csg::makeVolume(staticTree);
+
+    for (size_t i = 0; i < kCount; i++) {
+        reference[i] = dynamicTree->eval(points[i]);
+    }
+    auto maxError = [&] {
+        float error = 0;
+        for (size_t i = 0; i < kCount; i++) {
+            error = std::max(error, std::abs(values[i] - reference[i]));
+        }
+        return error;
+    };
+
+    std::cout << "[ciel][bench] " << kCount << " points, best of " << kRepeats
+              << " runs, speedup against the dynamic tree's eval()\n";
+    printHeader("dynamic", "variant");
+
+    const double base = measure(kCount, kRepeats, [&] {
+        for (size_t i = 0; i < kCount; i++) {
+            values[i] = dynamicTree->eval(points[i]);
+        }
+        doNotOptimize(values.data());
+    });
+
+    auto row = [&](const char* name, auto&& f) {
+        const double ns = measure(kCount, kRepeats, f);
+        printRow(name, base, ns);
+        std::cout << "    max error " << std::scientific << maxError() << '\n';
+    };
+
+    row("dynamic evalBatch", [&] {
+        dynamicTree->evalBatch(points, values);
+        doNotOptimize(values.data());
+    });
+    row("program evalBatch", [&] {
+        program->evalBatch(points, values);
+        doNotOptimize(values.data());
+    });
+    row("static eval", [&] {
+        for (size_t i = 0; i < kCount; i++) {
+            values[i] = staticTree.eval(points[i]);
+        }
+        doNotOptimize(values.data());
+    });
+    row("static as VolumeScalar", [&] {
+        for (size_t i = 0; i < kCount; i++) {
+            values[i] = staticVolume->eval(points[i]);
+        }
+        doNotOptimize(values.data());
+    });
+    row("static evalBatch", [&] {
+        staticVolume->evalBatch(points, values);
+        doNotOptimize(values.data());
+    });
+
+    return EXIT_SUCCESS;
+}
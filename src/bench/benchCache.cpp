@@ -0,0 +1,99 @@
+// -------------------------------------------------------
+//
+//  Microbenchmark of the volume cache: baking a noise volume
+//  into a dense grid against writing it out and mapping it
+//  back in, then sampling the mapped grid against the one
+//  in memory. Pass the cache file path as the argument.
+//
+// -------------------------------------------------------
+
+#include "bench/benchUtil.h"
+#include "volume/volumeScalarMappedGrid.h"
+#include "volume/volumeScalarNoise.h"
+#include "volume/volumeScalarSphere.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace ciel;
+using namespace ciel::bench;
+
+namespace {
+
+constexpr unsigned kResolution = 256;
+constexpr size_t   kCount = 1 << 16; // sample points
+constexpr int      kRepeats = 10;
+
+float randomFloat() { return (float)std::rand() / RAND_MAX * 2.6f - 1.3f; }
+
+// Milliseconds taken by f()
+template<typename F>
+double milliseconds(F&& f)
+{
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::string path = argc > 1 ? argv[1] : "ciel_bench.cvol";
+
+    NoiseParams params;
+    params.frequency = 3;
+    params.octaves = 5;
+    const VolumeScalar::Ptr source = VolumeScalarNoise::createPyroclastic(
+        VolumeScalarSphere::create(Vector(0), 1), 0.3f, params);
+
+    VolumeScalarGrid::Ptr       grid;
+    VolumeScalarMappedGrid::Ptr mapped;
+    const double bake = milliseconds(
+        [&] { grid = VolumeScalarGrid::bake(source, kResolution); });
+    const double write = milliseconds([&] {
+        if (!VolumeScalarMappedGrid::write(path, *grid, source->hash())) {
+            std::exit(EXIT_FAILURE);
+        }
+    });
+    const double open = milliseconds(
+        [&] { mapped = VolumeScalarMappedGrid::open(path); });
+    if (!mapped) {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Vector> points;
+    for (size_t i = 0; i < kCount; i++) {
+        points.emplace_back(randomFloat(), randomFloat(), randomFloat());
+    }
+    std::vector<float> values(kCount);
+    // the first pass over the mapping faults its pages in
+    const double firstTouch = milliseconds(
+        [&] { mapped->evalBatch(points, values); });
+
+    std::cout << "[ciel][bench] " << kResolution << "^3 pyroclastic, "
+              << mapped->mappedBytes() / (1 << 20) << " MiB\n"
+              << std::fixed << std::setprecision(2) << "bake " << bake
+              << " ms, write " << write << " ms, open " << open
+              << " ms, first " << kCount << " samples " << firstTouch
+              << " ms\n";
+    printHeader("in memory", "mapped");
+    const double inMemory = measure(kCount, kRepeats, [&] {
+        grid->evalBatch(points, values);
+        doNotOptimize(values.data());
+    });
+    const double inMapping = measure(kCount, kRepeats, [&] {
+        mapped->evalBatch(points, values);
+        doNotOptimize(values.data());
+    });
+    printRow("evalBatch", inMemory, inMapping);
+
+    mapped.reset();
+    std::remove(path.c_str());
+    return EXIT_SUCCESS;
+}
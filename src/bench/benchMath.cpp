@@ -0,0 +1,178 @@
+// -------------------------------------------------------
+//
+//  Microbenchmark of the SoA packet types (VectorP, ColorP)
+//  against the scalar AoS Vector and Color on the same
+//  data, reported in nanoseconds per vector.
+//
+// -------------------------------------------------------
+
+#include "bench/benchUtil.h"
+#include "math/color.h"
+#include "math/colorN.h"
+#include "math/vector.h"
+#include "math/vectorN.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace ciel;
+using namespace ciel::bench;
+
+namespace {
+
+constexpr size_t kCount = 1 << 16; // vectors per run
+constexpr int    kRepeats = 50;
+
+float randomFloat() { return (float)std::rand() / RAND_MAX * 2.f - 1.f; }
+
+struct Data
+{
+    std::vector<Vector>  a, b;
+    std::vector<VectorP> pa, pb;
+    std::vector<Color>   c;
+    std::vector<ColorP>  pc;
+    std::vector<float>   w;
+    std::vector<FloatP>  pw;
+};
+
+Data makeData()
+{
+    Data d;
+    for (size_t i = 0; i < kCount; i++) {
+        d.a.emplace_back(randomFloat(), randomFloat(), randomFloat());
+        d.b.emplace_back(randomFloat(), randomFloat(), randomFloat());
+        d.c.emplace_back(randomFloat(), randomFloat(), randomFloat(), 1.f);
+        d.w.push_back(randomFloat() * 0.5f + 0.5f);
+    }
+    // same values, kPacketWidth vectors per packet
+    for (size_t i = 0; i < kCount; i += kPacketWidth) {
+        VectorP pa, pb;
+        ColorP  pc;
+        FloatP  pw;
+        for (int l = 0; l < kPacketWidth; l++) {
+            pa.setLane(l, d.a[i + l]);
+            pb.setLane(l, d.b[i + l]);
+            pc.setLane(l, d.c[i + l]);
+            pw[l] = d.w[i + l];
+        }
+        d.pa.push_back(pa);
+        d.pb.push_back(pb);
+        d.pc.push_back(pc);
+        d.pw.push_back(pw);
+    }
+    return d;
+}
+
+} // namespace
+
+int main()
+{
+    const Data   d = makeData();
+    const size_t nPackets = d.pa.size();
+
+    // Every loop writes one result per element, so neither side is held up
+    // by a chain of dependent additions
+    std::vector<float>   out(kCount);
+    std::vector<FloatP>  pout(nPackets);
+    std::vector<Vector>  vout(kCount);
+    std::vector<VectorP> pvout(nPackets);
+
+    std::cout << "[ciel][bench] " << kCount << " vectors, packet width "
+              << kPacketWidth << ", best of " << kRepeats << " runs\n";
+    printHeader("Vector", "VectorP");
+
+    // dot product
+    printRow("dot",
+             measure(kCount,
+                     kRepeats,
+                     [&] {
+                         for (size_t i = 0; i < kCount; i++) {
+                             out[i] = d.a[i] * d.b[i];
+                         }
+                         doNotOptimize(out.data());
+                     }),
+             measure(kCount, kRepeats, [&] {
+                 for (size_t i = 0; i < nPackets; i++) {
+                     pout[i] = d.pa[i] * d.pb[i];
+                 }
+                 doNotOptimize(pout.data());
+             }));
+
+    // cross product and its length
+    printRow("cross + magnitude",
+             measure(kCount,
+                     kRepeats,
+                     [&] {
+                         for (size_t i = 0; i < kCount; i++) {
+                             out[i] = (d.a[i] ^ d.b[i]).magnitude();
+                         }
+                         doNotOptimize(out.data());
+                     }),
+             measure(kCount, kRepeats, [&] {
+                 for (size_t i = 0; i < nPackets; i++) {
+                     pout[i] = (d.pa[i] ^ d.pb[i]).magnitude();
+                 }
+                 doNotOptimize(pout.data());
+             }));
+
+    // normalize
+    printRow("unitvector",
+             measure(kCount,
+                     kRepeats,
+                     [&] {
+                         for (size_t i = 0; i < kCount; i++) {
+                             vout[i] = d.a[i].unitvector();
+                         }
+                         doNotOptimize(vout.data());
+                     }),
+             measure(kCount, kRepeats, [&] {
+                 for (size_t i = 0; i < nPackets; i++) {
+                     pvout[i] = d.pa[i].unitvector();
+                 }
+                 doNotOptimize(pvout.data());
+             }));
+
+    // abs / min / max, the box kernel's building blocks
+    printRow("abs, min, max",
+             measure(kCount,
+                     kRepeats,
+                     [&] {
+                         for (size_t i = 0; i < kCount; i++) {
+                             vout[i] = max(min(abs(d.a[i] - d.b[i]), 0.5f),
+                                           0.1f);
+                         }
+                         doNotOptimize(vout.data());
+                     }),
+             measure(kCount, kRepeats, [&] {
+                 for (size_t i = 0; i < nPackets; i++) {
+                     pvout[i] = max(min(abs(d.pa[i] - d.pb[i]), 0.5f), 0.1f);
+                 }
+                 doNotOptimize(pvout.data());
+             }));
+
+    // the compositing step of the ray marcher, one ray per element
+    std::vector<Color>  L(kCount, Color(0, 0, 0, 1));
+    std::vector<ColorP> pL(nPackets, ColorP(Color(0, 0, 0, 1)));
+    std::fill(out.begin(), out.end(), 1.f);
+    std::fill(pout.begin(), pout.end(), FloatP(1.f));
+    printRow("composite",
+             measure(kCount,
+                     kRepeats,
+                     [&] {
+                         for (size_t i = 0; i < kCount; i++) {
+                             L[i] += d.c[i] * (1 - d.w[i]) * out[i];
+                             out[i] *= d.w[i];
+                         }
+                         doNotOptimize(L.data());
+                     }),
+             measure(kCount, kRepeats, [&] {
+                 for (size_t i = 0; i < nPackets; i++) {
+                     pL[i] += d.pc[i] * ((1.f - d.pw[i]) * pout[i]);
+                     pout[i] *= d.pw[i];
+                 }
+                 doNotOptimize(pL.data());
+             }));
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+// -------------------------------------------------------
+//
+//  Microbenchmark of the noise volumes: fBm and pyroclastic
+//  displacement of a sphere, point by point against a batch
+//  at a time, and the grid bake that caches them.
+//
+// -------------------------------------------------------
+
+#include "bench/benchUtil.h"
+#include "volume/volumeScalarGrid.h"
+#include "volume/volumeScalarNoise.h"
+#include "volume/volumeScalarSphere.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace ciel;
+using namespace ciel::bench;
+
+namespace {
+
+constexpr size_t   kCount = 1 << 16; // points per run
+constexpr int      kRepeats = 20;
+constexpr unsigned kBakeResolution = 128;
+
+float randomFloat() { return (float)std::rand() / RAND_MAX * 3.f - 1.5f; }
+
+} // namespace
+
+int main()
+{
+    std::vector<Vector> points;
+    for (size_t i = 0; i < kCount; i++) {
+        points.emplace_back(randomFloat(), randomFloat(), randomFloat());
+    }
+    std::vector<float> reference(kCount), values(kCount);
+
+    NoiseParams params;
+    params.frequency = 3;
+    params.octaves = 5;
+    params.seed = 7;
+    const VolumeScalar::Ptr sphere = VolumeScalarSphere::create(Vector(0), 1);
+    const VolumeScalar::Ptr volumes[] = {
+        VolumeScalarNoise::createFBm(sphere, 0.3f, params),
+        VolumeScalarNoise::createPyroclastic(sphere, 0.3f, params)};
+    const char* names[] = {"fbm", "pyroclastic"};
+
+    std::cout << "[ciel][bench] " << kCount << " points, " << params.octaves
+              << " octaves, best of " << kRepeats
+              << " runs, speedup of evalBatch() against eval()\n";
+    printHeader("eval", "evalBatch");
+
+    for (int v = 0; v < 2; v++) {
+        const VolumeScalar::Ptr& volume = volumes[v];
+        for (size_t i = 0; i < kCount; i++) {
+            reference[i] = volume->eval(points[i]);
+        }
+
+        const double scalar = measure(kCount, kRepeats, [&] {
+            for (size_t i = 0; i < kCount; i++) {
+                values[i] = volume->eval(points[i]);
+            }
+            doNotOptimize(values.data());
+        });
+        const double batch = measure(kCount, kRepeats, [&] {
+            volume->evalBatch(points, values);
+            doNotOptimize(values.data());
+        });
+        printRow(names[v], scalar, batch);
+
+        float error = 0;
+        for (size_t i = 0; i < kCount; i++) {
+            error = std::max(error, std::abs(values[i] - reference[i]));
+        }
+        std::cout << "    max error " << std::scientific << error << '\n';
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const auto                  start = Clock::now();
+    const VolumeScalar::Ptr     grid = VolumeScalarGrid::bake(volumes[1],
+                                                          kBakeResolution);
+    const std::chrono::duration<double, std::milli> elapsed = Clock::now() -
+                                                              start;
+    std::cout << std::fixed << std::setprecision(1) << "[ciel][bench] bake "
+              << kBakeResolution << "^3 pyroclastic in " << elapsed.count()
+              << " ms\n";
+    doNotOptimize(grid.get());
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+// -------------------------------------------------------
+//
+//  Microbenchmark of the out-of-core brick cache: a noise
+//  volume written to a brick file, then marched along rays
+//  through the paged grid with shrinking cache budgets,
+//  with and without prefetching. Pass the brick file path
+//  as the argument.
+//
+// -------------------------------------------------------
+
+#include "bench/benchUtil.h"
+#include "volume/volumeScalarGrid.h"
+#include "volume/volumeScalarNoise.h"
+#include "volume/volumeScalarPagedGrid.h"
+#include "volume/volumeScalarSphere.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace ciel;
+using namespace ciel::bench;
+
+namespace {
+
+constexpr unsigned kResolution = 256;
+constexpr int      kRays = 4096;
+constexpr int      kSteps = 512;
+
+// Rays through the volume from a ring of camera positions, in a fixed order
+struct Ray
+{
+    Vector origin, direction;
+};
+std::vector<Ray> makeRays()
+{
+    std::vector<Ray> rays;
+    for (int r = 0; r < kRays; r++) {
+        const float  angle = 6.2831853f * (r / 64) / (kRays / 64);
+        const float  offset = (r % 64) / 32.f - 1;
+        const Vector origin(3 * std::cos(angle), offset, 3 * std::sin(angle));
+        const Vector target(0, offset * 0.5f, 0);
+        rays.push_back(Ray{origin, (target - origin).unitvector()});
+    }
+    return rays;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::string path = argc > 1 ? argv[1] : "ciel_bench.cbrk";
+
+    NoiseParams params;
+    params.frequency = 3;
+    params.octaves = 5;
+    const VolumeScalar::Ptr source = VolumeScalarNoise::createPyroclastic(
+        VolumeScalarSphere::create(Vector(0), 1), 0.3f, params);
+    const GridLayout layout = GridLayout::fromResolution(source->bound(),
+                                                         kResolution);
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    if (!VolumeScalarPagedGrid::write(path, *source, layout, source->hash())) {
+        return EXIT_FAILURE;
+    }
+    const double writeSeconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    // the paged grid samples the same nodes as a dense bake
+    const VolumeScalarGrid::Ptr dense = VolumeScalarGrid::bake(source, layout);
+    const std::vector<Ray>      rays = makeRays();
+    auto march = [&](const VolumeScalar& volume, bool prefetch) {
+        const auto* paged = dynamic_cast<const VolumeScalarPagedGrid*>(
+            &volume);
+        double sum = 0;
+        for (const Ray& ray : rays) {
+            if (prefetch && paged) {
+                paged->prefetch(ray.origin, ray.direction, 1, 5);
+            }
+            for (int s = 0; s < kSteps; s++) {
+                sum += volume.eval(ray.origin +
+                                   (1 + 4.f * s / kSteps) * ray.direction);
+            }
+        }
+        return sum;
+    };
+    const double reference = march(*dense, false);
+
+    auto probe = VolumeScalarPagedGrid::open(path, SIZE_MAX);
+    if (!probe) {
+        return EXIT_FAILURE;
+    }
+    const size_t bricks = probe->brickCount();
+    probe.reset();
+    std::cout << "[ciel][bench] " << kResolution << "^3 pyroclastic, "
+              << bricks << " bricks of "
+              << VolumeScalarPagedGrid::kBrickBytes / 1024
+              << " KiB, written in " << std::fixed << std::setprecision(2)
+              << writeSeconds << " s\n"
+              << kRays << " rays of " << kSteps << " steps\n";
+    std::cout << std::left << std::setw(16) << "budget" << std::setw(10)
+              << "prefetch" << std::right << std::setw(10) << "ns/step"
+              << std::setw(10) << "hits" << std::setw(10) << "misses"
+              << std::setw(12) << "prefetched" << std::setw(12)
+              << "evictions" << std::setw(10) << "MiB read" << '\n';
+
+    const double samples = (double)kRays * kSteps;
+    for (const size_t budgetMiB : {1024, 16, 4, 1}) {
+        for (const bool prefetch : {false, true}) {
+            auto paged = VolumeScalarPagedGrid::open(path, budgetMiB << 20);
+            double     sum = 0;
+            const auto t0 = Clock::now();
+            sum = march(*paged, prefetch);
+            const double ns =
+                std::chrono::duration<double, std::nano>(Clock::now() - t0)
+                    .count() /
+                samples;
+            if (sum != reference) {
+                std::cerr << "[ciel][bench] Paged samples differ from the "
+                             "dense grid\n";
+                return EXIT_FAILURE;
+            }
+            const VolumeScalarPagedGrid::CacheStats stats = paged->stats();
+            std::cout << std::left << std::setw(16)
+                      << (std::to_string(budgetMiB) + " MiB") << std::setw(10)
+                      << (prefetch ? "on" : "off") << std::right
+                      << std::setw(10) << std::setprecision(1) << ns
+                      << std::setw(10) << stats.hits << std::setw(10)
+                      << stats.misses << std::setw(12) << stats.prefetched
+                      << std::setw(12) << stats.evictions << std::setw(10)
+                      << stats.bytesRead / (1 << 20) << '\n';
+        }
+    }
+
+    std::remove(path.c_str());
+    return EXIT_SUCCESS;
+}
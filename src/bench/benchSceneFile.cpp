@@ -0,0 +1,91 @@
+// -------------------------------------------------------
+//
+//  Microbenchmark of the scene file loader: a generated
+//  scene of transformed primitives joined by unions, with
+//  every other primitive written out twice so the loader
+//  has duplicates to merge. Pass the primitive count as the
+//  argument.
+//
+// -------------------------------------------------------
+
+#include "bench/benchUtil.h"
+#include "sceneFile.h"
+
+#include <cstdlib>
+#include <string>
+
+using namespace ciel;
+using namespace ciel::bench;
+
+namespace {
+
+constexpr size_t kDefaultCount = 25000; // 4 lines each, ~100k nodes
+constexpr size_t kUnionWidth = 64;      // children per union line
+constexpr int    kRepeats = 5;
+
+// Appends all arguments to `text`
+template<typename... Args>
+void append(std::string& text, const Args&... args)
+{
+    (text.append(args), ...);
+}
+
+std::string generate(size_t count)
+{
+    std::string text;
+    text.reserve(count * 96);
+    for (size_t i = 0; i < count; i++) {
+        // odd primitives repeat the even one before them
+        const size_t      p = i & ~size_t(1);
+        const std::string n = std::to_string(i);
+        const std::string offset = std::to_string(p % 97 * 0.01f);
+        append(text, "s", n, " = sphere 0 0 0 0.", std::to_string(p % 9 + 1));
+        append(text, "\nt", n, " = translate s", n, " ", offset, " 0.5 -");
+        append(text, offset, "\nr", n, " = rotate t", n, " 0 1 1 ");
+        append(text, std::to_string(p % 360), "\nm", n, " = scale r", n);
+        append(text, " 1.5\n");
+    }
+    // unions of kUnionWidth (at least two children each), then one of those
+    std::string all = "all = union";
+    for (size_t first = 0; first < count; first += kUnionWidth) {
+        std::string u = "u";
+        u += std::to_string(first);
+        append(text, u, " = union m", std::to_string(first));
+        const size_t end = std::min(count, first + kUnionWidth);
+        for (size_t i = std::min(first + 1, end - 1); i < end; i++) {
+            append(text, " m", std::to_string(i));
+        }
+        append(text, "\n");
+        append(all, " ", u);
+    }
+    append(text, all, count > kUnionWidth ? "\n" : " u0\n", "volume all\n");
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t      count = argc > 1 ? std::stoull(argv[1]) : kDefaultCount;
+    const std::string text = generate(count);
+    size_t            lines = 0;
+    for (char c : text) {
+        lines += c == '\n';
+    }
+
+    SceneFile::Ptr scene;
+    const double   seconds = measure(1, kRepeats, [&] {
+        scene = SceneFile::parse(text, "<bench>");
+    }) * 1e-9;
+
+    std::cout << "[ciel][bench] " << lines << " lines, "
+              << text.size() / 1024 << " KiB, best of " << kRepeats
+              << " runs\n"
+              << std::fixed << std::setprecision(2) << "parse "
+              << seconds * 1e3 << " ms (" << seconds * 1e9 / lines
+              << " ns/line, " << text.size() / seconds / (1 << 20)
+              << " MiB/s), " << scene->nodeCount << " nodes after "
+              << "deduplication\n";
+
+    return EXIT_SUCCESS;
+}
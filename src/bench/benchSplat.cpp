@@ -0,0 +1,74 @@
+// -------------------------------------------------------
+//
+//  Microbenchmark of particle splatting: a wisp of a given
+//  particle count splatted into a sparse grid, reported as
+//  throughput. Pass the particle count as the argument.
+//
+// -------------------------------------------------------
+
+#include "bench/benchUtil.h"
+#include "volume/volumeScalarWisp.h"
+
+#include <cstdlib>
+#include <string>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif // _OPENMP
+
+using namespace ciel;
+using namespace ciel::bench;
+
+namespace {
+
+constexpr size_t kDefaultCount = 10000000;
+constexpr float  kVoxelSize = 0.01f;
+constexpr int    kRepeats = 3;
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t count = argc > 1 ? std::stoull(argv[1]) : kDefaultCount;
+
+    Wisp wisp;
+    wisp.radius = 0.5;
+    wisp.count = count;
+    wisp.clump = 0.5;
+    wisp.displacement = 0.4;
+    wisp.noise.frequency = 2;
+    wisp.noise.octaves = 3;
+
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif // _OPENMP
+    std::cout << "[ciel][bench] " << count << " particles, " << threads
+              << " threads, best of " << kRepeats << " runs\n";
+
+    // generating alone, to tell it apart from the splat and merge
+    const double generate = measure(count, kRepeats, [&] {
+        Particle particles[1024];
+        for (size_t first = 0; first < count; first += 1024) {
+            const size_t n = std::min<size_t>(1024, count - first);
+            wisp.generate(first, std::span<Particle>(particles, n), kVoxelSize);
+            doNotOptimize(particles);
+        }
+    });
+
+    VolumeScalarWisp::Ptr volume;
+    const double          splat = measure(count, kRepeats, [&] {
+        volume = VolumeScalarWisp::create(wisp, kVoxelSize);
+        volume->splat();
+    });
+
+    const VolumeScalarSparseGrid& grid = *volume->grid();
+    std::cout << std::fixed << std::setprecision(2) << "generate "
+              << generate << " ns/particle, generate + splat + merge "
+              << splat << " ns/particle ("
+              << 1e3 / splat << "M particles/s)\n"
+              << "grid " << grid.tree().leafCount() << " bricks, "
+              << grid.memoryUsage() / (1 << 20) << " MiB\n";
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Minimal helpers for the microbenchmarks.
+//
+// -------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+
+namespace ciel::bench {
+
+// Keeps the compiler from optimizing a result away
+template<typename T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Best of `repeats` runs of f(), in nanoseconds per item
+template<typename F>
+double measure(size_t items, int repeats, F&& f)
+{
+    using Clock = std::chrono::steady_clock;
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repeats; r++) {
+        const auto start = Clock::now();
+        f();
+        const std::chrono::duration<double, std::nano> elapsed =
+            Clock::now() - start;
+        best = std::min(best, elapsed.count() / items);
+    }
+    return best;
+}
+
+inline void printHeader(const std::string& left, const std::string& right)
+{
+    std::cout << std::left << std::setw(24) << "benchmark" << std::right
+              << std::setw(14) << left << std::setw(14) << right
+              << std::setw(10) << "speedup" << '\n';
+}
+
+inline void printRow(const std::string& name, double left, double right)
+{
+    std::cout << std::left << std::setw(24) << name << std::right
+              << std::fixed << std::setprecision(3) << std::setw(11) << left
+              << " ns" << std::setw(11) << right << " ns" << std::setw(9)
+              << std::setprecision(2) << left / right << "x\n";
+}
+
+} // namespace ciel::bench
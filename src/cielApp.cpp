@@ -7,6 +7,7 @@
 //
 
 #include "cielApp.h"
+#include "textureStream.h"
 
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
@@ -40,13 +41,14 @@ void CielApp::init(int windowW, int windowH)
     initImGui();
     glfwSetWindowUserPointer(m_window, this);
 
-    m_renderer = std::make_unique<Renderer>();
+    m_renderThread = std::make_unique<RenderThread>(nullptr, true);
 
     // render setting
     m_renderSetting.renderW = windowW; // TODO: proportion to window size
     m_renderSetting.renderH = windowH; // TODO: proportion to window size
     m_renderSetting.rayDt = 0.01;
     m_renderSetting.expK = 0.02;
+    m_renderSetting.progressive = true;
 
     m_isInitialized = true;
 }
@@ -74,6 +76,10 @@ void keyCallback(
             setting.expK += 0.001;
             std::cout << "Change expK: " << setting.expK << std::endl;
         }
+        if (key == GLFW_KEY_P) {
+            setting.progressive = !setting.progressive;
+            std::cout << "Progressive: " << setting.progressive << std::endl;
+        }
 
         app->setRenderSetting(setting);
 
@@ -216,11 +222,9 @@ constexpr unsigned int indices[] = {
     3 // second triangle
 };
 
-void CielApp::createGLQuad(void*         textureData,
-                           unsigned int& outVBO,
+void CielApp::createGLQuad(unsigned int& outVBO,
                            unsigned int& outVAO,
-                           unsigned int& outEBO,
-                           unsigned int& outTextureID)
+                           unsigned int& outEBO)
 {
     glGenVertexArrays(1, &outVAO);
     glGenBuffers(1, &outVBO);
@@ -255,51 +259,18 @@ void CielApp::createGLQuad(void*         textureData,
                           8 * sizeof(float),
                           (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
-
-    glGenTextures(1, &outTextureID);
-    glBindTexture(GL_TEXTURE_2D, outTextureID);
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D,
-                    GL_TEXTURE_WRAP_S,
-                    GL_REPEAT); // set texture wrapping to GL_REPEAT (default
-                                // wrapping method)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    if (textureData) {
-        glTexImage2D(GL_TEXTURE_2D,
-                     0,
-                     GL_RGBA8,
-                     m_renderSetting.renderW,
-                     m_renderSetting.renderH,
-                     0,
-                     GL_RGBA,
-                     GL_FLOAT,
-                     textureData);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else {
-        std::cout << "[ciel][app] Failed to load texture" << std::endl;
-    }
 };
 
 void CielApp::mainLoop()
 {
-    // Execute render if needed
-    if (m_needRender) {
-        m_renderer->Render(m_renderSetting);
-        m_needRender = false;
-    }
-    std::vector<float> pixmap = m_renderer->getLastRender();
-
     // openGL stuff for displaying the render
     unsigned int shaderProgram;
     createGLShader(shaderProgram);
     unsigned int VBO, VAO, EBO;
-    unsigned int textureID;
-    createGLQuad(pixmap.data(), VBO, VAO, EBO, textureID);
+    createGLQuad(VBO, VAO, EBO);
+    // the render, streamed in tile by tile
+    TextureStream           texture;
+    std::vector<TileUpdate> tiles;
 
     // tell opengl for each sampler to which texture unit it belongs to (only
     // has to be done once)
@@ -311,6 +282,16 @@ void CielApp::mainLoop()
         // input
         // processInput(window);
 
+        // Renders run on m_renderThread, a new request cancels the one in
+        // flight. Their tiles are shown as they complete.
+        if (m_needRender) {
+            m_renderThread->request(m_renderSetting);
+            m_needRender = false;
+        }
+        m_renderThread->takeTiles(tiles);
+        texture.push(tiles);
+        texture.upload();
+
         // Start the Dear ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -323,7 +304,7 @@ void CielApp::mainLoop()
 
         // bind textures on corresponding texture units
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        glBindTexture(GL_TEXTURE_2D, texture.texture());
 
         // render container
         glUseProgram(shaderProgram);
@@ -347,6 +328,8 @@ void CielApp::mainLoop()
 
 void CielApp::cleanup()
 {
+    m_renderThread.reset();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "renderSetting.h"
-#include "renderer.h"
+#include "renderThread.h"
 
 #include <GLFW/glfw3.h>
 #include <memory>
@@ -9,8 +9,6 @@
 
 namespace ciel {
 
-class Renderer;
-
 class CielApp
 {
 public:
@@ -30,19 +28,18 @@ private:
 
     // openGL stuff
     void createGLShader(unsigned int& outShaderProgram);
-    void createGLQuad(void*         textureData,
-                      unsigned int& outVBO,
+    void createGLQuad(unsigned int& outVBO,
                       unsigned int& outVAO,
-                      unsigned int& outEBO,
-                      unsigned int& outTextureID);
+                      unsigned int& outEBO);
 
     void mainLoop();
 
     void cleanup();
 
 private:
-    std::unique_ptr<Renderer> m_renderer;
-    RenderSetting             m_renderSetting;
+    // renders in the background, see mainLoop()
+    std::unique_ptr<RenderThread> m_renderThread;
+    RenderSetting                 m_renderSetting;
 
     // GLFW Window
     GLFWwindow* m_window;
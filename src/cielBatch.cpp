@@ -0,0 +1,366 @@
+//
+//  Headless batch renderer
+//
+//  Renders the scene without a window and writes the result to an image file.
+//  Timing is printed to stdout as a single JSON line (always the last line of
+//  output), e.g.
+//
+//    {"width":800,"height":600,...,"render_seconds":1.234}
+//
+//  so that throughput jobs can parse it directly.
+//
+
+#include "asyncImageWriter.h"
+#include "renderSetting.h"
+#include "renderer.h"
+#include "sceneFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void printUsage(const char* program)
+{
+    std::cerr
+        << "Usage: " << program << " [options]\n"
+        << "      --scene <path>     render a scene file instead of the "
+           "built-in\n"
+        << "                         scene, options after it override its "
+           "settings\n"
+        << "  -w, --width <int>      image width (default: 800)\n"
+        << "  -h, --height <int>     image height (default: 600)\n"
+        << "      --rayDt <float>    raymarch step size (default: 0.01)\n"
+        << "      --expK <float>     extinction coefficient (default: 0.02)\n"
+        << "      --opacityThreshold <float>\n"
+        << "                         stop rays at this opacity, e.g. 0.99 "
+           "(default: 1, off)\n"
+        << "      --roulette <float> Russian roulette past --opacityThreshold "
+           "with\n"
+        << "                         this survival probability\n"
+        << "      --bake <int>       bake volumes into a grid of this "
+           "resolution\n"
+        << "      --bakeCache <dir>  keep --bake grids in this directory and "
+           "reuse\n"
+        << "                         them in later runs\n"
+        << "      --bakeSparse <float>\n"
+        << "                         bake volumes into a sparse grid with "
+           "this voxel size\n"
+        << "      --writePaged <path>\n"
+        << "                         write the volumes into a brick file at "
+           "the --bake\n"
+        << "                         resolution (default: 256) and exit\n"
+        << "      --compile          evaluate volumes as compiled programs\n"
+        << "      --noClip           march the full near/far range\n"
+        << "      --occupancy <int>  occupancy grid resolution for empty "
+           "space\n"
+        << "                         skipping, 0 = off (default: 32)\n"
+        << "      --noCull           no interval culling of ray segments\n"
+        << "      --colors <int>     color grid resolution, 0 = white "
+           "(default: 0)\n"
+        << "      --wisp <int>       add a wisp of this many particles\n"
+        << "      --wispVoxel <float>\n"
+        << "                         voxel size of the wisp (default: 0.01)\n"
+        << "      --light            light the volumes, with deep shadow maps\n"
+        << "      --shadowRes <int>  shadow map resolution (default: 64)\n"
+        << "      --packets          march rays in SIMD packets\n"
+        << "      --progressive      render coarse to fine, in passes "
+           "sampling every\n"
+        << "                         8th, 4th, 2nd and every pixel\n"
+        << "  -t, --threads <int>    render threads, 0 = all (default: 0)\n"
+        << "      --tileSize <int>   tile size in pixels (default: 32)\n"
+        << "      --tileOrder <name> scanline, morton or spiral "
+           "(default: spiral)\n"
+        << "  -o, --output <path>    output image, .pfm or .ppm "
+           "(default: ciel.pfm)\n"
+        << "  -v, --verbose          print render progress\n"
+        << "      --help             show this message\n";
+}
+
+struct BatchOptions
+{
+    ciel::RenderSetting       setting;
+    std::string               output{"ciel.pfm"};
+    ciel::SceneFile::ConstPtr sceneFile;
+    std::string               pagedOutput; // --writePaged
+};
+
+BatchOptions parseArgs(int argc, char** argv)
+{
+    BatchOptions options;
+    options.setting.verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        auto nextValue = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+        auto nextUnsigned = [&]() -> unsigned {
+            const std::string value = nextValue();
+            const long        n = std::stol(value);
+            if (n < 0) {
+                throw std::invalid_argument("Negative value for " + arg);
+            }
+            return (unsigned)n;
+        };
+
+        if (arg == "-w" || arg == "--width") {
+            options.setting.renderW = nextUnsigned();
+        }
+        else if (arg == "-h" || arg == "--height") {
+            options.setting.renderH = nextUnsigned();
+        }
+        else if (arg == "--rayDt") {
+            options.setting.rayDt = std::stof(nextValue());
+        }
+        else if (arg == "--expK") {
+            options.setting.expK = std::stof(nextValue());
+        }
+        else if (arg == "-t" || arg == "--threads") {
+            options.setting.numThreads = nextUnsigned();
+        }
+        else if (arg == "--opacityThreshold") {
+            options.setting.opacityThreshold = std::stof(nextValue());
+        }
+        else if (arg == "--roulette") {
+            options.setting.russianRoulette = true;
+            options.setting.rouletteSurvival = std::stof(nextValue());
+        }
+        else if (arg == "--bake") {
+            options.setting.bakeResolution = nextUnsigned();
+        }
+        else if (arg == "--bakeCache") {
+            options.setting.bakeCacheDir = nextValue();
+        }
+        else if (arg == "--bakeSparse") {
+            options.setting.bakeVoxelSize = std::stof(nextValue());
+        }
+        else if (arg == "--writePaged") {
+            options.pagedOutput = nextValue();
+        }
+        else if (arg == "--compile") {
+            options.setting.compileVolumes = true;
+        }
+        else if (arg == "--noClip") {
+            options.setting.clipToBounds = false;
+        }
+        else if (arg == "--occupancy") {
+            options.setting.occupancyResolution = nextUnsigned();
+        }
+        else if (arg == "--noCull") {
+            options.setting.intervalCulling = false;
+        }
+        else if (arg == "--colors") {
+            options.setting.colorResolution = nextUnsigned();
+        }
+        else if (arg == "--wisp") {
+            options.setting.wispParticles = nextUnsigned();
+        }
+        else if (arg == "--wispVoxel") {
+            options.setting.wispVoxelSize = std::stof(nextValue());
+        }
+        else if (arg == "--light") {
+            options.setting.lighting = true;
+        }
+        else if (arg == "--shadowRes") {
+            options.setting.shadowResolution = nextUnsigned();
+        }
+        else if (arg == "--packets") {
+            options.setting.usePackets = true;
+        }
+        else if (arg == "--progressive") {
+            options.setting.progressive = true;
+        }
+        else if (arg == "--tileSize") {
+            options.setting.tileSize = nextUnsigned();
+        }
+        else if (arg == "--tileOrder") {
+            const std::string order = nextValue();
+            if (order == "scanline") {
+                options.setting.tileOrder = ciel::TileOrder::Scanline;
+            }
+            else if (order == "morton") {
+                options.setting.tileOrder = ciel::TileOrder::Morton;
+            }
+            else if (order == "spiral") {
+                options.setting.tileOrder = ciel::TileOrder::Spiral;
+            }
+            else {
+                throw std::invalid_argument("Unknown tile order " + order);
+            }
+        }
+        else if (arg == "--scene") {
+            options.sceneFile = ciel::SceneFile::load(nextValue(),
+                                                      &options.setting);
+        }
+        else if (arg == "-o" || arg == "--output") {
+            options.output = nextValue();
+        }
+        else if (arg == "-v" || arg == "--verbose") {
+            options.setting.verbose = true;
+        }
+        else if (arg == "--help") {
+            printUsage(argv[0]);
+            std::exit(EXIT_SUCCESS);
+        }
+        else {
+            throw std::invalid_argument("Unknown option " + arg);
+        }
+    }
+
+    if (options.setting.renderW == 0 || options.setting.renderH == 0) {
+        throw std::invalid_argument("Image size must be non-zero");
+    }
+    if (options.setting.tileSize == 0) {
+        throw std::invalid_argument("Tile size must be non-zero");
+    }
+    if (!(options.setting.rayDt > 0)) {
+        throw std::invalid_argument("rayDt must be positive");
+    }
+    if (options.setting.bakeVoxelSize < 0) {
+        throw std::invalid_argument("Voxel size must not be negative");
+    }
+    if (!(options.setting.rouletteSurvival > 0 &&
+          options.setting.rouletteSurvival <= 1)) {
+        throw std::invalid_argument("Roulette survival must be in (0, 1]");
+    }
+
+    return options;
+}
+
+// --writePaged: the volumes of the scene as they would be baked, into a
+// brick file instead of rendering
+bool writePaged(const BatchOptions& options)
+{
+    using Clock = std::chrono::steady_clock;
+    using Seconds = std::chrono::duration<double>;
+
+    const auto     startTime = Clock::now();
+    const unsigned resolution = options.setting.bakeResolution > 0
+                                    ? options.setting.bakeResolution
+                                    : 256;
+    ciel::Scene::Ptr scene = ciel::Scene::create();
+    scene->setSceneFile(options.sceneFile);
+    scene->setWisp(options.setting.wispParticles,
+                   options.setting.wispVoxelSize);
+    scene->init(options.setting.renderW, options.setting.renderH);
+    if (!scene->writePaged(options.pagedOutput, resolution)) {
+        return false;
+    }
+    std::cout << "{\"paged\":\"" << options.pagedOutput
+              << "\",\"resolution\":" << resolution << ",\"seconds\":"
+              << Seconds(Clock::now() - startTime).count() << "}" << std::endl;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    using Clock = std::chrono::steady_clock;
+    using Seconds = std::chrono::duration<double>;
+
+    BatchOptions options;
+    try {
+        options = parseArgs(argc, argv);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[ciel][batch] " << e.what() << '\n';
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!options.pagedOutput.empty()) {
+        return writePaged(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    const ciel::RenderSetting& setting = options.setting;
+
+    // tiles are written out while the next ones render
+    ciel::AsyncImageWriter writer;
+    if (!writer.begin(options.output, setting.renderW, setting.renderH)) {
+        return EXIT_FAILURE;
+    }
+
+    ciel::Renderer renderer;
+    if (options.sceneFile) {
+        auto scene = ciel::Scene::create();
+        scene->setSceneFile(options.sceneFile);
+        renderer.setScene(std::move(scene));
+    }
+    renderer.setTileCallback([&writer](const ciel::Tile&         tile,
+                                       unsigned                  stride,
+                                       const std::vector<float>& pixmap) {
+        // only the final pass of a progressive render
+        if (stride == 1) {
+            writer.writeTile(tile, pixmap);
+        }
+    });
+    try {
+        renderer.Render(setting);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[ciel][batch] " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    // only the writing that did not overlap with rendering
+    const auto writeStartTime = Clock::now();
+    writer.end();
+    const bool   written = writer.wait();
+    const double writeSeconds = Seconds(Clock::now() - writeStartTime).count();
+    if (!written) {
+        return EXIT_FAILURE;
+    }
+
+    const ciel::RenderStats& stats = renderer.getLastRenderStats();
+    const double pixels = (double)setting.renderW * setting.renderH;
+
+    // tile cost spread shows how uneven the per-pixel work is
+    double tileMax = 0;
+    double tileSum = 0;
+    for (const ciel::TileStats& tile : stats.tileStats) {
+        tileMax = std::max(tileMax, tile.seconds);
+        tileSum += tile.seconds;
+    }
+    const size_t nTiles = stats.tileStats.size();
+
+    std::cout << "{\"width\":" << setting.renderW
+              << ",\"height\":" << setting.renderH
+              << ",\"rayDt\":" << setting.rayDt
+              << ",\"expK\":" << setting.expK
+              << ",\"packets\":" << (setting.usePackets ? "true" : "false")
+              << ",\"progressive\":"
+              << (setting.progressive ? "true" : "false")
+              << ",\"lighting\":" << (setting.lighting ? "true" : "false")
+              << ",\"wisp_particles\":" << setting.wispParticles
+              << ",\"threads\":" << stats.numThreads
+              << ",\"scene_seconds\":" << stats.sceneSeconds
+              << ",\"render_seconds\":" << stats.renderSeconds
+              << ",\"first_pass_seconds\":"
+              << (stats.passSeconds.empty() ? 0 : stats.passSeconds.front())
+              << ",\"write_seconds\":" << writeSeconds
+              << ",\"io_seconds\":" << writer.stats().ioSeconds
+              << ",\"tiles\":" << nTiles
+              << ",\"tile_seconds_mean\":" << (nTiles ? tileSum / nTiles : 0)
+              << ",\"tile_seconds_max\":" << tileMax
+              << ",\"steps_total\":" << stats.totalSteps
+              << ",\"steps_skipped\":" << stats.skippedSteps
+              << ",\"steps_clipped\":" << stats.clippedSteps
+              << ",\"brick_hits\":" << stats.brickHits
+              << ",\"brick_misses\":" << stats.brickMisses
+              << ",\"brick_prefetched\":" << stats.brickPrefetched
+              << ",\"brick_evictions\":" << stats.brickEvictions
+              << ",\"brick_bytes_read\":" << stats.brickBytesRead
+              << ",\"pixels_per_second\":"
+              << (stats.renderSeconds > 0 ? pixels / stats.renderSeconds : 0)
+              << ",\"output\":\"" << options.output << "\"}" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+#include "imageIO.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace ciel {
+
+namespace {
+
+bool checkPixmap(const std::vector<float>& pixmap,
+                 unsigned                  width,
+                 unsigned                  height)
+{
+    if ((size_t)width * height * 4 > pixmap.size()) {
+        std::cerr << "[ciel][io] Pixmap is smaller than " << width << "x"
+                  << height << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool endsWith(const std::string& str, const std::string& suffix)
+{
+    return str.size() >= suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool writeWhole(const std::string&        path,
+                ImageFormat               format,
+                const std::vector<float>& pixmap,
+                unsigned                  width,
+                unsigned                  height)
+{
+    if (!checkPixmap(pixmap, width, height)) {
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "[ciel][io] Failed to open " << path << std::endl;
+        return false;
+    }
+
+    // fileRow() is its own inverse: file row r holds pixmap row fileRow(r)
+    const ImageLayout layout(format, width, height);
+    file << layout.header();
+    std::vector<char> row(width * layout.pixelBytes());
+    for (unsigned r = 0; r < height; r++) {
+        const size_t j = layout.fileRow(r);
+        layout.encode(&pixmap[j * width * 4], width, row.data());
+        file.write(row.data(), row.size());
+    }
+
+    if (!file) {
+        std::cerr << "[ciel][io] Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool writePFM(const std::string&        path,
+              const std::vector<float>& pixmap,
+              unsigned                  width,
+              unsigned                  height)
+{
+    return writeWhole(path, ImageFormat::PFM, pixmap, width, height);
+}
+
+bool writePPM(const std::string&        path,
+              const std::vector<float>& pixmap,
+              unsigned                  width,
+              unsigned                  height)
+{
+    return writeWhole(path, ImageFormat::PPM, pixmap, width, height);
+}
+
+bool writeImage(const std::string&        path,
+                const std::vector<float>& pixmap,
+                unsigned                  width,
+                unsigned                  height)
+{
+    const std::optional<ImageFormat> format = imageFormat(path);
+    return format && writeWhole(path, *format, pixmap, width, height);
+}
+
+std::optional<ImageFormat> imageFormat(const std::string& path)
+{
+    if (endsWith(path, ".pfm")) {
+        return ImageFormat::PFM;
+    }
+    if (endsWith(path, ".ppm")) {
+        return ImageFormat::PPM;
+    }
+
+    std::cerr << "[ciel][io] Unknown image format: " << path
+              << " (expected .pfm or .ppm)" << std::endl;
+    return std::nullopt;
+}
+
+ImageLayout::ImageLayout(ImageFormat format, unsigned width, unsigned height)
+: m_format(format)
+, m_width(width)
+, m_height(height)
+{
+    const std::string size = std::to_string(width) + " " +
+                             std::to_string(height) + "\n";
+    if (format == ImageFormat::PFM) {
+        // negative scale: little endian
+        const bool littleEndian = std::endian::native == std::endian::little;
+        m_header = "PF\n" + size + (littleEndian ? "-1.0" : "1.0") + "\n";
+        m_pixelBytes = 3 * sizeof(float);
+    }
+    else {
+        m_header = "P6\n" + size + "255\n";
+        m_pixelBytes = 3;
+    }
+}
+
+size_t ImageLayout::fileBytes() const
+{
+    return m_header.size() + (size_t)m_width * m_height * m_pixelBytes;
+}
+
+unsigned ImageLayout::fileRow(unsigned j) const
+{
+    // PFM rows go bottom to top, same as the pixmap, PPM rows top to bottom
+    return m_format == ImageFormat::PFM ? j : m_height - 1 - j;
+}
+
+size_t ImageLayout::offset(unsigned i, unsigned j) const
+{
+    return m_header.size() +
+           ((size_t)fileRow(j) * m_width + i) * m_pixelBytes;
+}
+
+void ImageLayout::encode(const float* rgba, size_t count, char* out) const
+{
+    if (m_format == ImageFormat::PFM) {
+        for (size_t i = 0; i < count; i++) {
+            std::memcpy(out + i * m_pixelBytes, rgba + i * 4, m_pixelBytes);
+        }
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        for (int c = 0; c < 3; c++) {
+            const float v = std::clamp(rgba[i * 4 + c], 0.f, 1.f);
+            out[i * 3 + c] = (char)(uint8_t)(v * 255.f + 0.5f);
+        }
+    }
+}
+
+} // namespace ciel
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ciel {
+
+// Image output for rendered pixmaps.
+//
+// The pixmap layout follows Renderer: RGBA floats, row 0 at the bottom of the
+// image. The write functions return false (and print the reason) on failure.
+
+// Portable float map (.pfm), RGB 32-bit float. Alpha is dropped.
+bool writePFM(const std::string&        path,
+              const std::vector<float>& pixmap,
+              unsigned                  width,
+              unsigned                  height);
+
+// Portable pixmap (.ppm), RGB 8-bit. Values are clamped to [0, 1].
+bool writePPM(const std::string&        path,
+              const std::vector<float>& pixmap,
+              unsigned                  width,
+              unsigned                  height);
+
+// Picks the format from the file extension (.pfm or .ppm)
+bool writeImage(const std::string&        path,
+                const std::vector<float>& pixmap,
+                unsigned                  width,
+                unsigned                  height);
+
+// The file layout of the formats above, for writers that put the pixels
+// in place piece by piece (see AsyncImageWriter). Both formats are a text
+// header followed by fixed size pixels, row by row.
+enum class ImageFormat
+{
+    PFM,
+    PPM
+};
+
+// The format of `path` by its extension, nullopt (printing the reason) if
+// it is neither
+std::optional<ImageFormat> imageFormat(const std::string& path);
+
+class ImageLayout
+{
+public:
+    ImageLayout(ImageFormat format, unsigned width, unsigned height);
+
+    const std::string& header() const { return m_header; }
+    size_t             pixelBytes() const { return m_pixelBytes; }
+    size_t             fileBytes() const;
+    // Row of the file that holds row j of the pixmap
+    unsigned fileRow(unsigned j) const;
+    // Offset in the file of pixel (i, j) of the pixmap
+    size_t offset(unsigned i, unsigned j) const;
+    // Encodes `count` RGBA pixels to `count * pixelBytes()` bytes
+    void encode(const float* rgba, size_t count, char* out) const;
+
+private:
+    ImageFormat m_format;
+    unsigned    m_width;
+    unsigned    m_height;
+    std::string m_header;
+    size_t      m_pixelBytes;
+};
+
+} // namespace ciel
@@ -0,0 +1,59 @@
+#include "light.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ciel {
+
+void Light::bakeShadow(const DensityFn& density,
+                       const BBox&      bound,
+                       unsigned         resolution,
+                       float            extinction)
+{
+    clearShadow();
+    if (bound.isEmpty() || bound.isInfinite() || resolution == 0) {
+        return;
+    }
+
+    mShadow = DenseGrid<float>(GridLayout::fromResolution(bound, resolution),
+                               1.f);
+    const GridLayout& l = mShadow.layout();
+    const float       ds = std::max(
+        {l.voxelSize.X(), l.voxelSize.Y(), l.voxelSize.Z()});
+    if (!(ds > 0)) {
+        return;
+    }
+    const float eps = std::numeric_limits<float>::epsilon();
+    // past this optical depth the node is black for any practical purpose
+    constexpr float maxDepth = 20.f;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif // _OPENMP
+    for (unsigned k = 0; k < l.nz; k++) {
+        for (unsigned j = 0; j < l.ny; j++) {
+            for (unsigned i = 0; i < l.nx; i++) {
+                const Vector p = l.position(i, j, k);
+                float        distance;
+                const Vector d = toLight(p, distance);
+
+                // only the part of the shadow ray inside the bound matters
+                float t0 = 0;
+                float t1 = distance;
+                float depth = 0;
+                if (bound.intersectRay(p, d, t0, t1)) {
+                    for (float t = ds; t <= t1 && depth < maxDepth; t += ds) {
+                        if (density(p + d * t) >= eps) {
+                            depth += extinction * ds;
+                        }
+                    }
+                }
+                mShadow.at(i, j, k) = std::exp(-depth);
+            }
+        }
+    }
+    mHasShadow = true;
+}
+
+} // namespace ciel
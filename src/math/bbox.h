@@ -0,0 +1,120 @@
+#pragma once
+
+#include "vector.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace ciel {
+
+// Axis aligned bounding box. A default constructed box is empty.
+class BBox
+{
+public:
+    constexpr BBox()
+    : m_min(std::numeric_limits<float>::max())
+    , m_max(std::numeric_limits<float>::lowest())
+    {
+    }
+    constexpr BBox(const Vector& lo, const Vector& hi)
+    : m_min(lo)
+    , m_max(hi)
+    {
+    }
+
+    static BBox infinite()
+    {
+        return BBox(Vector(-std::numeric_limits<float>::infinity()),
+                    Vector(std::numeric_limits<float>::infinity()));
+    }
+    static BBox fromCenter(const Vector& center, const Vector& halfSize)
+    {
+        return BBox(center - halfSize, center + halfSize);
+    }
+
+    const Vector& min() const { return m_min; }
+    const Vector& max() const { return m_max; }
+    Vector        center() const { return (m_min + m_max) * 0.5f; }
+    Vector        size() const { return m_max - m_min; }
+
+    bool isEmpty() const
+    {
+        return m_min.X() > m_max.X() || m_min.Y() > m_max.Y() ||
+               m_min.Z() > m_max.Z();
+    }
+    bool isInfinite() const
+    {
+        for (int i = 0; i < 3; i++) {
+            if (std::isinf(m_min[i]) || std::isinf(m_max[i])) {
+                return true;
+            }
+        }
+        return false;
+    }
+    bool contains(const Vector& p) const
+    {
+        return p.X() >= m_min.X() && p.X() <= m_max.X() &&
+               p.Y() >= m_min.Y() && p.Y() <= m_max.Y() &&
+               p.Z() >= m_min.Z() && p.Z() <= m_max.Z();
+    }
+
+    // smallest box containing both
+    BBox unite(const BBox& b) const
+    {
+        return BBox(Vector(std::min(m_min.X(), b.m_min.X()),
+                           std::min(m_min.Y(), b.m_min.Y()),
+                           std::min(m_min.Z(), b.m_min.Z())),
+                    Vector(std::max(m_max.X(), b.m_max.X()),
+                           std::max(m_max.Y(), b.m_max.Y()),
+                           std::max(m_max.Z(), b.m_max.Z())));
+    }
+    // overlap of both, empty if they are disjoint
+    BBox intersect(const BBox& b) const
+    {
+        return BBox(Vector(std::max(m_min.X(), b.m_min.X()),
+                           std::max(m_min.Y(), b.m_min.Y()),
+                           std::max(m_min.Z(), b.m_min.Z())),
+                    Vector(std::min(m_max.X(), b.m_max.X()),
+                           std::min(m_max.Y(), b.m_max.Y()),
+                           std::min(m_max.Z(), b.m_max.Z())));
+    }
+    BBox expand(float d) const { return BBox(m_min - Vector(d), m_max + d); }
+
+    // Slab test of the ray origin + t * dir against the box.
+    // [t0, t1] is clipped to the overlap, returns false if there is none.
+    bool intersectRay(const Vector& origin,
+                      const Vector& dir,
+                      float&        t0,
+                      float&        t1) const
+    {
+        if (isEmpty()) {
+            return false;
+        }
+        for (int i = 0; i < 3; i++) {
+            const float invD = 1.f / dir[i];
+            float       tNear = (m_min[i] - origin[i]) * invD;
+            float       tFar = (m_max[i] - origin[i]) * invD;
+            if (invD < 0) {
+                std::swap(tNear, tFar);
+            }
+            // NaN (0 * inf) when the ray is parallel to an infinite slab:
+            // leave the interval alone
+            if (tNear > t0) {
+                t0 = tNear;
+            }
+            if (tFar < t1) {
+                t1 = tFar;
+            }
+            if (t0 > t1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    Vector m_min;
+    Vector m_max;
+};
+
+} // namespace ciel
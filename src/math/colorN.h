@@ -0,0 +1,148 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Structure-of-arrays packet of N Colors.
+//
+// -------------------------------------------------------
+
+#include "color.h"
+#include "vectorN.h"
+
+namespace ciel {
+
+template<int N>
+class ColorN
+{
+public:
+    using floatN = FloatN<N>;
+    using maskN = MaskN<N>;
+    static constexpr int width = N;
+
+    ColorN()
+    : xyzw{}
+    {
+    }
+    // broadcast
+    ColorN(const Color& c)
+    : xyzw{floatN(c.X()), floatN(c.Y()), floatN(c.Z()), floatN(c.W())}
+    {
+    }
+    ColorN(const floatN& a, const floatN& b, const floatN& c, const floatN& d)
+    : xyzw{a, b, c, d}
+    {
+    }
+
+    Color lane(const int i) const
+    {
+        return Color(xyzw[0][i], xyzw[1][i], xyzw[2][i], xyzw[3][i]);
+    }
+    void setLane(const int i, const Color& c)
+    {
+        xyzw[0][i] = c.X();
+        xyzw[1][i] = c.Y();
+        xyzw[2][i] = c.Z();
+        xyzw[3][i] = c.W();
+    }
+
+    const ColorN operator+(const ColorN& v) const
+    {
+        return ColorN(xyzw[0] + v.xyzw[0],
+                      xyzw[1] + v.xyzw[1],
+                      xyzw[2] + v.xyzw[2],
+                      xyzw[3] + v.xyzw[3]);
+    }
+
+    const ColorN operator-(const ColorN& v) const
+    {
+        return ColorN(xyzw[0] - v.xyzw[0],
+                      xyzw[1] - v.xyzw[1],
+                      xyzw[2] - v.xyzw[2],
+                      xyzw[3] - v.xyzw[3]);
+    }
+
+    friend const ColorN operator-(const ColorN& v)
+    {
+        return ColorN(-v.xyzw[0], -v.xyzw[1], -v.xyzw[2], -v.xyzw[3]);
+    }
+
+    friend const ColorN operator*(const floatN& w, const ColorN& v)
+    {
+        return v * w;
+    }
+
+    const ColorN operator*(const floatN& v) const
+    {
+        return ColorN(xyzw[0] * v, xyzw[1] * v, xyzw[2] * v, xyzw[3] * v);
+    }
+
+    const ColorN operator*(const float v) const
+    {
+        return ColorN(xyzw[0] * v, xyzw[1] * v, xyzw[2] * v, xyzw[3] * v);
+    }
+
+    const ColorN operator/(const floatN& v) const
+    {
+        return ColorN(xyzw[0] / v, xyzw[1] / v, xyzw[2] / v, xyzw[3] / v);
+    }
+
+    // component-wise product
+    const ColorN operator*(const ColorN& v) const
+    {
+        return ColorN(xyzw[0] * v.xyzw[0],
+                      xyzw[1] * v.xyzw[1],
+                      xyzw[2] * v.xyzw[2],
+                      xyzw[3] * v.xyzw[3]);
+    }
+
+    ColorN& operator+=(const ColorN& v)
+    {
+        xyzw[0] += v.xyzw[0];
+        xyzw[1] += v.xyzw[1];
+        xyzw[2] += v.xyzw[2];
+        xyzw[3] += v.xyzw[3];
+        return *this;
+    }
+
+    ColorN& operator-=(const ColorN& v)
+    {
+        xyzw[0] -= v.xyzw[0];
+        xyzw[1] -= v.xyzw[1];
+        xyzw[2] -= v.xyzw[2];
+        xyzw[3] -= v.xyzw[3];
+        return *this;
+    }
+
+    ColorN& operator*=(const floatN& v)
+    {
+        xyzw[0] *= v;
+        xyzw[1] *= v;
+        xyzw[2] *= v;
+        xyzw[3] *= v;
+        return *this;
+    }
+
+    // += only on the lanes where mask is set
+    void addMasked(const maskN& mask, const ColorN& v)
+    {
+        where(mask, xyzw[0]) += v.xyzw[0];
+        where(mask, xyzw[1]) += v.xyzw[1];
+        where(mask, xyzw[2]) += v.xyzw[2];
+        where(mask, xyzw[3]) += v.xyzw[3];
+    }
+
+    const floatN& operator[](const int v) const { return xyzw[v]; }
+    floatN&       operator[](const int v) { return xyzw[v]; }
+
+    const floatN& X() const { return xyzw[0]; }
+    const floatN& Y() const { return xyzw[1]; }
+    const floatN& Z() const { return xyzw[2]; }
+    const floatN& W() const { return xyzw[3]; }
+
+private:
+    floatN xyzw[4];
+};
+
+using ColorP = ColorN<kPacketWidth>;
+
+} // namespace ciel
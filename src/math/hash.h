@@ -0,0 +1,67 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Content hashing.
+//
+//  64 bit hashes of parameter values, combined in order,
+//  to tell whether two objects describe the same thing.
+//  Floats hash by bit pattern with -0 folded onto 0.
+//
+// -------------------------------------------------------
+
+#include "color.h"
+#include "vector.h"
+
+#include <bit>
+#include <cstdint>
+#include <string_view>
+
+namespace ciel {
+
+// FNV-1a, usable for compile time type tags
+constexpr uint64_t hashString(std::string_view s)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (const char c : s) {
+        h = (h ^ (uint8_t)c) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+// splitmix64 finalizer
+constexpr uint64_t hashMix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+constexpr uint64_t hashCombine(uint64_t seed, uint64_t value)
+{
+    return hashMix(seed ^ (hashMix(value) + 0x9e3779b97f4a7c15ull +
+                           (seed << 6) + (seed >> 2)));
+}
+
+inline uint64_t hashCombine(uint64_t seed, float value)
+{
+    return hashCombine(seed, (uint64_t)std::bit_cast<uint32_t>(value + 0.f));
+}
+
+inline uint64_t hashCombine(uint64_t seed, const Vector& v)
+{
+    return hashCombine(hashCombine(hashCombine(seed, v.X()), v.Y()), v.Z());
+}
+
+inline uint64_t hashCombine(uint64_t seed, const Color& c)
+{
+    for (int i = 0; i < 4; i++) {
+        seed = hashCombine(seed, c[i]);
+    }
+    return seed;
+}
+
+} // namespace ciel
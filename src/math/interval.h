@@ -0,0 +1,115 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Interval arithmetic.
+//
+//  An Interval [lo, hi] encloses every value an expression
+//  can take when its inputs range over their intervals, so
+//  evaluating a field on the intervals of a box bounds the
+//  field over the whole box. The bounds are conservative,
+//  not tight: a variable used twice is treated as two.
+//
+// -------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ciel {
+
+struct Interval
+{
+    float lo, hi;
+
+    constexpr Interval()
+    : lo(0)
+    , hi(0)
+    {
+    }
+    constexpr Interval(float v)
+    : lo(v)
+    , hi(v)
+    {
+    }
+    constexpr Interval(float tLo, float tHi)
+    : lo(tLo)
+    , hi(tHi)
+    {
+    }
+
+    static constexpr Interval infinite()
+    {
+        return Interval(-std::numeric_limits<float>::infinity(),
+                        std::numeric_limits<float>::infinity());
+    }
+
+    bool contains(float v) const { return lo <= v && v <= hi; }
+};
+
+inline Interval operator+(const Interval& a, const Interval& b)
+{
+    return Interval(a.lo + b.lo, a.hi + b.hi);
+}
+inline Interval operator-(const Interval& a, const Interval& b)
+{
+    return Interval(a.lo - b.hi, a.hi - b.lo);
+}
+inline Interval operator-(const Interval& a) { return Interval(-a.hi, -a.lo); }
+inline Interval operator*(const Interval& a, const Interval& b)
+{
+    const float p[4] = {a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi};
+    return Interval(std::min({p[0], p[1], p[2], p[3]}),
+                    std::max({p[0], p[1], p[2], p[3]}));
+}
+inline Interval operator*(const Interval& a, float f)
+{
+    return f >= 0 ? Interval(a.lo * f, a.hi * f) : Interval(a.hi * f, a.lo * f);
+}
+inline Interval operator*(float f, const Interval& a) { return a * f; }
+inline Interval operator/(const Interval& a, float f)
+{
+    return f >= 0 ? Interval(a.lo / f, a.hi / f) : Interval(a.hi / f, a.lo / f);
+}
+
+// Functions
+inline Interval sqr(const Interval& a)
+{
+    if (a.lo >= 0) {
+        return Interval(a.lo * a.lo, a.hi * a.hi);
+    }
+    if (a.hi <= 0) {
+        return Interval(a.hi * a.hi, a.lo * a.lo);
+    }
+    return Interval(0, std::max(a.lo * a.lo, a.hi * a.hi));
+}
+inline Interval sqrt(const Interval& a)
+{
+    return Interval(std::sqrt(std::max(a.lo, 0.f)),
+                    std::sqrt(std::max(a.hi, 0.f)));
+}
+inline Interval abs(const Interval& a)
+{
+    if (a.lo >= 0) {
+        return a;
+    }
+    if (a.hi <= 0) {
+        return -a;
+    }
+    return Interval(0, std::max(-a.lo, a.hi));
+}
+inline Interval min(const Interval& a, const Interval& b)
+{
+    return Interval(std::min(a.lo, b.lo), std::min(a.hi, b.hi));
+}
+inline Interval max(const Interval& a, const Interval& b)
+{
+    return Interval(std::max(a.lo, b.lo), std::max(a.hi, b.hi));
+}
+// smallest interval containing both
+inline Interval hull(const Interval& a, const Interval& b)
+{
+    return Interval(std::min(a.lo, b.lo), std::max(a.hi, b.hi));
+}
+
+} // namespace ciel
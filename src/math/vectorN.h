@@ -0,0 +1,262 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Structure-of-arrays packet of N Vectors.
+//  Each component is a SIMD register, so one operation
+//  processes N vectors (e.g. N coherent rays) at once.
+//
+// -------------------------------------------------------
+
+#include "vector.h"
+
+#include <type_traits>
+
+namespace ciel {
+
+#ifndef CIEL_PACKET_WIDTH
+#define CIEL_PACKET_WIDTH 8
+#endif
+
+template<int N>
+using FloatN = stdx::fixed_size_simd<float, N>;
+template<int N>
+using MaskN = typename FloatN<N>::mask_type;
+
+template<int N>
+class VectorN
+{
+public:
+    using floatN = FloatN<N>;
+    using maskN = MaskN<N>;
+    static constexpr int width = N;
+
+    VectorN()
+    : xyz{}
+    {
+    }
+    // broadcast
+    VectorN(const Vector& v)
+    : xyz{floatN(v.X()), floatN(v.Y()), floatN(v.Z())}
+    {
+    }
+    VectorN(const floatN& a, const floatN& b, const floatN& c)
+    : xyz{a, b, c}
+    {
+    }
+
+    Vector lane(const int i) const
+    {
+        return Vector(xyz[0][i], xyz[1][i], xyz[2][i]);
+    }
+    void setLane(const int i, const Vector& v)
+    {
+        xyz[0][i] = v.X();
+        xyz[1][i] = v.Y();
+        xyz[2][i] = v.Z();
+    }
+
+    const VectorN operator+(const VectorN& v) const
+    {
+        return VectorN(xyz[0] + v.xyz[0], xyz[1] + v.xyz[1], xyz[2] + v.xyz[2]);
+    }
+
+    const VectorN operator+(float c) const
+    {
+        return VectorN(xyz[0] + c, xyz[1] + c, xyz[2] + c);
+    }
+
+    const VectorN operator-(const VectorN& v) const
+    {
+        return VectorN(xyz[0] - v.xyz[0], xyz[1] - v.xyz[1], xyz[2] - v.xyz[2]);
+    }
+
+    const VectorN operator-(const Vector& v) const
+    {
+        return VectorN(xyz[0] - v.X(), xyz[1] - v.Y(), xyz[2] - v.Z());
+    }
+
+    friend const VectorN operator-(const VectorN& v)
+    {
+        return VectorN(-v.xyz[0], -v.xyz[1], -v.xyz[2]);
+    }
+
+    friend const VectorN operator*(const floatN& w, const VectorN& v)
+    {
+        return v * w;
+    }
+
+    const VectorN operator*(const floatN& v) const
+    {
+        return VectorN(xyz[0] * v, xyz[1] * v, xyz[2] * v);
+    }
+
+    const VectorN operator*(const float v) const
+    {
+        return VectorN(xyz[0] * v, xyz[1] * v, xyz[2] * v);
+    }
+
+    const VectorN operator/(const floatN& v) const
+    {
+        return VectorN(xyz[0] / v, xyz[1] / v, xyz[2] / v);
+    }
+
+    const VectorN operator/(const float v) const
+    {
+        return VectorN(xyz[0] / v, xyz[1] / v, xyz[2] / v);
+    }
+
+    // dot product
+    floatN operator*(const VectorN& v) const
+    {
+        return (xyz[0] * v.xyz[0] + xyz[1] * v.xyz[1] + xyz[2] * v.xyz[2]);
+    }
+
+    floatN operator*(const Vector& v) const
+    {
+        return (xyz[0] * v.X() + xyz[1] * v.Y() + xyz[2] * v.Z());
+    }
+
+    // cross product
+    const VectorN operator^(const VectorN& v) const
+    {
+        return VectorN(xyz[1] * v.xyz[2] - xyz[2] * v.xyz[1],
+                       xyz[2] * v.xyz[0] - xyz[0] * v.xyz[2],
+                       xyz[0] * v.xyz[1] - xyz[1] * v.xyz[0]);
+    }
+
+    VectorN& operator+=(const VectorN& v)
+    {
+        xyz[0] += v.xyz[0];
+        xyz[1] += v.xyz[1];
+        xyz[2] += v.xyz[2];
+        return *this;
+    }
+
+    VectorN& operator-=(const VectorN& v)
+    {
+        xyz[0] -= v.xyz[0];
+        xyz[1] -= v.xyz[1];
+        xyz[2] -= v.xyz[2];
+        return *this;
+    }
+
+    VectorN& operator*=(const floatN& v)
+    {
+        xyz[0] *= v;
+        xyz[1] *= v;
+        xyz[2] *= v;
+        return *this;
+    }
+
+    VectorN& operator/=(const floatN& v)
+    {
+        xyz[0] /= v;
+        xyz[1] /= v;
+        xyz[2] /= v;
+        return *this;
+    }
+
+    const floatN& operator[](const int v) const { return xyz[v]; }
+    floatN&       operator[](const int v) { return xyz[v]; }
+
+    const floatN& X() const { return xyz[0]; }
+    const floatN& Y() const { return xyz[1]; }
+    const floatN& Z() const { return xyz[2]; }
+
+    floatN magnitude() const
+    {
+        return stdx::sqrt(xyz[0] * xyz[0] + xyz[1] * xyz[1] + xyz[2] * xyz[2]);
+    }
+
+    const VectorN unitvector() const { return *this / magnitude(); }
+
+    void normalize() { *this /= magnitude(); }
+
+private:
+    floatN xyz[3];
+};
+
+// lane-wise scaling of a single vector
+template<int N>
+const VectorN<N> operator*(const FloatN<N>& w, const Vector& v)
+{
+    return VectorN<N>(w * v.X(), w * v.Y(), w * v.Z());
+}
+
+// Basic Operations
+template<int N>
+FloatN<N> length(const VectorN<N>& v)
+{
+    return v.magnitude();
+}
+template<int N>
+VectorN<N> abs(const VectorN<N>& v)
+{
+    return VectorN<N>{stdx::abs(v.X()), stdx::abs(v.Y()), stdx::abs(v.Z())};
+}
+template<int N>
+VectorN<N> min(const VectorN<N>& v, float f)
+{
+    return VectorN<N>{stdx::min(v.X(), FloatN<N>(f)),
+                      stdx::min(v.Y(), FloatN<N>(f)),
+                      stdx::min(v.Z(), FloatN<N>(f))};
+}
+template<int N>
+VectorN<N> max(const VectorN<N>& v, float f)
+{
+    return VectorN<N>{stdx::max(v.X(), FloatN<N>(f)),
+                      stdx::max(v.Y(), FloatN<N>(f)),
+                      stdx::max(v.Z(), FloatN<N>(f))};
+}
+// component-wise
+template<int N>
+VectorN<N> min(const VectorN<N>& a, const VectorN<N>& b)
+{
+    return VectorN<N>{stdx::min(a.X(), b.X()),
+                      stdx::min(a.Y(), b.Y()),
+                      stdx::min(a.Z(), b.Z())};
+}
+template<int N>
+VectorN<N> max(const VectorN<N>& a, const VectorN<N>& b)
+{
+    return VectorN<N>{stdx::max(a.X(), b.X()),
+                      stdx::max(a.Y(), b.Y()),
+                      stdx::max(a.Z(), b.Z())};
+}
+
+// Lane-wise a ? b : c, so that the same kernel can be written for
+// a scalar float and a FloatN.
+inline float select(bool mask, float a, float b) { return mask ? a : b; }
+template<typename T, typename Abi>
+stdx::simd<T, Abi>
+select(const stdx::simd_mask<T, Abi>&                     mask,
+       const std::type_identity_t<stdx::simd<T, Abi>>& a,
+       const std::type_identity_t<stdx::simd<T, Abi>>& b)
+{
+    stdx::simd<T, Abi> result = b;
+    where(mask, result) = a;
+    return result;
+}
+
+// Scalar type matching a Vector (float) or a VectorN (FloatN)
+template<typename V>
+struct ScalarOf
+{
+    using type = float;
+};
+template<int N>
+struct ScalarOf<VectorN<N>>
+{
+    using type = FloatN<N>;
+};
+template<typename V>
+using ScalarOf_t = typename ScalarOf<V>::type;
+
+// Ray packet types used by the renderer
+inline constexpr int kPacketWidth = CIEL_PACKET_WIDTH;
+using FloatP = FloatN<kPacketWidth>;
+using MaskP = MaskN<kPacketWidth>;
+using VectorP = VectorN<kPacketWidth>;
+
+} // namespace ciel
@@ -0,0 +1,137 @@
+#include "occupancyGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ciel {
+
+void OccupancyGrid::build(const RegionFn& mayBeOccupied,
+                          const BBox&     bound,
+                          unsigned        resolution)
+{
+    clear();
+    const Vector size = bound.size();
+    const float  longest = std::max({size.X(), size.Y(), size.Z()});
+    if (bound.isEmpty() || bound.isInfinite() || !(longest > 0) ||
+        resolution == 0) {
+        return;
+    }
+
+    // cubic cells, the grid may stick out of `bound` by less than a cell
+    const float cell = longest / resolution;
+    auto        cells = [cell](float length) {
+        return std::max(1u, (unsigned)std::ceil(length / cell));
+    };
+    m_nx = cells(size.X());
+    m_ny = cells(size.Y());
+    m_nz = cells(size.Z());
+    m_cellSize = Vector(cell);
+    m_bound = BBox(bound.min(),
+                   bound.min() + Vector(m_nx * cell, m_ny * cell, m_nz * cell));
+    m_resolution = resolution;
+
+    // Cells are tested slightly grown: a ray grazing a face may be walked
+    // through the cell on either side of it, and rounding in the traversal
+    // must not make it miss density sitting right on the face.
+    const float margin = cell * 1e-2f;
+    m_cells.assign((size_t)m_nx * m_ny * m_nz, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif // _OPENMP
+    for (unsigned k = 0; k < m_nz; k++) {
+        for (unsigned j = 0; j < m_ny; j++) {
+            for (unsigned i = 0; i < m_nx; i++) {
+                const Vector lo = m_bound.min() + Vector(i * cell,
+                                                         j * cell,
+                                                         k * cell);
+                m_cells[((size_t)k * m_ny + j) * m_nx + i] =
+                    mayBeOccupied(BBox(lo, lo + m_cellSize).expand(margin));
+            }
+        }
+    }
+    m_occupied = std::count(m_cells.begin(), m_cells.end(), 1);
+}
+
+void OccupancyGrid::clear()
+{
+    m_bound = BBox();
+    m_resolution = 0;
+    m_nx = m_ny = m_nz = 0;
+    m_cells.clear();
+    m_occupied = 0;
+}
+
+// Amanatides & Woo traversal: from the cell holding the entry point, step
+// into whichever neighbouring cell the ray reaches first.
+void OccupancyGrid::clipRay(const Vector&                  o,
+                            const Vector&                  d,
+                            const std::vector<RaySegment>& segments,
+                            std::vector<RaySegment>&       outSegments) const
+{
+    const unsigned n[3] = {m_nx, m_ny, m_nz};
+    constexpr float inf = std::numeric_limits<float>::infinity();
+
+    for (const RaySegment& segment : segments) {
+        float t0 = segment.t0;
+        float t1 = segment.t1;
+        if (!m_bound.intersectRay(o, d, t0, t1)) {
+            continue;
+        }
+
+        int   cell[3];
+        int   step[3];
+        float tNext[3];
+        float tDelta[3];
+        for (int a = 0; a < 3; a++) {
+            const float g = (o[a] + d[a] * t0 - m_bound.min()[a]) /
+                            m_cellSize[a];
+            cell[a] = std::clamp((int)std::floor(g), 0, (int)n[a] - 1);
+            if (d[a] > 0) {
+                step[a] = 1;
+                tNext[a] = (m_bound.min()[a] + (cell[a] + 1) * m_cellSize[a] -
+                            o[a]) /
+                           d[a];
+                tDelta[a] = m_cellSize[a] / d[a];
+            }
+            else if (d[a] < 0) {
+                step[a] = -1;
+                tNext[a] = (m_bound.min()[a] + cell[a] * m_cellSize[a] - o[a]) /
+                           d[a];
+                tDelta[a] = -m_cellSize[a] / d[a];
+            }
+            else {
+                step[a] = 0;
+                tNext[a] = inf;
+                tDelta[a] = inf;
+            }
+        }
+
+        float t = t0;
+        while (t < t1) {
+            const int   axis = tNext[0] < tNext[1]
+                                   ? (tNext[0] < tNext[2] ? 0 : 2)
+                                   : (tNext[1] < tNext[2] ? 1 : 2);
+            const float tExit = std::min(tNext[axis], t1);
+
+            if (occupied(cell[0], cell[1], cell[2])) {
+                if (!outSegments.empty() && outSegments.back().t1 >= t) {
+                    outSegments.back().t1 = std::max(outSegments.back().t1,
+                                                     tExit);
+                }
+                else {
+                    outSegments.push_back(RaySegment{t, tExit});
+                }
+            }
+
+            cell[axis] += step[axis];
+            if (cell[axis] < 0 || cell[axis] >= (int)n[axis]) {
+                break;
+            }
+            t = tNext[axis];
+            tNext[axis] += tDelta[axis];
+        }
+    }
+}
+
+} // namespace ciel
@@ -0,0 +1,72 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Coarse occupancy grid (macrocells) over the scene.
+//
+//  Each cell records whether it may hold density, decided
+//  by interval bounds over the whole cell, so a cell is
+//  only marked empty when it provably is. Rays walk the
+//  cells with a 3D-DDA and only keep the parts that cross
+//  occupied cells, so the marcher can jump over empty
+//  space in one go instead of stepping rayDt.
+//
+// -------------------------------------------------------
+
+#include "math/bbox.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace ciel {
+
+// Part [t0, t1] of a ray origin + t * direction
+struct RaySegment
+{
+    float t0, t1;
+};
+
+class OccupancyGrid
+{
+public:
+    // true unless there is certainly no density in the box
+    using RegionFn = std::function<bool(const BBox&)>;
+
+    // `resolution` cells along the longest side of `bound`. A cell is
+    // occupied if mayBeOccupied(cell box) holds. Cells are tested in
+    // parallel.
+    void build(const RegionFn& mayBeOccupied,
+               const BBox&     bound,
+               unsigned        resolution);
+    void clear();
+
+    bool        isBuilt() const { return !m_cells.empty(); }
+    const BBox& bound() const { return m_bound; }
+    unsigned    resolution() const { return m_resolution; }
+    size_t      cellCount() const { return m_cells.size(); }
+    size_t      occupiedCount() const { return m_occupied; }
+
+    bool occupied(unsigned i, unsigned j, unsigned k) const
+    {
+        return m_cells[((size_t)k * m_ny + j) * m_nx + i] != 0;
+    }
+
+    // Walks each of the sorted, non-overlapping `segments` through the
+    // cells and appends the parts crossing occupied cells to outSegments,
+    // merging neighbours. Nothing outside the grid bound is kept.
+    void clipRay(const Vector&                  origin,
+                 const Vector&                  direction,
+                 const std::vector<RaySegment>& segments,
+                 std::vector<RaySegment>&       outSegments) const;
+
+private:
+    BBox                 m_bound;
+    unsigned             m_resolution{0};
+    unsigned             m_nx{0}, m_ny{0}, m_nz{0};
+    Vector               m_cellSize;
+    std::vector<uint8_t> m_cells;
+    size_t               m_occupied{0};
+};
+
+} // namespace ciel
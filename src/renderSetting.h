@@ -1,7 +1,17 @@
 #pragma once
 
+#include <string>
+
 namespace ciel {
 
+// Order in which image tiles are handed out to render threads
+enum class TileOrder
+{
+    Scanline, // row by row, bottom to top
+    Morton,   // Z-order curve, keeps consecutive tiles close together
+    Spiral    // center-out, where the subject usually is
+};
+
 struct RenderSetting
 {
     // Image size
@@ -12,6 +22,74 @@ struct RenderSetting
     float rayDt{0.01}; // Raymarch step size
     float expK{0.02};  // What is this?
 
+    // Image tiling. Tiles are scheduled dynamically in tileOrder.
+    unsigned  tileSize{32};
+    TileOrder tileOrder{TileOrder::Spiral};
+
+    // Evaluate the volumes through compiled VolumePrograms
+    bool compileVolumes{false};
+
+    // Bake all volumes into a dense grid with this many voxels along its
+    // longest side before rendering (0: evaluate the volumes directly)
+    unsigned bakeResolution{0};
+    // Keep dense bakes as files in this directory and map them back in
+    // when the same volumes are baked again, e.g. by a later run (empty:
+    // always bake)
+    std::string bakeCacheDir;
+    // Or bake them into a sparse voxel tree with voxels of this size
+    // (0: off). Takes precedence over bakeResolution.
+    float bakeVoxelSize{0};
+
+    // Only march the parts of a ray that overlap the volume bounds
+    bool clipToBounds{true};
+    // and, within them, skip the empty cells of an occupancy grid with
+    // this many cells along its longest side (0: off)
+    unsigned occupancyResolution{32};
+    // and drop the parts of the remaining segments that interval bounds
+    // prove empty, halving them down to cullMinSteps steps. Not done for
+    // baked volumes: a grid sample costs about as much as bounding it.
+    bool     intervalCulling{true};
+    unsigned cullMinSteps{16};
+
+    // Color the volumes through a grid of their blended colors with this
+    // many nodes along its longest side (0: every volume is white)
+    unsigned colorResolution{0};
+
+    // Add a wisp of this many particles to the scene, splatted into a
+    // sparse grid with voxels of wispVoxelSize (0 particles: no wisp)
+    unsigned wispParticles{0};
+    float    wispVoxelSize{0.01};
+
+    // Single scattering from the scene lights, with the transmittance to
+    // each light looked up in a deep shadow map of shadowResolution nodes
+    // along its longest side
+    bool     lighting{false};
+    unsigned shadowResolution{64};
+
+    // Early ray termination: stop marching once the accumulated opacity
+    // (1 - transmittance) reaches opacityThreshold, e.g. 0.99. With
+    // russianRoulette the ray instead survives with probability
+    // rouletteSurvival (and its transmittance is scaled up to stay
+    // unbiased). The default of 1 leaves it off, rays march to the end.
+    float opacityThreshold{1};
+    bool  russianRoulette{false};
+    float rouletteSurvival{0.5};
+
+    // March CIEL_PACKET_WIDTH neighbouring rays together in SIMD lanes
+    bool usePackets{false};
+
+    // Render coarse to fine: passes over every tile sampling every 8th,
+    // 4th, 2nd and finally every pixel, each pixel sampled once. Until a
+    // pass reaches it, a pixel shows the nearest sample of the last pass.
+    // The final image is the same as without.
+    bool progressive{false};
+
+    // Number of render threads (0: let OpenMP decide)
+    unsigned numThreads{0};
+
+    // Print progress messages to stdout
+    bool verbose{true};
+
     // Returns size of the pixmap.
     // Currently: width * height * 4(rgba)
     unsigned pixmapSize() const { return renderW * renderH * 4; }
@@ -0,0 +1,164 @@
+#include "renderThread.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace ciel {
+
+RenderThread::RenderThread(Scene::Ptr scene, bool streamTiles)
+: m_streamTiles(streamTiles)
+{
+    m_renderer.setScene(std::move(scene));
+    m_renderer.setCancelFlag(&m_cancel);
+    if (m_streamTiles) {
+        m_renderer.setTileCallback([this](const Tile&               tile,
+                                          unsigned                  stride,
+                                          const std::vector<float>& pixmap) {
+            (void)stride; // every pass is shown
+            streamTile(tile, pixmap);
+        });
+    }
+    else {
+        // the streamed tiles show the coarse passes already
+        m_renderer.setPassCallback(
+            [this](unsigned stride, const std::vector<float>& pixmap) {
+                publishPass(stride, pixmap);
+            });
+    }
+    m_thread = std::thread(&RenderThread::loop, this);
+}
+
+RenderThread::~RenderThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_cancel = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+void RenderThread::request(const RenderSetting& setting)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending = setting;
+        m_cancel = true;
+        m_tiles.clear();
+    }
+    m_wake.notify_one();
+}
+
+void RenderThread::takeTiles(std::vector<TileUpdate>& tiles)
+{
+    tiles.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    tiles.swap(m_tiles);
+}
+
+bool RenderThread::takeFrame(std::vector<float>& pixmap,
+                             unsigned&           width,
+                             unsigned&           height,
+                             RenderStats*        outStats)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_frontNew) {
+        return false;
+    }
+    m_frontNew = false;
+    pixmap.swap(m_front);
+    width = m_frontW;
+    height = m_frontH;
+    if (outStats) {
+        *outStats = m_frontStats;
+    }
+    return true;
+}
+
+bool RenderThread::busy() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_rendering || m_pending;
+}
+
+void RenderThread::loop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this] { return m_stop || m_pending; });
+        if (m_stop) {
+            break;
+        }
+        const RenderSetting setting = *m_pending;
+        m_pending.reset();
+        // a request() from here on cancels this render
+        m_cancel = false;
+        m_rendering = true;
+        m_renderW = setting.renderW;
+        m_renderH = setting.renderH;
+        lock.unlock();
+
+        bool rendered = true;
+        try {
+            m_renderer.Render(setting);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[ciel][render] " << e.what() << std::endl;
+            rendered = false;
+        }
+
+        lock.lock();
+        m_rendering = false;
+        // the streamed tiles showed it already, nobody takes the frame
+        if (rendered && !m_renderer.getLastRenderStats().cancelled &&
+            !m_streamTiles) {
+            m_renderer.swapLastRender(m_front);
+            m_frontW = setting.renderW;
+            m_frontH = setting.renderH;
+            m_frontStats = m_renderer.getLastRenderStats();
+            m_frontNew = true;
+        }
+    }
+}
+
+void RenderThread::publishPass(unsigned                  stride,
+                               const std::vector<float>& pixmap)
+{
+    // the final pass is swapped in by loop() instead
+    if (stride == 1) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_cancel) {
+        m_front = pixmap;
+        m_frontW = m_renderW;
+        m_frontH = m_renderH;
+        m_frontNew = true;
+    }
+}
+
+void RenderThread::streamTile(const Tile&               tile,
+                              const std::vector<float>& pixmap)
+{
+    // converted here, in parallel, so the display only copies bytes
+    TileUpdate update;
+    update.tile = tile;
+    update.imageW = m_renderW;
+    update.imageH = m_renderH;
+    update.rgba.resize((size_t)tile.pixelCount() * 4);
+    uint8_t* out = update.rgba.data();
+    for (unsigned j = tile.y0; j < tile.y1; j++) {
+        const float* row = &pixmap[((size_t)j * m_renderW + tile.x0) * 4];
+        for (size_t c = 0; c < (size_t)tile.width() * 4; c++) {
+            *out++ = (uint8_t)(std::clamp(row[c], 0.f, 1.f) * 255.f + 0.5f);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_cancel) {
+        m_tiles.push_back(std::move(update));
+    }
+}
+
+} // namespace ciel
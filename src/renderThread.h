@@ -0,0 +1,112 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Renders on a worker thread so the caller (the window)
+//  stays responsive.
+//
+//  request() hands over the settings of the next render and
+//  cancels the one in flight: Renderer stops at the next
+//  tile, and the worker starts over with the newest
+//  settings, requests made meanwhile are dropped.
+//
+//  Pixels are double buffered. The worker renders into the
+//  back buffer and swaps it to the front when the render
+//  completes (a cancelled one never shows), takeFrame()
+//  swaps the front out to the caller, so neither side
+//  waits for the other except to swap.
+//
+//  With tile streaming on, each tile is converted to RGBA8
+//  as it completes and queued for takeTiles() instead, to
+//  show renders progressively, and no front is kept.
+//  Without it, the coarse passes of a progressive render
+//  are copied to the front, the only time a whole pixmap
+//  is copied.
+//
+// -------------------------------------------------------
+
+#include "renderSetting.h"
+#include "renderer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace ciel {
+
+// A completed tile of a render, see RenderThread::takeTiles()
+struct TileUpdate
+{
+    Tile                 tile;
+    unsigned             imageW{0}; // of the render it belongs to
+    unsigned             imageH{0};
+    std::vector<uint8_t> rgba; // RGBA8, tightly packed rows like the pixmap
+};
+
+class RenderThread
+{
+public:
+    // Renders `scene`, or the built-in scene if nullptr. With `streamTiles`
+    // the tiles are queued for takeTiles() as they complete.
+    explicit RenderThread(Scene::Ptr scene = nullptr, bool streamTiles = false);
+    // Cancels the render in flight and waits for the worker
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // Renders with `setting` next, cancelling the render in flight
+    void request(const RenderSetting& setting);
+    // If a render completed since the last call, swaps its pixels into
+    // `pixmap` (what was in there is reused as a buffer), sets its size and
+    // stats and returns true. Always false with tile streaming on.
+    bool takeFrame(std::vector<float>& pixmap,
+                   unsigned&           width,
+                   unsigned&           height,
+                   RenderStats*        outStats = nullptr);
+    // Moves the tiles completed since the last call into `tiles`, oldest
+    // first. Tiles of a render that was cancelled before they completed are
+    // dropped.
+    void takeTiles(std::vector<TileUpdate>& tiles);
+    // A render is requested or in flight
+    bool busy() const;
+
+private:
+    void loop();
+    // the tile callback of m_renderer, on the render threads
+    void streamTile(const Tile& tile, const std::vector<float>& pixmap);
+    // the pass callback of m_renderer without tile streaming: a coarse pass
+    // of a progressive render is copied to the front (the final one is
+    // swapped there by loop())
+    void publishPass(unsigned stride, const std::vector<float>& pixmap);
+
+    Renderer   m_renderer; // the worker's only
+    const bool m_streamTiles;
+
+    mutable std::mutex           m_mutex;
+    std::condition_variable      m_wake;
+    std::optional<RenderSetting> m_pending;
+    std::atomic<bool>            m_cancel{false};
+    bool                         m_rendering{false};
+    bool                         m_stop{false};
+
+    // see streamTile(), the size is set before each render
+    std::vector<TileUpdate> m_tiles;
+    unsigned                m_renderW{0};
+    unsigned                m_renderH{0};
+
+    // the last completed render
+    std::vector<float> m_front;
+    unsigned           m_frontW{0};
+    unsigned           m_frontH{0};
+    RenderStats        m_frontStats;
+    bool               m_frontNew{false};
+
+    std::thread m_thread;
+};
+
+} // namespace ciel
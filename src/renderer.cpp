@@ -7,15 +7,84 @@
 #include <iostream>
 #include <print>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif // _OPENMP
+
 namespace ciel {
 
+namespace {
+
+// Uniform random number in [0, 1) from a pixel seed and a step index
+float hashRandom(uint32_t seed, uint32_t step)
+{
+    uint32_t h = seed * 747796405u + step * 2891336453u + 1u;
+    h = ((h >> ((h >> 28u) + 4u)) ^ h) * 277803737u;
+    h = (h >> 22u) ^ h;
+    return (h >> 8) * (1.f / (1u << 24));
+}
+
+// Early ray termination, called once the ray is opaque enough.
+// Returns false when the ray should stop. A ray surviving Russian roulette
+// has its transmittance scaled by 1 / survival probability.
+bool surviveTermination(float&               T,
+                        uint32_t             seed,
+                        size_t               step,
+                        const RenderSetting& setting)
+{
+    if (!setting.russianRoulette) {
+        return false;
+    }
+    if (hashRandom(seed, (uint32_t)step) >= setting.rouletteSurvival) {
+        T = 0;
+        return false;
+    }
+    T /= setting.rouletteSurvival;
+    return true;
+}
+
+} // namespace
+
 void Renderer::Render(const RenderSetting& setting)
 {
-    // Init Scene
+    using Clock = std::chrono::steady_clock;
+    using Seconds = std::chrono::duration<double>;
+
+    // Init Scene. The scene persists across renders and reuses whatever it
+    // built for volumes that did not change.
+    const auto sceneStartTime = Clock::now();
     if (m_scene == nullptr) {
         m_scene = Scene::create();
     }
+    m_scene->setWisp(setting.wispParticles, setting.wispVoxelSize);
     m_scene->init(setting.renderW, setting.renderH);
+    m_scene->compileVolumes(setting.compileVolumes);
+    if (setting.bakeVoxelSize > 0) {
+        if (!m_scene->bakeVolumesSparse(setting.bakeVoxelSize)) {
+            std::cerr << "[ciel][render] Volumes are unbounded, skip baking"
+                      << std::endl;
+        }
+    }
+    else if (setting.bakeResolution > 0) {
+        if (!m_scene->bakeVolumes(setting.bakeResolution,
+                                  setting.bakeCacheDir)) {
+            std::cerr << "[ciel][render] Volumes are unbounded, skip baking"
+                      << std::endl;
+        }
+    }
+    else {
+        m_scene->clearBake();
+    }
+    m_scene->updateColors(setting.colorResolution);
+    m_scene->updateOccupancy(setting.clipToBounds ? setting.occupancyResolution
+                                                  : 0);
+    if (setting.lighting) {
+        // same extinction per unit length as the camera rays
+        m_scene->updateShadows(setting.shadowResolution,
+                               setting.expK / setting.rayDt);
+    }
+    m_stats.sceneSeconds = Seconds(Clock::now() - sceneStartTime).count();
+    m_scene->resetPagedStats();
 
     // Occupy vector storage
     m_pixmap.resize(setting.pixmapSize());
@@ -25,78 +94,499 @@ void Renderer::Render(const RenderSetting& setting)
                           m_scene->getCamera()->nearPlane()) /
                          setting.rayDt; // total sample N
 
-    std::println("[ciel][render] Start Rendering...");
-    auto startTime = std::chrono::system_clock::now();
+#ifdef _OPENMP
+    const int nThreads = setting.numThreads > 0 ? (int)setting.numThreads
+                                                : omp_get_max_threads();
+#else
+    const int nThreads = 1;
+#endif // _OPENMP
+    m_stats.numThreads = nThreads;
+
+    if (setting.verbose) {
+        std::println("[ciel][render] Start Rendering...");
+    }
+    const auto startTime = Clock::now();
+
+    // Render! Tiles are handed out one at a time, so threads that hit
+    // empty regions of the image simply pick up more tiles.
+    const std::vector<Tile> tiles = makeTiles(
+        setting.renderW, setting.renderH, setting.tileSize, setting.tileOrder);
+    m_stats.tileStats.assign(tiles.size(), TileStats{});
+    m_stats.passSeconds.clear();
+    std::atomic<bool> cancelled{false};
 
-    // Render!
+    // Progressive passes go over the same tiles, each pass only samples
+    // the pixels the coarser ones did not.
+    const unsigned firstStride = setting.progressive ? kProgressiveStride : 1;
+    for (unsigned stride = firstStride; stride > 0 && !cancelled;
+         stride /= 2) {
+        const bool refine = stride < firstStride;
+
+#ifdef _OPENMP
+#pragma omp parallel for default(none)                                         \
+    shared(setting, nSteps, tiles, cancelled, stride, refine)                  \
+    num_threads(nThreads) schedule(dynamic, 1)
+#endif // _OPENMP
+        for (size_t t = 0; t < tiles.size(); t++) {
+            // an OpenMP loop cannot break, the remaining tiles are skipped
+            if (m_cancel && m_cancel->load(std::memory_order_relaxed)) {
+                cancelled.store(true, std::memory_order_relaxed);
+                continue;
+            }
+            const auto tileStartTime = Clock::now();
+
+            const MarchCounters counters = renderTile(
+                tiles[t], nSteps, setting, stride, refine);
+            if (m_tileCallback) {
+                m_tileCallback(tiles[t], stride, m_pixmap);
+            }
+
+            TileStats& tileStats = m_stats.tileStats[t];
+            tileStats.tile = tiles[t];
+            tileStats.skippedSteps += counters.skippedSteps;
+            tileStats.clippedSteps += counters.clippedSteps;
+            tileStats.seconds += Seconds(Clock::now() - tileStartTime).count();
 #ifdef _OPENMP
-#pragma omp parallel for default(none) shared(setting, nSteps, m_pixmap)
+            tileStats.thread = omp_get_thread_num();
 #endif // _OPENMP
-    for (size_t j = 0; j < setting.renderH; j++) {
-        for (size_t i = 0; i < setting.renderW; i++) {
+        }
+
+        if (!cancelled) {
+            m_stats.passSeconds.push_back(
+                Seconds(Clock::now() - startTime).count());
+            if (m_passCallback) {
+                m_passCallback(stride, m_pixmap);
+            }
+        }
+    }
+
+    m_stats.renderSeconds = Seconds(Clock::now() - startTime).count();
+    m_stats.cancelled = cancelled.load();
+    m_stats.totalSteps = (size_t)nSteps * setting.renderW * setting.renderH;
+    m_stats.skippedSteps = 0;
+    m_stats.clippedSteps = 0;
+    for (const TileStats& tileStats : m_stats.tileStats) {
+        m_stats.skippedSteps += tileStats.skippedSteps;
+        m_stats.clippedSteps += tileStats.clippedSteps;
+    }
+    const VolumeScalarPagedGrid::CacheStats paged = m_scene->pagedStats();
+    m_stats.brickHits = paged.hits;
+    m_stats.brickMisses = paged.misses;
+    m_stats.brickPrefetched = paged.prefetched;
+    m_stats.brickEvictions = paged.evictions;
+    m_stats.brickBytesRead = paged.bytesRead;
+    if (setting.verbose) {
+        std::cout << "[ciel][render] Rendering complete. Elapsed: "
+                  << m_stats.renderSeconds << " seconds" << std::endl;
+    }
+}
+
+// In the rows the previous pass sampled, it took every other sample of
+// this one, starting at the corner
+MarchCounters Renderer::renderTile(const Tile&          tile,
+                                   const size_t         nSteps,
+                                   const RenderSetting& setting,
+                                   unsigned             stride,
+                                   bool                 refine)
+{
+    if (setting.usePackets) {
+        return renderTilePacket(tile, nSteps, setting, stride, refine);
+    }
+
+    MarchCounters counters;
+    for (size_t j = tile.y0; j < tile.y1; j += stride) {
+        const bool   sampled = refine && (j - tile.y0) % (2 * stride) == 0;
+        const size_t first = tile.x0 + (sampled ? stride : 0);
+        const size_t step = sampled ? 2 * stride : stride;
+        for (size_t i = first; i < tile.x1; i += step) {
             const Vector ray = m_scene->getCamera()->view(
                 (float)i / setting.renderW, (float)j / setting.renderH);
 
-            const Color c = RayMarch(ray, nSteps, setting);
+            const Color c = RayMarch(
+                ray, nSteps, setting, j * setting.renderW + i, &counters);
+
+            setBlock(i, j, stride, tile, setting.renderW, c);
+        }
+    }
+    return counters;
+}
+
+// Packs kPacketWidth samples of a row into one ray packet, adjacent
+// pixels unless progressive. The last packet of a row may be partial, its
+// extra lanes are masked off.
+MarchCounters Renderer::renderTilePacket(const Tile&          tile,
+                                         const size_t         nSteps,
+                                         const RenderSetting& setting,
+                                         unsigned             stride,
+                                         bool                 refine)
+{
+    MarchCounters counters;
+    for (size_t j = tile.y0; j < tile.y1; j += stride) {
+        const bool   sampled = refine && (j - tile.y0) % (2 * stride) == 0;
+        const size_t first = tile.x0 + (sampled ? stride : 0);
+        const size_t step = sampled ? 2 * stride : stride;
+        for (size_t i = first; i < tile.x1; i += step * kPacketWidth) {
+            const int nLanes = (int)std::min<size_t>(
+                kPacketWidth, (tile.x1 - i + step - 1) / step);
+
+            VectorP ray;
+            MaskP   active(false);
+            for (int l = 0; l < kPacketWidth; l++) {
+                const size_t x = i + std::min(l, nLanes - 1) * step;
+                ray.setLane(l,
+                            m_scene->getCamera()->view(
+                                (float)x / setting.renderW,
+                                (float)j / setting.renderH));
+                active[l] = l < nLanes;
+            }
+
+            const ColorP c = RayMarchPacket(ray,
+                                            nSteps,
+                                            setting,
+                                            active,
+                                            j * setting.renderW + i,
+                                            &counters,
+                                            step);
+
+            for (int l = 0; l < nLanes; l++) {
+                setBlock(
+                    i + l * step, j, stride, tile, setting.renderW, c.lane(l));
+            }
+        }
+    }
+    return counters;
+}
+
+void Renderer::setPixel(size_t i, size_t j, unsigned width, const Color& c)
+{
+    m_pixmap[(j * width + i) * 4 + 0] = c.X();
+    m_pixmap[(j * width + i) * 4 + 1] = c.Y();
+    m_pixmap[(j * width + i) * 4 + 2] = c.Z();
+    m_pixmap[(j * width + i) * 4 + 3] = c.W();
+}
+
+void Renderer::setBlock(size_t       i,
+                        size_t       j,
+                        unsigned     stride,
+                        const Tile&  tile,
+                        unsigned     width,
+                        const Color& c)
+{
+    const size_t x1 = std::min<size_t>(i + stride, tile.x1);
+    const size_t y1 = std::min<size_t>(j + stride, tile.y1);
+    for (size_t y = j; y < y1; y++) {
+        for (size_t x = i; x < x1; x++) {
+            setPixel(x, y, width, c);
+        }
+    }
+}
+
+namespace {
+
+// Appends the parts of [t0, t1] that interval bounds cannot prove empty,
+// halving the segment until a half is proven empty or is no longer than
+// minLength. Touching parts are merged.
+void cullSegment(const Scene&             scene,
+                 const Vector&            origin,
+                 const Vector&            direction,
+                 float                    t0,
+                 float                    t1,
+                 float                    minLength,
+                 std::vector<RaySegment>& outSegments)
+{
+    const Vector a = origin + direction * t0;
+    const Vector b = origin + direction * t1;
+    if (scene.isEmpty(BBox(a, a).unite(BBox(b, b)))) {
+        return;
+    }
+    if (t1 - t0 > minLength) {
+        const float mid = 0.5f * (t0 + t1);
+        cullSegment(scene, origin, direction, t0, mid, minLength, outSegments);
+        cullSegment(scene, origin, direction, mid, t1, minLength, outSegments);
+        return;
+    }
+    if (!outSegments.empty() && outSegments.back().t1 >= t0) {
+        outSegments.back().t1 = t1;
+    }
+    else {
+        outSegments.push_back(RaySegment{t0, t1});
+    }
+}
+
+// segments before culling, reused across rays of a render thread
+thread_local std::vector<RaySegment> tUnculledSegments;
+
+} // namespace
 
-            m_pixmap[(j * setting.renderW + i) * 4 + 0] = c.X();
-            m_pixmap[(j * setting.renderW + i) * 4 + 1] = c.Y();
-            m_pixmap[(j * setting.renderW + i) * 4 + 2] = c.Z();
-            m_pixmap[(j * setting.renderW + i) * 4 + 3] = c.W();
+// Step j of a ray samples t = nearPlane + (j + 1) * rayDt. Appends the step
+// ranges overlapping the scene's volume bounds, padded by one step on each
+// side, and returns the number of steps they add. With intervalCulling the
+// parts of those that are provably empty are dropped first.
+size_t Renderer::appendStepRanges(const Vector&            ray,
+                                  const size_t             nSteps,
+                                  const RenderSetting&     setting,
+                                  std::vector<StepRange>&  outRanges,
+                                  std::vector<RaySegment>& segments) const
+{
+    if (!setting.clipToBounds) {
+        outRanges.push_back(StepRange{0, nSteps});
+        return nSteps;
+    }
+
+    const float tNear = m_scene->getCamera()->nearPlane();
+    const float tFar = m_scene->getCamera()->farPlane();
+    const Vector eye = m_scene->getCamera()->eye();
+    if (setting.intervalCulling && !m_scene->isBaked()) {
+        std::vector<RaySegment>& unculled = tUnculledSegments;
+        m_scene->clipRay(eye, ray, tNear, tFar, unculled);
+        segments.clear();
+        const float minLength = setting.cullMinSteps * setting.rayDt;
+        for (const RaySegment& segment : unculled) {
+            cullSegment(*m_scene,
+                        eye,
+                        ray,
+                        segment.t0,
+                        segment.t1,
+                        minLength,
+                        segments);
         }
     }
+    else {
+        m_scene->clipRay(eye, ray, tNear, tFar, segments);
+    }
 
-    auto endTime = std::chrono::system_clock::now();
-    auto elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(
-                           endTime - startTime)
-                           .count();
-    std::cout << "[ciel][render] Rendering complete. Elapsed: "
-              << elapsedTime / 1000.0 << " seconds" << std::endl;
+    size_t count = 0;
+    for (const RaySegment& segment : segments) {
+        const float  s0 = std::floor((segment.t0 - tNear) / setting.rayDt);
+        const float  s1 = std::ceil((segment.t1 - tNear) / setting.rayDt);
+        const size_t begin = s0 > 1 ? (size_t)s0 - 1 : 0;
+        const size_t end = std::min(nSteps, (size_t)std::max(s1 + 1, 0.f));
+        if (begin >= end) {
+            continue;
+        }
+        // the padding can make neighbouring ranges overlap, a step must
+        // not be marched twice
+        if (!outRanges.empty() && begin <= outRanges.back().end &&
+            begin >= outRanges.back().begin) {
+            if (end > outRanges.back().end) {
+                count += end - outRanges.back().end;
+                outRanges.back().end = end;
+            }
+        }
+        else {
+            outRanges.push_back(StepRange{begin, end});
+            count += end - begin;
+        }
+    }
+    return count;
 }
 
+namespace {
+
+// sorts the ranges and merges the overlapping ones
+void mergeStepRanges(std::vector<StepRange>& ranges)
+{
+    if (ranges.size() < 2) {
+        return;
+    }
+    std::sort(ranges.begin(),
+              ranges.end(),
+              [](const StepRange& a, const StepRange& b) {
+                  return a.begin < b.begin;
+              });
+    size_t n = 0;
+    for (size_t i = 1; i < ranges.size(); i++) {
+        if (ranges[i].begin <= ranges[n].end) {
+            ranges[n].end = std::max(ranges[n].end, ranges[i].end);
+        }
+        else {
+            ranges[++n] = ranges[i];
+        }
+    }
+    ranges.resize(n + 1);
+}
+
+// scratch buffers, reused across rays of a render thread
+thread_local std::vector<StepRange>  tStepRanges;
+thread_local std::vector<RaySegment> tRaySegments;
+
+// number of consecutive steps of a ray evaluated by one Scene::evalBatch()
+constexpr size_t kMarchBatch = 16;
+
+} // namespace
+
 // ------------------------------------------------
 //  Where "Volume Rendering" happens
 // ------------------------------------------------
 Color Renderer::RayMarch(const Vector&        ray,
                          const size_t         nSteps,
-                         const RenderSetting& setting)
+                         const RenderSetting& setting,
+                         uint32_t             seed,
+                         MarchCounters*       outCounters)
 {
-    Vector xp = m_scene->getCamera()->eye() +
-                ray * m_scene->getCamera()->nearPlane(); // first position
-    Color L(0, 0, 0, 1); // color attenuated by length (init. black)
-    float T = 1;         // total transmissity
+    const Vector start = m_scene->getCamera()->eye() +
+                         ray * m_scene->getCamera()->nearPlane();
+    const Vector step = ray * setting.rayDt;
+    Color        L(0, 0, 0, 1); // color attenuated by length (init. black)
+    float        T = 1;         // total transmissity
+
+    // only march where the volumes are
+    std::vector<StepRange>& ranges = tStepRanges;
+    ranges.clear();
+    size_t remaining = appendStepRanges(
+        ray, nSteps, setting, ranges, tRaySegments);
+    if (outCounters) {
+        outCounters->clippedSteps += nSteps - remaining;
+    }
 
     // Iteratively running over the steps [0, 1 ... nSteps]
     // solve Kajuya's Rendering Equation:
     //    [INTEGRAL](s) * K * Color(P) * Density(P) * Transmissity(P)
-    for (size_t j = 0; j < nSteps; j++) {
-        // prepare variables
-        float density = 0.0;
-        Color cx;
+    // The scene is evaluated kMarchBatch steps at a time.
+    Vector points[kMarchBatch];
+    float  densities[kMarchBatch];
+    Color  colors[kMarchBatch];
+    bool   terminated = false;
+    for (size_t r = 0; r < ranges.size() && !terminated; r++) {
+        for (size_t j0 = ranges[r].begin; j0 < ranges[r].end && !terminated;
+             j0 += kMarchBatch) {
+            const size_t n = std::min(kMarchBatch, ranges[r].end - j0);
 
-        // 1. Compute X(p,s)
-        xp += ray * setting.rayDt;
+            // 1. Compute X(p,s)
+            for (size_t b = 0; b < n; b++) {
+                points[b] = start + step * (float)(j0 + b + 1);
+            }
 
-        // 2. Density(X)    * Important Step!
-        m_scene->eval(xp, density, cx);
-        density = density < std::numeric_limits<float>::epsilon() // masking
-                      ? 0
-                      : 1; // density;
-        // try to stay exp(K), 0 < K < ds
-        const float dt = exp(-1.f * setting.expK * density);
+            // 2. Density(X)    * Important Step!
+            m_scene->evalBatch(std::span<const Vector>(points, n),
+                               std::span<float>(densities, n),
+                               std::span<Color>(colors, n));
 
-        // 3. Color(X)
-        if (density > 0) {
-            L += cx * (1 - dt) * T;
-        }
+            for (size_t b = 0; b < n; b++) {
+                const size_t j = j0 + b;
+                const Color& cx = colors[b];
+                remaining--;
 
-        // 4. Transmissity
-        T *= dt;
+                const float eps = std::numeric_limits<float>::epsilon();
+                const float density = densities[b] < eps ? 0 : 1; // masking
+                // try to stay exp(K), 0 < K < ds
+                const float dt = exp(-1.f * setting.expK * density);
+
+                // 3. Color(X), lit by one shadow map lookup per light
+                if (density > 0) {
+                    const Color c = setting.lighting
+                                        ? cx * m_scene->illuminate(points[b])
+                                        : cx;
+                    L += c * (1 - dt) * T;
+                }
+
+                // 4. Transmissity
+                T *= dt;
+
+                // 5. Early termination, the rest barely contributes
+                if (1 - T >= setting.opacityThreshold &&
+                    !surviveTermination(T, seed, j, setting)) {
+                    if (outCounters) {
+                        outCounters->skippedSteps += remaining;
+                    }
+                    terminated = true;
+                    break;
+                }
+            }
+        }
     }
     L[3] = 1 - T;
     return L; // return final L (color)
 }
 
+// SIMD packet version of RayMarch()
+ColorP Renderer::RayMarchPacket(const VectorP&       ray,
+                                const size_t         nSteps,
+                                const RenderSetting& setting,
+                                MaskP                active,
+                                uint32_t             seed,
+                                MarchCounters*       outCounters,
+                                uint32_t             seedStride)
+{
+    const VectorP start = ray * m_scene->getCamera()->nearPlane() +
+                          m_scene->getCamera()->eye();
+    const VectorP step = ray * setting.rayDt;
+    ColorP        L(Color(0, 0, 0, 1)); // color attenuated by length
+    FloatP        T = 1.f;              // total transmissity
+
+    // march the union of the lanes' ranges
+    std::vector<StepRange>& ranges = tStepRanges;
+    ranges.clear();
+    for (int l = 0; l < kPacketWidth; l++) {
+        if (active[l]) {
+            appendStepRanges(
+                ray.lane(l), nSteps, setting, ranges, tRaySegments);
+        }
+    }
+    mergeStepRanges(ranges);
+
+    size_t remaining = 0;
+    for (const StepRange& range : ranges) {
+        remaining += range.end - range.begin;
+    }
+    if (outCounters) {
+        outCounters->clippedSteps += (nSteps - remaining) *
+                                     popcount(active);
+    }
+
+    for (size_t r = 0; r < ranges.size() && any_of(active); r++) {
+        for (size_t j = ranges[r].begin; j < ranges[r].end; j++) {
+            FloatP density = 0.f;
+            ColorP cx;
+            remaining--;
+
+            // 1. Compute X(p,s)
+            const VectorP xp = start + step * (float)(j + 1);
+
+            // 2. Density(X)
+            m_scene->evalPacket(xp, density, cx);
+            const MaskP occupied = density >=
+                                   std::numeric_limits<float>::epsilon();
+            density = select(occupied, 1.f, 0.f); // masking
+            const FloatP dt = stdx::exp(-1.f * setting.expK * density);
+
+            // 3. Color(X)
+            if (setting.lighting && any_of(occupied && active)) {
+                cx = cx * m_scene->illuminatePacket(xp);
+            }
+            L.addMasked(occupied && active, cx * ((1.f - dt) * T));
+
+            // 4. Transmissity
+            where(active, T) *= dt;
+
+            // 5. Early termination, lane by lane
+            const MaskP opaque = active &&
+                                 (1.f - T >= setting.opacityThreshold);
+            if (any_of(opaque)) {
+                for (int l = 0; l < kPacketWidth; l++) {
+                    if (!opaque[l]) {
+                        continue;
+                    }
+                    float lT = T[l];
+                    if (!surviveTermination(
+                            lT, seed + l * seedStride, j, setting)) {
+                        active[l] = false;
+                        if (outCounters) {
+                            outCounters->skippedSteps += remaining;
+                        }
+                    }
+                    T[l] = lT;
+                }
+                if (none_of(active)) {
+                    break;
+                }
+            }
+        }
+    }
+    L[3] = 1.f - T;
+    return L;
+}
+
 // Parallel (OpenMP) version of RayMarch()
 Color Renderer::RayMarchOMP(const Vector&        ray,
                             const size_t         nSteps,
@@ -2,34 +2,169 @@
 
 #include "renderSetting.h"
 #include "scene.h"
+#include "tile.h"
 
+#include <atomic>
+#include <functional>
 #include <stdint.h>
 #include <vector>
 
 namespace ciel {
 
+// Step bookkeeping of RayMarch(), summed over rays
+struct MarchCounters
+{
+    size_t skippedSteps{0}; // cut by early ray termination
+    size_t clippedSteps{0}; // outside every volume bound
+};
+
+// Range [begin, end) of step indices along a ray
+struct StepRange
+{
+    size_t begin, end;
+};
+
+// Timing of a single tile
+struct TileStats
+{
+    Tile   tile;
+    double seconds{0};
+    int    thread{0};
+    size_t skippedSteps{0}; // steps saved by early ray termination
+    size_t clippedSteps{0}; // steps saved by volume bounds
+};
+
+// Timing of the last Render() call
+struct RenderStats
+{
+    double   sceneSeconds{0};  // scene initialization
+    double   renderSeconds{0}; // ray marching
+    unsigned numThreads{1};    // threads used for ray marching
+    bool     cancelled{false}; // stopped early, the pixmap is incomplete
+
+    // since the start of ray marching, when each pass was complete (one
+    // pass unless progressive)
+    std::vector<double> passSeconds;
+
+    size_t totalSteps{0};   // steps of a full march over every pixel
+    size_t skippedSteps{0}; // steps saved by early ray termination
+    size_t clippedSteps{0}; // steps saved by volume bounds
+
+    // brick cache of the paged volumes while marching
+    size_t brickHits{0};
+    size_t brickMisses{0};
+    size_t brickPrefetched{0};
+    size_t brickEvictions{0};
+    size_t brickBytesRead{0};
+
+    std::vector<TileStats> tileStats; // in scheduling order
+};
+
 class Renderer
 {
 public:
+    // Called with the pixmap as each tile is done, from the render threads
+    // and so concurrently. The pixels of the tile are done for the pass of
+    // `stride` (see RenderSetting::progressive, 1 is the final pass), the
+    // rest of the pixmap may be in the middle of being written.
+    using TileCallback = std::function<void(
+        const Tile& tile, unsigned stride, const std::vector<float>& pixmap)>;
+    // Called by Render() with the pixmap as each pass completes
+    using PassCallback =
+        std::function<void(unsigned stride, const std::vector<float>& pixmap)>;
+    // Sample spacing of the first progressive pass
+    static constexpr unsigned kProgressiveStride = 8;
+
     // Main render logic
     void Render(const RenderSetting& setting);
 
+    // `seed` drives Russian roulette (the pixel index is used), the steps
+    // saved by clipping and early termination are added to `outCounters`.
     [[nodiscard]] Color RayMarch(const Vector&        ray,
                                  const size_t         nSteps,
-                                 const RenderSetting& setting);
+                                 const RenderSetting& setting,
+                                 uint32_t             seed = 0,
+                                 MarchCounters*       outCounters = nullptr);
+    // Marches kPacketWidth rays at once. Lanes off in `active` are ignored,
+    // lane l uses seed + l * seedStride.
+    [[nodiscard]] ColorP
+    RayMarchPacket(const VectorP&       ray,
+                   const size_t         nSteps,
+                   const RenderSetting& setting,
+                   MaskP                active,
+                   uint32_t             seed = 0,
+                   MarchCounters*       outCounters = nullptr,
+                   uint32_t             seedStride = 1);
     [[nodiscard]] Color RayMarchOMP(const Vector&        ray,
                                     const size_t         nSteps,
                                     const RenderSetting& setting);
 
+    // The scene rendered, created with the built-in modeling by the first
+    // Render() unless set before
+    void              setScene(Scene::Ptr scene) { m_scene = std::move(scene); }
+    const Scene::Ptr& scene() const { return m_scene; }
+    // nullptr for none
+    void setTileCallback(TileCallback callback)
+    {
+        m_tileCallback = std::move(callback);
+    }
+    // nullptr for none
+    void setPassCallback(PassCallback callback)
+    {
+        m_passCallback = std::move(callback);
+    }
+    // Render() checks `flag` before each tile and skips the rest of the
+    // image once it is set, see RenderStats::cancelled. nullptr for none.
+    void setCancelFlag(const std::atomic<bool>* flag) { m_cancel = flag; }
+
     // Returns a copy of last rendered pixels
     [[nodiscard]] std::vector<float> getLastRender() const
     {
         return std::vector<float>(m_pixmap);
     }
+    // Exchanges the pixmap with `pixmap` instead of copying it. The next
+    // Render() resizes whatever it gets back.
+    void swapLastRender(std::vector<float>& pixmap) { m_pixmap.swap(pixmap); }
+    [[nodiscard]] const RenderStats& getLastRenderStats() const
+    {
+        return m_stats;
+    }
 
 private:
-    Scene::Ptr         m_scene;
-    std::vector<float> m_pixmap;
+    // Samples the pixels of `tile` at multiples of `stride` from its
+    // corner, except those a previous pass of twice the stride sampled
+    // with `refine`. Each sample fills the stride x stride block it is the
+    // corner of.
+    MarchCounters renderTile(const Tile&          tile,
+                             const size_t         nSteps,
+                             const RenderSetting& setting,
+                             unsigned             stride = 1,
+                             bool                 refine = false);
+    MarchCounters renderTilePacket(const Tile&          tile,
+                                   const size_t         nSteps,
+                                   const RenderSetting& setting,
+                                   unsigned             stride,
+                                   bool                 refine);
+    size_t        appendStepRanges(const Vector&            ray,
+                                   const size_t             nSteps,
+                                   const RenderSetting&     setting,
+                                   std::vector<StepRange>&  outRanges,
+                                   std::vector<RaySegment>& segments) const;
+    void setPixel(size_t i, size_t j, unsigned width, const Color& c);
+    // setPixel() over the stride x stride block at (i, j), within `tile`
+    void setBlock(size_t       i,
+                  size_t       j,
+                  unsigned     stride,
+                  const Tile&  tile,
+                  unsigned     width,
+                  const Color& c);
+
+    Scene::Ptr               m_scene;
+    std::vector<float>       m_pixmap;
+    RenderStats              m_stats;
+    TileCallback             m_tileCallback;
+    PassCallback             m_passCallback;
+    const std::atomic<bool>* m_cancel{nullptr};
 };
 
-} // namespace ciel
\ No newline at end of file
+} // namespace ciel
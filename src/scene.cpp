@@ -38,7 +38,6 @@
  *        - AABB is always at fixed point even though they are transformed.
  *        - Also, what if gridfield is unioned with other objects..? typecasting
  *          would not work.
- *        - ColorField is not working
  *
  ************************************************************************************/
 
@@ -46,7 +45,15 @@
 
 #include "math/color.h"
 #include "math/vector.h"
+#include "volume/volumeProgram.h"
 #include "volume/volumeScalarSphere.h"
+#include "volume/volumeScalarWisp.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <limits>
 
 namespace ciel {
 
@@ -58,114 +65,700 @@ namespace ciel {
 void Scene::eval(const Vector& p, float& outDensity, Color& outColor)
 {
     // initialize
-    Color comp(0, 0, 0, 0);
     float density = 0.0;
 
+    // the color grid already holds the blended colors
+    outColor = mColorGrid ? mColorGrid->eval(p) : Color(1, 1, 1, 1);
+
+    // baked grid already holds the summed density
+    if (mBakedVolume) {
+        const float val = mBakedVolume->eval(p);
+        outDensity = val < 0 ? 0 : val;
+        return;
+    }
+
     // collect eval()
     for (size_t i = 0; i < mVolumes.size(); i++) {
         // collect density
         const float val = mVolumes[i]->eval(p);
         density += val < 0 ? 0 : val;
-
-        // collect color
-        // if (colorMap &&
-        //     std::dynamic_pointer_cast<ColorGrid>(colorMap)->isReady())
-        //     comp += colorMap->eval(p);
-        // else
-        //     comp += mVolumes[i]->Color() / (float)mVolumes.size();
     }
 
     // return back
     outDensity = density;
-    outColor = Color(1, 1, 1, 1); // comp;
 };
 
+// SIMD packet version of eval()
+void Scene::evalPacket(const VectorP& p, FloatP& outDensity, ColorP& outColor)
+{
+    FloatP density = 0.f;
+    if (mBakedVolume) {
+        density = stdx::max(mBakedVolume->evalPacket(p), FloatP(0.f));
+    }
+    for (size_t i = 0; i < mVolumes.size() && !mBakedVolume; i++) {
+        const FloatP val = mVolumes[i]->evalPacket(p);
+        density += stdx::max(val, FloatP(0.f));
+    }
+
+    outDensity = density;
+    if (mColorGrid) {
+        for (int i = 0; i < kPacketWidth; i++) {
+            outColor.setLane(i, mColorGrid->eval(p.lane(i)));
+        }
+    }
+    else {
+        outColor = ColorP(Color(1, 1, 1, 1));
+    }
+}
+
+namespace {
+
+// one volume's values in evalBatch(), reused across calls of a thread
+thread_local std::vector<float> tVolumeValues;
+
+} // namespace
+
+void Scene::evalBatch(std::span<const Vector> p,
+                      std::span<float>        outDensity,
+                      std::span<Color>        outColor)
+{
+    if (mColorGrid) {
+        mColorGrid->evalBatch(p, outColor);
+    }
+    else {
+        std::fill(outColor.begin(), outColor.end(), Color(1, 1, 1, 1));
+    }
+
+    if (mBakedVolume) {
+        mBakedVolume->evalBatch(p, outDensity);
+        for (float& density : outDensity) {
+            density = density < 0 ? 0 : density;
+        }
+        return;
+    }
+
+    std::fill(outDensity.begin(), outDensity.end(), 0.f);
+    tVolumeValues.resize(p.size());
+    const std::span<float> values(tVolumeValues.data(), p.size());
+    for (const VolumeScalar::Ptr& volume : mVolumes) {
+        volume->evalBatch(p, values);
+        for (size_t i = 0; i < p.size(); i++) {
+            outDensity[i] += values[i] < 0 ? 0 : values[i];
+        }
+    }
+}
+
 // ------------------------------------------------
 //  Where "Volume Modeling" happens
 // ------------------------------------------------
+
+namespace {
+
+// palette of the volumes and lights
+constexpr Color pink_cocktail(1, 0.305, 0.313, 1);
+constexpr Color heart_orange(0.985, 0.568, 0.227, 1);
+constexpr Color above_yellow(0.971, 0.831, 0.137, 1);
+constexpr Color blue_green(0.27, 0.678, 0.658, 1);
+
+constexpr Color love_red(0.815, 0.0941, 0.2117, 1);
+constexpr Color love_orange(0.972, 0.349, 0.192, 1);
+constexpr Color love_yellow(0.929, 0.349, 0.725, 1);
+constexpr Color love_green(0.639, 0.662, 0.725, 1);
+constexpr Color love_blue(0, 0.6, 0.725, 1);
+constexpr Color love_purple(0.364, 0.2549, 0.341, 1);
+
+} // namespace
 void Scene::initVolume()
 {
-    VolumeScalar::Ptr sphere1 = VolumeScalarSphere::create(Vector(-0.5, 0, 0),
-                                                           0.5);
-    VolumeScalar::Ptr sphere2 = VolumeScalarSphere::create(Vector(0.5, 0, 0),
-                                                           0.5);
-    mVolumes.push_back(sphere1);
-    mVolumes.push_back(sphere2);
+    std::vector<VolumeScalar::Ptr> volumes;
+    std::vector<Color>             colors;
+    if (mSceneFile) {
+        volumes = mSceneFile->volumes;
+        colors = mSceneFile->colors;
+    }
+    else {
+        VolumeScalar::Ptr sphere1 = VolumeScalarSphere::create(
+            Vector(-0.5, 0, 0), 0.5);
+        VolumeScalar::Ptr sphere2 = VolumeScalarSphere::create(
+            Vector(0.5, 0, 0), 0.5);
+        volumes = {sphere1, sphere2};
+        colors = {pink_cocktail, love_blue};
+    }
+
+    // smoke rising off the spheres, splatted in initMap()
+    if (mWispParticles > 0) {
+        Wisp wisp;
+        wisp.center = Vector(0, 0.6, 0);
+        wisp.radius = 0.5;
+        wisp.count = mWispParticles;
+        wisp.density = 0.5;
+        wisp.clump = 0.5;
+        wisp.displacement = 0.4;
+        wisp.noise.frequency = 2;
+        wisp.noise.octaves = 3;
+        volumes.push_back(VolumeScalarWisp::create(wisp, mWispVoxelSize));
+        colors.push_back(above_yellow);
+    }
+    setVolumes(std::move(volumes), std::move(colors));
 };
 
 // Axis Aligned Bounding Box(AABB) Checking
 // returns true if box is hit, false if no intersection
 // precondition: origin / direction of the ray
-// bool Scene::AABBCheck(const Vector &o, const Vector &d) const
-// {
-//     // scalar grids
-//     for (size_t i = 0; i < mVolumes.size(); i++) {
-//         if (std::dynamic_pointer_cast<const ScalarGrid>(
-//                 mVolumes[i]->getScalarField())) {
-//             return std::dynamic_pointer_cast<const ScalarGrid>(
-//                        mVolumes[i]->getScalarField())
-//                 ->checkAABB(o, d);
-//         }
-//         // TODO::vector grids
-//         // else if()
-//     }
-// }
+bool Scene::AABBCheck(const Vector& o, const Vector& d) const
+{
+    for (const BBox& bound : mBounds) {
+        float t0 = 0;
+        float t1 = std::numeric_limits<float>::infinity();
+        if (bound.intersectRay(o, d, t0, t1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Intersects the ray with every volume bound and merges the overlaps
+void Scene::clipRayBounds(const Vector&            o,
+                          const Vector&            d,
+                          float                    tNear,
+                          float                    tFar,
+                          std::vector<RaySegment>& outSegments) const
+{
+    outSegments.clear();
+    for (const BBox& bound : mBounds) {
+        float t0 = tNear;
+        float t1 = tFar;
+        if (bound.intersectRay(o, d, t0, t1)) {
+            outSegments.push_back(RaySegment{t0, t1});
+        }
+    }
+    if (outSegments.size() < 2) {
+        return;
+    }
+
+    std::sort(outSegments.begin(),
+              outSegments.end(),
+              [](const RaySegment& a, const RaySegment& b) {
+                  return a.t0 < b.t0;
+              });
+    size_t n = 0;
+    for (size_t i = 1; i < outSegments.size(); i++) {
+        if (outSegments[i].t0 <= outSegments[n].t1) {
+            outSegments[n].t1 = std::max(outSegments[n].t1, outSegments[i].t1);
+        }
+        else {
+            outSegments[++n] = outSegments[i];
+        }
+    }
+    outSegments.resize(n + 1);
+}
+
+namespace {
+
+// scratch buffer of clipRay(), reused across rays of a render thread
+thread_local std::vector<RaySegment> tBoundSegments;
+
+} // namespace
+
+void Scene::clipRay(const Vector&            o,
+                    const Vector&            d,
+                    float                    tNear,
+                    float                    tFar,
+                    std::vector<RaySegment>& outSegments) const
+{
+    if (!mOccupancy.isBuilt()) {
+        clipRayBounds(o, d, tNear, tFar, outSegments);
+    }
+    else {
+        clipRayBounds(o, d, tNear, tFar, tBoundSegments);
+        outSegments.clear();
+        mOccupancy.clipRay(o, d, tBoundSegments, outSegments);
+    }
+    if (!mBakedVolume) {
+        for (const VolumeScalarPagedGrid::Ptr& paged : mPagedVolumes) {
+            for (const RaySegment& segment : outSegments) {
+                paged->prefetch(o, d, segment.t0, segment.t1);
+            }
+        }
+    }
+}
+
+VolumeScalarPagedGrid::CacheStats Scene::pagedStats() const
+{
+    VolumeScalarPagedGrid::CacheStats sum;
+    for (const VolumeScalarPagedGrid::Ptr& paged : mPagedVolumes) {
+        const VolumeScalarPagedGrid::CacheStats stats = paged->stats();
+        sum.hits += stats.hits;
+        sum.misses += stats.misses;
+        sum.prefetched += stats.prefetched;
+        sum.evictions += stats.evictions;
+        sum.bytesRead += stats.bytesRead;
+        sum.residentBytes += stats.residentBytes;
+    }
+    return sum;
+}
+
+void Scene::resetPagedStats()
+{
+    for (const VolumeScalarPagedGrid::Ptr& paged : mPagedVolumes) {
+        paged->resetStats();
+    }
+}
+
+// A program hashes like its source, so switching does not invalidate the
+// cached scene data
+void Scene::compileVolumes(bool compile)
+{
+    for (VolumeScalar::Ptr& volume : mVolumes) {
+        const auto program = std::dynamic_pointer_cast<VolumeScalarProgram>(
+            volume);
+        if (compile && !program) {
+            volume = VolumeScalarProgram::create(volume);
+        }
+        else if (!compile && program) {
+            volume = program->source();
+        }
+    }
+}
+
+bool Scene::isEmpty(const BBox& box) const
+{
+    if (mBakedVolume) {
+        return mBakedVolume->evalInterval(box).hi <= 0;
+    }
+    for (const VolumeScalar::Ptr& volume : mVolumes) {
+        if (volume->evalInterval(box).hi > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Scene::updateOccupancy(unsigned resolution)
+{
+    if (resolution == 0) {
+        mOccupancy.clear();
+        return;
+    }
+    if (!mOccupancyDirty && mOccupancy.isBuilt() &&
+        mOccupancy.resolution() == resolution) {
+        return;
+    }
+
+    BBox bound;
+    for (const BBox& volumeBound : mBounds) {
+        bound = bound.unite(volumeBound);
+    }
+    mOccupancy.build([this](const BBox& box) { return !isEmpty(box); },
+                     bound,
+                     resolution);
+    mOccupancyDirty = false;
+}
+
+void Scene::updateColors(unsigned resolution)
+{
+    if (resolution == 0) {
+        mColorGrid.reset();
+        return;
+    }
+    if (!mColorsDirty && mColorGrid && mColorResolution == resolution) {
+        return;
+    }
+
+    BBox bound;
+    for (const BBox& volumeBound : mVolumeBounds) {
+        bound = bound.unite(volumeBound);
+    }
+    if (bound.isEmpty() || bound.isInfinite()) {
+        mColorGrid.reset();
+        return;
+    }
+    mColorGrid = VolumeColorGrid::bake(
+        mVolumes, mVolumeColors, GridLayout::fromResolution(bound, resolution));
+    mColorResolution = resolution;
+    mColorsDirty = false;
+}
+
+void Scene::updateShadows(unsigned resolution, float extinction)
+{
+    if (!mShadowsDirty && mShadowResolution == resolution &&
+        mShadowExtinction == extinction) {
+        return;
+    }
+
+    BBox bound;
+    for (const BBox& volumeBound : mBounds) {
+        bound = bound.unite(volumeBound);
+    }
+    const Light::DensityFn density = [this](const Vector& p) {
+        float density = 0;
+        Color color;
+        eval(p, density, color);
+        return density;
+    };
+    for (const Light::Ptr& light : mLights) {
+        light->bakeShadow(density, bound, resolution, extinction);
+    }
+    mShadowResolution = resolution;
+    mShadowExtinction = extinction;
+    mShadowsDirty = false;
+}
+
+Color Scene::illuminate(const Vector& p) const
+{
+    Color result(0, 0, 0, 1);
+    for (const Light::Ptr& light : mLights) {
+        result += light->radiance(p);
+    }
+    result[3] = 1;
+    return result;
+}
+
+ColorP Scene::illuminatePacket(const VectorP& p) const
+{
+    ColorP result;
+    for (int l = 0; l < kPacketWidth; l++) {
+        result.setLane(l, illuminate(p.lane(l)));
+    }
+    return result;
+}
+
+namespace {
+
+// Inside, the same density as eval(): the sum of the positive parts.
+// Outside, keep the (negative) closest value so that interpolation puts
+// the surface where it belongs instead of growing it by a voxel.
+float bakeDensity(std::span<const VolumeScalar::Ptr> volumes, const Vector& p)
+{
+    float density = 0.0;
+    float outside = std::numeric_limits<float>::lowest();
+    for (const VolumeScalar::Ptr& volume : volumes) {
+        const float val = volume->eval(p);
+        density += val < 0 ? 0 : val;
+        outside = std::max(outside, val);
+    }
+    return density > 0 ? density : outside;
+}
+
+// bakeDensity() of the volumes as a volume, for writePaged()
+class VolumeScalarBake : public VolumeScalar
+{
+public:
+    explicit VolumeScalarBake(std::span<const VolumeScalar::Ptr> volumes)
+    : m_volumes(volumes)
+    {
+    }
+
+    float eval(const Vector& p) const override
+    {
+        return bakeDensity(m_volumes, p);
+    }
+
+private:
+    std::span<const VolumeScalar::Ptr> m_volumes;
+};
+
+} // namespace
+
+uint64_t Scene::bakeHash(unsigned resolution) const
+{
+    uint64_t hash = hashCombine(hashString("bakeVolumes"),
+                                (uint64_t)resolution);
+    for (const VolumeScalar::Ptr& volume : mVolumes) {
+        hash = hashCombine(hash, volume->hash());
+    }
+    return hash;
+}
+
+bool Scene::bakeVolumes(unsigned resolution, const std::string& cacheDir)
+{
+    if (mBakedVolume && mBakedResolution == resolution) {
+        return true;
+    }
+
+    BBox bound;
+    for (const BBox& volumeBound : mVolumeBounds) {
+        bound = bound.unite(volumeBound);
+    }
+    if (bound.isEmpty() || bound.isInfinite()) {
+        return false;
+    }
+
+    // a bake of the same volumes at the same resolution from an earlier run
+    const uint64_t key = bakeHash(resolution);
+    std::string    cachePath;
+    if (!cacheDir.empty()) {
+        char name[32];
+        std::snprintf(
+            name, sizeof(name), "%016llx.cvol", (unsigned long long)key);
+        cachePath = (std::filesystem::path(cacheDir) / name).string();
+        if (std::filesystem::exists(cachePath)) {
+            VolumeScalarMappedGrid::Ptr mapped = VolumeScalarMappedGrid::open(
+                cachePath);
+            if (mapped && mapped->sourceHash() == key) {
+                setBakedVolume(mapped, resolution, 0);
+                return true;
+            }
+        }
+    }
+
+    VolumeScalarGrid::Ptr grid = VolumeScalarGrid::create(
+        GridLayout::fromResolution(bound, resolution));
+    grid->fill([this](const Vector& p) { return bakeDensity(mVolumes, p); });
+
+    if (!cachePath.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(cacheDir, error);
+        VolumeScalarMappedGrid::write(cachePath, *grid, key);
+    }
+    setBakedVolume(grid, resolution, 0);
+    return true;
+}
+
+bool Scene::writePaged(const std::string& path, unsigned resolution) const
+{
+    BBox bound;
+    for (const BBox& volumeBound : mVolumeBounds) {
+        bound = bound.unite(volumeBound);
+    }
+    if (bound.isEmpty() || bound.isInfinite()) {
+        std::cerr << "[ciel][scene] Cannot page unbounded volumes"
+                  << std::endl;
+        return false;
+    }
+    const GridLayout layout = GridLayout::fromResolution(bound, resolution);
+    return VolumeScalarPagedGrid::write(
+        path, VolumeScalarBake(mVolumes), layout, bakeHash(resolution));
+}
+
+bool Scene::bakeVolumesSparse(float voxelSize)
+{
+    if (mBakedVolume && mBakedVoxelSize == voxelSize) {
+        return true;
+    }
+
+    // stamp() combines the volumes the same way as bakeVolumes()
+    VolumeScalarSparseGrid::Ptr grid = VolumeScalarSparseGrid::create(
+        voxelSize);
+    for (const VolumeScalar::Ptr& volume : mVolumes) {
+        if (!grid->stamp(volume)) {
+            return false;
+        }
+    }
+
+    setBakedVolume(grid, 0, voxelSize);
+    return true;
+}
+
+void Scene::setBakedVolume(VolumeScalar::Ptr volume,
+                           unsigned          resolution,
+                           float             voxelSize)
+{
+    mBakedVolume = std::move(volume);
+    mBakedResolution = resolution;
+    mBakedVoxelSize = voxelSize;
+    initBounds();
+    mOccupancyDirty = true;
+    mShadowsDirty = true;
+}
+
+void Scene::clearBake()
+{
+    if (!mBakedVolume) {
+        return;
+    }
+    setBakedVolume(nullptr, 0, 0);
+}
 
 void Scene::init(int imgX, int imgY)
 {
-    initCamera(imgX, imgY);
-    // setLight();
-    initVolume();
-    // setMap();
+    if (!mCam || imgX != mImageW || imgY != mImageH) {
+        initCamera(imgX, imgY);
+        mImageW = imgX;
+        mImageH = imgY;
+    }
+    if (!mModeled) {
+        initLight();
+        initVolume();
+        initMap();
+        mModeled = true;
+    }
+    refresh();
 }
 
 void Scene::update()
 {
-    mVolumes.clear();
-    // mLights.clear();
-
     initLight();
     initVolume();
     initMap();
 }
 
+bool Scene::refresh()
+{
+    bool changed = mVolumeHashes.size() != mVolumes.size();
+    mVolumeHashes.resize(mVolumes.size(), 0);
+    mVolumeBounds.resize(mVolumes.size());
+    for (size_t i = 0; i < mVolumes.size(); i++) {
+        const uint64_t hash = mVolumes[i]->hash();
+        if (hash == mVolumeHashes[i]) {
+            continue;
+        }
+        // a program holds the constants of its source at compile time
+        if (const auto program =
+                std::dynamic_pointer_cast<VolumeScalarProgram>(mVolumes[i])) {
+            mVolumes[i] = VolumeScalarProgram::create(program->source());
+        }
+        mVolumeHashes[i] = hash;
+        mVolumeBounds[i] = mVolumes[i]->bound();
+        changed = true;
+    }
+    if (changed) {
+        mPagedVolumes.clear();
+        for (const VolumeScalar::Ptr& volume : mVolumes) {
+            VolumeScalar::Ptr source = volume;
+            if (const auto program =
+                    std::dynamic_pointer_cast<VolumeScalarProgram>(volume)) {
+                source = program->source();
+            }
+            if (auto paged = std::dynamic_pointer_cast<VolumeScalarPagedGrid>(
+                    source)) {
+                mPagedVolumes.push_back(std::move(paged));
+            }
+        }
+        invalidateVolumes();
+    }
+    return changed;
+}
+
+void Scene::setVolumes(std::vector<VolumeScalar::Ptr> volumes,
+                       std::vector<Color>             colors)
+{
+    colors.resize(volumes.size(), Color(1, 1, 1, 1));
+    if (colors != mVolumeColors) {
+        mVolumeColors = std::move(colors);
+        mColorsDirty = true;
+    }
+
+    for (size_t i = 0; i < volumes.size() && i < mVolumes.size(); i++) {
+        if (volumes[i]->hash() == mVolumes[i]->hash()) {
+            volumes[i] = mVolumes[i];
+        }
+    }
+    mVolumes = std::move(volumes);
+    refresh();
+}
+
+void Scene::setLights(std::vector<Light::Ptr> lights)
+{
+    bool changed = lights.size() != mLights.size();
+    for (size_t i = 0; i < lights.size(); i++) {
+        if (i < mLights.size() && lights[i]->hash() == mLights[i]->hash()) {
+            lights[i] = mLights[i];
+        }
+        else {
+            changed = true;
+        }
+    }
+    mLights = std::move(lights);
+    if (changed) {
+        mShadowsDirty = true;
+    }
+}
+
+void Scene::setWisp(size_t particles, float voxelSize)
+{
+    if (particles != mWispParticles || voxelSize != mWispVoxelSize) {
+        mWispParticles = particles;
+        mWispVoxelSize = voxelSize;
+        mModeled = false;
+    }
+}
+
+void Scene::setSceneFile(SceneFile::ConstPtr file)
+{
+    mSceneFile = std::move(file);
+    mCam.reset();
+    mModeled = false;
+}
+
+void Scene::invalidateVolumes()
+{
+    mColorsDirty = true;
+    mBakedVolume.reset();
+    mBakedResolution = 0;
+    mBakedVoxelSize = 0;
+    initBounds();
+    mOccupancyDirty = true;
+    mShadowsDirty = true;
+}
+
 // sub method of init()
 // setup camera model
 void Scene::initCamera(int Nx, int Ny)
 {
-    // constexpr Vector  cameraOrigin = Vector(0, 1.8, -5);
-    constexpr Vector camOrigin(0, 0, -5);
-    constexpr Vector camUp(0, 1, 0);
-    constexpr float  camFov = 40.f;
-    Vector           camView = Vector(0, 0, 0) - camOrigin;
-    float            camAspectRatio = (float)Nx / Ny;
+    // the scene file's camera, or the built-in one
+    const CameraDescription cam = mSceneFile && mSceneFile->camera
+                                      ? *mSceneFile->camera
+                                      : CameraDescription{};
+    Vector camView = cam.target - cam.eye;
+    float  camAspectRatio = (float)Nx / Ny;
 
     // create camera
     mCam = Camera::create();
-    mCam->setEyeViewUp(camOrigin, camView, camUp);
+    mCam->setEyeViewUp(cam.eye, camView, cam.up);
     mCam->setAspectRatio(camAspectRatio);
-    mCam->setFov(camFov);
-    mCam->setNearPlane(0.1);
-    mCam->setFarPlane(10.0);
+    mCam->setFov(cam.fov);
+    mCam->setNearPlane(cam.nearPlane);
+    mCam->setFarPlane(cam.farPlane);
 }
 
 // sub method of init()
 // setup mLights
 void Scene::initLight()
 {
-    constexpr Color pink_cocktail(1, 0.305, 0.313, 1);
-    constexpr Color heart_orange(0.985, 0.568, 0.227, 1);
-    constexpr Color above_yellow(0.971, 0.831, 0.137, 1);
-    constexpr Color blue_green(0.27, 0.678, 0.658, 1);
+    if (mSceneFile) {
+        setLights(mSceneFile->lights);
+        return;
+    }
+    // warm key light from the upper left, cool fill from below
+    setLights({
+        Light::createDirectional(Vector(1, -1, 0.5), heart_orange, 0.9f),
+        Light::createPoint(Vector(0, -3, -2), blue_green, 0.5f),
+    });
+}
 
-    constexpr Color love_red(0.815, 0.0941, 0.2117, 1);
-    constexpr Color love_orange(0.972, 0.349, 0.192, 1);
-    constexpr Color love_yellow(0.929, 0.349, 0.725, 1);
-    constexpr Color love_green(0.639, 0.662, 0.725, 1);
-    constexpr Color love_blue(0, 0.6, 0.725, 1);
-    constexpr Color love_purple(0.364, 0.2549, 0.341, 1);
+// sub method of init()
+// splat the wisps into their grids, once per wisp
+void Scene::initMap()
+{
+    // the scene file's wisps may sit anywhere in its graph
+    if (mSceneFile) {
+        for (const VolumeScalarWisp::Ptr& wisp : mSceneFile->wisps) {
+            wisp->splat();
+        }
+    }
+    for (VolumeScalar::Ptr volume : mVolumes) {
+        if (const auto program =
+                std::dynamic_pointer_cast<VolumeScalarProgram>(volume)) {
+            volume = program->source();
+        }
+        if (const auto wisp = std::dynamic_pointer_cast<VolumeScalarWisp>(
+                volume)) {
+            wisp->splat();
+        }
+    }
 }
 
-void Scene::initMap() {}
+// bounds for ray clipping: the baked grid's, or the cached bound of every
+// volume
+void Scene::initBounds()
+{
+    if (mBakedVolume) {
+        mBounds.assign(1, mBakedVolume->bound());
+    }
+    else {
+        mBounds = mVolumeBounds;
+    }
+}
 
 } // namespace ciel
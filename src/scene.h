@@ -1,8 +1,19 @@
 #pragma once
 
 #include "camera.h"
+#include "light.h"
+#include "math/colorN.h"
+#include "occupancyGrid.h"
+#include "sceneFile.h"
 #include "volume/volumeBase.h"
+#include "volume/volumeColorGrid.h"
+#include "volume/volumeScalarGrid.h"
+#include "volume/volumeScalarMappedGrid.h"
+#include "volume/volumeScalarPagedGrid.h"
+#include "volume/volumeScalarSparseGrid.h"
 
+#include <span>
+#include <string>
 #include <vector>
 
 namespace ciel {
@@ -20,11 +31,96 @@ public:
 
     // Main eval funtion
     void eval(const Vector &p, float &outDensity, Color &outColor);
+    void evalPacket(const VectorP &p, FloatP &outDensity, ColorP &outColor);
+    // eval() over a batch of points, one evalBatch() call per volume
+    void evalBatch(std::span<const Vector> p,
+                   std::span<float>        outDensity,
+                   std::span<Color>        outColor);
 
-    // Scene initialization method
+    // Scene initialization method. The modeling only runs on the first
+    // call, later ones keep the scene and everything cached for it and
+    // only rebuild the camera if the image size changed and what depends
+    // on volumes that were edited since, see refresh().
     void init(int imgX, int imgY);
+    // Runs the modeling again. Volumes and lights equal to the ones already
+    // in the scene (by content hash) are kept with their cached data.
     void update();
+    // Re-hashes the volumes and rebuilds what depends on the ones whose
+    // content changed, e.g. after setRadius() on a sphere of the scene.
+    // Returns true if anything changed.
+    bool refresh();
+
+    // Replace the volumes or lights. Slot i keeps its current object, and
+    // what was derived from it, if the new one has the same content hash.
+    // Volumes without a color in `colors` are white.
+    void setVolumes(std::vector<VolumeScalar::Ptr> volumes,
+                    std::vector<Color>             colors = {});
+    void setLights(std::vector<Light::Ptr> lights);
+    // Particle count and voxel size of the wisp modeled into the scene, 0
+    // particles for none. Changing them models the scene again at the next
+    // init(), the wisp is splatted by initMap().
+    void setWisp(size_t particles, float voxelSize);
+    // Takes the volumes, lights and camera from a scene file instead of the
+    // built-in scene, nullptr goes back to it. Models the scene again at the
+    // next init().
+    void setSceneFile(SceneFile::ConstPtr file);
+
+    // Stamps the density of all volumes into one dense grid that eval()
+    // samples from then on. `resolution` is the number of voxels along the
+    // longest side of the volumes' bound. Returns false if the volumes are
+    // unbounded. The grid is kept until the volumes change, baking again
+    // with the same resolution reuses it.
+    // With a `cacheDir`, bakes are also kept there as files named by the
+    // content hash of the volumes and the resolution, and a bake already in
+    // it is mapped instead of baking again (see VolumeScalarMappedGrid).
+    bool bakeVolumes(unsigned resolution, const std::string &cacheDir = {});
+    // Same as bakeVolumes() but into a sparse voxel tree with voxels of
+    // `voxelSize`, so only the space near the volumes costs memory.
+    bool bakeVolumesSparse(float voxelSize);
+    // Writes the density of all volumes, as bakeVolumes() would bake it,
+    // into a brick file for VolumeScalarPagedGrid at `path`. Returns false
+    // if the volumes are unbounded or the file could not be written.
+    bool writePaged(const std::string &path, unsigned resolution) const;
+    // Goes back to evaluating the volumes themselves
+    void clearBake();
+    // Rebuilds the occupancy grid used by clipRay() if the volumes changed
+    // since the last build (init, update, baking) or the resolution is
+    // different. A resolution of 0 drops it.
+    void updateOccupancy(unsigned resolution);
+    // Bakes the volume colors, blended by density, into a color grid with
+    // `resolution` nodes along its longest side that eval() samples from
+    // then on. Only if the volumes or their colors changed since the last
+    // bake or the resolution is different. A resolution of 0 drops it and
+    // every sample is white.
+    void updateColors(unsigned resolution);
+    // Bakes the deep shadow map of every light over the volumes if they
+    // changed since the last call or the parameters are different, see
+    // Light::bakeShadow()
+    void updateShadows(unsigned resolution, float extinction);
+    // Light arriving at p from all lights, through their shadow maps
+    Color  illuminate(const Vector &p) const;
+    ColorP illuminatePacket(const VectorP &p) const;
+    // Replaces every volume by its compiled VolumeScalarProgram, or with
+    // `compile` false every compiled program by its source
+    void compileVolumes(bool compile = true);
     bool AABBCheck(const Vector &origin, const Vector &direction) const;
+    // True if interval bounds prove there is no density anywhere in `box`.
+    // False only means the box could not be ruled out.
+    bool isEmpty(const BBox &box) const;
+    bool isBaked() const { return mBakedVolume != nullptr; }
+    // Brick cache counters summed over the paged volumes of the scene
+    VolumeScalarPagedGrid::CacheStats pagedStats() const;
+    void                              resetPagedStats();
+
+    // Parts of the ray within [tNear, tFar] that overlap the volume bounds,
+    // or only the occupied cells of the occupancy grid once it is built,
+    // sorted and non-overlapping. Nothing outside them can have density.
+    // Queues the bricks of paged volumes along the segments for loading.
+    void clipRay(const Vector&            origin,
+                 const Vector&            direction,
+                 float                    tNear,
+                 float                    tFar,
+                 std::vector<RaySegment>& outSegments) const;
 
     // getter, setters
     Camera::Ptr getCamera() { return mCam; }
@@ -32,9 +128,9 @@ public:
     // {
     //     return mShapes[i];
     // } // might not need these anymore
-    // inline Light::Ptr getLight(int i) { return mLights[i]; }
+    inline Light::Ptr getLight(int i) { return mLights[i]; }
     // inline int        shapeSize() const { return mShapes.size(); }
-    // inline int        lightSize() const { return mLights.size(); }
+    inline int lightSize() const { return mLights.size(); }
 
     // inline void addShape(const Shape::Ptr &object)
     // {
@@ -54,15 +150,70 @@ private:
     // current frame count
     int mFrameCount;
 
+    // image size the camera was set up for
+    int mImageW{0};
+    int mImageH{0};
+    // modeling ran, see init()
+    bool mModeled{false};
+    // modeled instead of the built-in scene, see setSceneFile()
+    SceneFile::ConstPtr mSceneFile;
+    // wisp parameters, see setWisp()
+    size_t mWispParticles{0};
+    float  mWispVoxelSize{0};
+
     // vector that stores vector
     std::vector<VolumeScalar::Ptr> mVolumes;
-    // std::vector<Light::Ptr> mLights;
+    std::vector<uint64_t>          mVolumeHashes; // as of the last refresh()
+    std::vector<BBox>              mVolumeBounds; // world bound of each volume
+    std::vector<BBox>              mBounds;       // what clipRay() clips to
+    std::vector<Color>             mVolumeColors;
+    // the paged ones among mVolumes (or their compiled sources)
+    std::vector<VolumeScalarPagedGrid::Ptr> mPagedVolumes;
+
+    // colors of all volumes in one grid, see updateColors()
+    VolumeColorGrid::Ptr mColorGrid;
+    bool                 mColorsDirty{true};
+    unsigned             mColorResolution{0};
+
+    // all volumes stamped into one grid, see bakeVolumes(), and the
+    // parameters it was baked with
+    VolumeScalar::Ptr mBakedVolume;
+    unsigned          mBakedResolution{0};
+    float             mBakedVoxelSize{0};
+
+    // empty space skipping for clipRay(), see updateOccupancy()
+    OccupancyGrid mOccupancy;
+    bool          mOccupancyDirty{true};
+
+    // lights and the parameters of their shadow maps, see updateShadows()
+    std::vector<Light::Ptr> mLights;
+    bool                    mShadowsDirty{true};
+    unsigned                mShadowResolution{0};
+    float                   mShadowExtinction{0};
 
     // local initialize methods
     void initCamera(int Nx, int Ny); // init camera
     void initVolume();               // do modeling
     void initLight();                // set lights
     void initMap();                  // set grids
+    void initBounds();               // collect volume bounds
+
+    // drops everything derived from the volumes as a whole
+    void invalidateVolumes();
+    // makes `volume` what eval() samples, baked with these parameters
+    void setBakedVolume(VolumeScalar::Ptr volume,
+                        unsigned          resolution,
+                        float             voxelSize);
+
+    // the key of a bake of the volumes at `resolution`
+    uint64_t bakeHash(unsigned resolution) const;
+
+    // clipRay() against the volume bounds only
+    void clipRayBounds(const Vector&            origin,
+                       const Vector&            direction,
+                       float                    tNear,
+                       float                    tFar,
+                       std::vector<RaySegment>& outSegments) const;
 };
 
 } // namespace ciel
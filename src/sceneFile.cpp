@@ -0,0 +1,682 @@
+#include "sceneFile.h"
+
+#include "volume/volumeScalarBox.h"
+#include "volume/volumeScalarCSG.h"
+#include "volume/volumeScalarEllipse.h"
+#include "volume/volumeScalarNoise.h"
+#include "volume/volumeScalarPagedGrid.h"
+#include "volume/volumeScalarSphere.h"
+#include "volume/volumeScalarTorus.h"
+#include "volume/volumeScalarTransform.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace ciel {
+
+namespace {
+
+// Render settings a scene file can set, numbers only (0 / 1 for flags)
+struct SettingEntry
+{
+    std::string_view key;
+    void (*apply)(RenderSetting&, float);
+};
+
+constexpr SettingEntry kSettings[] = {
+    {"width", [](RenderSetting& s, float v) { s.renderW = (unsigned)v; }},
+    {"height", [](RenderSetting& s, float v) { s.renderH = (unsigned)v; }},
+    {"rayDt", [](RenderSetting& s, float v) { s.rayDt = v; }},
+    {"expK", [](RenderSetting& s, float v) { s.expK = v; }},
+    {"tileSize", [](RenderSetting& s, float v) { s.tileSize = (unsigned)v; }},
+    {"compile", [](RenderSetting& s, float v) { s.compileVolumes = v != 0; }},
+    {"bake", [](RenderSetting& s, float v) { s.bakeResolution = (unsigned)v; }},
+    {"bakeSparse", [](RenderSetting& s, float v) { s.bakeVoxelSize = v; }},
+    {"clip", [](RenderSetting& s, float v) { s.clipToBounds = v != 0; }},
+    {"occupancy",
+     [](RenderSetting& s, float v) { s.occupancyResolution = (unsigned)v; }},
+    {"cull", [](RenderSetting& s, float v) { s.intervalCulling = v != 0; }},
+    {"colors",
+     [](RenderSetting& s, float v) { s.colorResolution = (unsigned)v; }},
+    {"lighting", [](RenderSetting& s, float v) { s.lighting = v != 0; }},
+    {"shadowRes",
+     [](RenderSetting& s, float v) { s.shadowResolution = (unsigned)v; }},
+    {"opacityThreshold",
+     [](RenderSetting& s, float v) { s.opacityThreshold = v; }},
+    {"packets", [](RenderSetting& s, float v) { s.usePackets = v != 0; }},
+    {"progressive", [](RenderSetting& s, float v) { s.progressive = v != 0; }},
+};
+
+// Open addressing table of 32 bit indices by 64 bit hash. The entries
+// live with the caller, who tells ones with equal hashes apart. Scene files
+// define one node per line, so sizing it from the line count up front
+// avoids rehashing, and a flat array avoids a node allocation per entry.
+class IndexTable
+{
+public:
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+
+    void reserve(size_t count)
+    {
+        size_t capacity = 16;
+        while (capacity < count * 2) {
+            capacity *= 2;
+        }
+        if (capacity > m_slots.size()) {
+            rehash(capacity);
+        }
+    }
+
+    // Index of the entry with `hash` for which equal(index) holds, or
+    // kEmpty if there is none
+    template<typename Eq>
+    uint32_t find(uint64_t hash, Eq&& equal) const
+    {
+        for (size_t i = hash & m_mask;; i = (i + 1) & m_mask) {
+            const Slot& slot = m_slots[i];
+            if (slot.index == kEmpty) {
+                return kEmpty;
+            }
+            if (slot.hash == hash && equal(slot.index)) {
+                return slot.index;
+            }
+        }
+    }
+    // Adds an entry known not to be in the table yet
+    void insert(uint64_t hash, uint32_t index)
+    {
+        if ((m_size + 1) * 2 > m_slots.size()) {
+            rehash(std::max<size_t>(16, m_slots.size() * 2));
+        }
+        size_t i = hash & m_mask;
+        while (m_slots[i].index != kEmpty) {
+            i = (i + 1) & m_mask;
+        }
+        m_slots[i] = Slot{hash, index};
+        m_size++;
+    }
+
+private:
+    struct Slot
+    {
+        uint64_t hash{0};
+        uint32_t index{kEmpty};
+    };
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Slot> old(capacity);
+        old.swap(m_slots);
+        m_mask = capacity - 1;
+        m_size = 0;
+        for (const Slot& slot : old) {
+            if (slot.index != kEmpty) {
+                insert(slot.hash, slot.index);
+            }
+        }
+    }
+
+    std::vector<Slot> m_slots;
+    size_t            m_mask{0};
+    size_t            m_size{0};
+};
+
+class Parser
+{
+public:
+    Parser(std::string_view text, const std::string& name, RenderSetting* s)
+    : m_text(text)
+    , m_name(name)
+    , m_settings(s)
+    {
+    }
+
+    SceneFile::Ptr run()
+    {
+        m_scene = std::make_shared<SceneFile>();
+        const size_t lines = std::count(m_text.begin(), m_text.end(), '\n');
+        m_names.reserve(lines + 1);
+        m_nameIndex.reserve(lines + 1);
+        m_nodes.reserve(lines + 1);
+        m_nodeKeys.reserve(lines + 1);
+        m_nodeIndex.reserve(lines + 1);
+        while (nextLine()) {
+            statement();
+        }
+        m_scene->nodeCount = m_nodes.size();
+        return m_scene;
+    }
+
+private:
+    struct Token
+    {
+        std::string_view text;
+        size_t           column;
+    };
+
+    // Splits the next line into tokens. False at the end of the text.
+    bool nextLine()
+    {
+        while (m_pos < m_text.size()) {
+            size_t end = m_text.find('\n', m_pos);
+            if (end == std::string_view::npos) {
+                end = m_text.size();
+            }
+            const std::string_view line = m_text.substr(m_pos, end - m_pos);
+            m_pos = end + 1;
+            m_line++;
+
+            m_tokens.clear();
+            m_next = 0;
+            m_lineEnd = line.size() + 1;
+            for (size_t i = 0; i < line.size();) {
+                const char c = line[i];
+                if (c == '#') {
+                    m_lineEnd = i + 1;
+                    break;
+                }
+                if (c == ' ' || c == '\t' || c == '\r') {
+                    i++;
+                    continue;
+                }
+                size_t j = i;
+                while (j < line.size() && line[j] != ' ' && line[j] != '\t' &&
+                       line[j] != '\r' && line[j] != '#') {
+                    j++;
+                }
+                m_tokens.push_back(Token{line.substr(i, j - i), i + 1});
+                i = j;
+            }
+            if (!m_tokens.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    [[noreturn]] void fail(size_t column, const std::string& message) const
+    {
+        throw SceneFileError(m_name, m_line, column, message);
+    }
+    [[noreturn]] void fail(const Token& token, const std::string& message) const
+    {
+        fail(token.column, message);
+    }
+
+    bool atEnd() const { return m_next == m_tokens.size(); }
+
+    const Token& token(const char* what)
+    {
+        if (atEnd()) {
+            fail(m_lineEnd, std::string("expected ") + what);
+        }
+        return m_tokens[m_next++];
+    }
+    float number(const char* what)
+    {
+        const Token& t = token(what);
+        float        value = 0;
+        const char*  end = t.text.data() + t.text.size();
+        const auto [ptr, ec] = std::from_chars(t.text.data(), end, value);
+        if (ec != std::errc() || ptr != end) {
+            fail(t,
+                 std::string("expected ") + what + ", found '" +
+                     std::string(t.text) + "'");
+        }
+        return value;
+    }
+    float positive(const char* what)
+    {
+        const size_t column = m_tokens[std::min(m_next, m_tokens.size() - 1)]
+                                  .column;
+        const float value = number(what);
+        if (!(value > 0)) {
+            fail(column, std::string(what) + " must be positive");
+        }
+        return value;
+    }
+    // A whole number in [0, max]: "2.5" or "1e3" are rejected rather than
+    // truncated, and large counts keep every digit
+    uint64_t integer(const char* what, uint64_t max)
+    {
+        const Token& t = token(what);
+        uint64_t     value = 0;
+        const char*  end = t.text.data() + t.text.size();
+        const auto [ptr, ec] = std::from_chars(t.text.data(), end, value);
+        if (ptr != end || (ec != std::errc() &&
+                           ec != std::errc::result_out_of_range)) {
+            fail(t,
+                 std::string("expected ") + what + ", found '" +
+                     std::string(t.text) + "'");
+        }
+        if (ec == std::errc::result_out_of_range || value > max) {
+            fail(t, std::string(what) + " is too large");
+        }
+        return value;
+    }
+    uint64_t positiveInteger(const char* what, uint64_t max)
+    {
+        const size_t column = m_tokens[std::min(m_next, m_tokens.size() - 1)]
+                                  .column;
+        const uint64_t value = integer(what, max);
+        if (value == 0) {
+            fail(column, std::string(what) + " must be positive");
+        }
+        return value;
+    }
+    Vector vector(const char* what)
+    {
+        const float x = number(what);
+        const float y = number(what);
+        return Vector(x, y, number(what));
+    }
+    static uint64_t nameHash(std::string_view name)
+    {
+        return hashMix(hashString(name));
+    }
+    uint32_t findName(std::string_view name) const
+    {
+        return m_nameIndex.find(nameHash(name), [&](uint32_t i) {
+            return m_names[i].name == name;
+        });
+    }
+    // index in m_nodes of the node a name refers to
+    uint32_t nodeIndex()
+    {
+        const Token&   t = token("a volume name");
+        const uint32_t i = findName(t.text);
+        if (i == IndexTable::kEmpty) {
+            fail(t, "unknown volume '" + std::string(t.text) + "'");
+        }
+        return m_names[i].node;
+    }
+    const VolumeScalar::Ptr& node() { return m_nodes[nodeIndex()]; }
+    void expectEnd()
+    {
+        if (!atEnd()) {
+            fail(m_tokens[m_next],
+                 "unexpected '" + std::string(m_tokens[m_next].text) + "'");
+        }
+    }
+
+    void statement()
+    {
+        const Token& first = token("a statement");
+        if (m_tokens.size() > 1 && m_tokens[1].text == "=") {
+            m_next++;
+            define(first);
+        }
+        else if (first.text == "volume") {
+            volume();
+        }
+        else if (first.text == "light") {
+            light();
+        }
+        else if (first.text == "camera") {
+            camera();
+        }
+        else if (first.text == "set") {
+            setting();
+        }
+        else {
+            fail(first, "unknown statement '" + std::string(first.text) + "'");
+        }
+        expectEnd();
+    }
+
+    // What a node is built from: its type, the values given for it and the
+    // (already unique) nodes it is built on
+    struct NodeKey
+    {
+        static constexpr size_t kMaxValues = 8;
+
+        std::string_view                   type;
+        std::array<double, kMaxValues>     values{};
+        size_t                             valueCount{0};
+        std::array<const VolumeScalar*, 2> children{};
+        size_t                             childCount{0};
+        std::string                        path{}; // of a brick file
+
+        NodeKey& add(double value)
+        {
+            values[valueCount++] = value + 0.0; // -0 is 0
+            return *this;
+        }
+        NodeKey& add(const Vector& v)
+        {
+            return add(v.X()).add(v.Y()).add(v.Z());
+        }
+        NodeKey& add(const VolumeScalar::Ptr& child)
+        {
+            children[childCount++] = child.get();
+            return *this;
+        }
+
+        uint64_t hash() const
+        {
+            uint64_t h = hashString(type);
+            for (size_t i = 0; i < valueCount; i++) {
+                h = hashCombine(h, std::bit_cast<uint64_t>(values[i]));
+            }
+            for (size_t i = 0; i < childCount; i++) {
+                h = hashCombine(h, (uint64_t)(uintptr_t)children[i]);
+            }
+            return hashCombine(h, hashString(path));
+        }
+        bool operator==(const NodeKey&) const = default;
+    };
+
+    // Hash consing: a node is identified by its NodeKey, so equal subgraphs
+    // are found in constant time per node instead of by comparing whole
+    // subtrees. The hash only finds the candidates, a node is reused if its
+    // key is equal. Returns the index in m_nodes.
+    template<typename F>
+    uint32_t intern(const NodeKey& key, F&& make)
+    {
+        const uint64_t hash = key.hash();
+        uint32_t       i = m_nodeIndex.find(
+            hash, [&](uint32_t n) { return m_nodeKeys[n] == key; });
+        if (i == IndexTable::kEmpty) {
+            // make() may read nodes by reference, so only append after it
+            VolumeScalar::Ptr v = make();
+            i = (uint32_t)m_nodes.size();
+            m_nodes.push_back(std::move(v));
+            m_nodeKeys.push_back(key);
+            m_nodeIndex.insert(hash, i);
+        }
+        return i;
+    }
+
+    void define(const Token& name)
+    {
+        if (findName(name.text) != IndexTable::kEmpty) {
+            fail(name, "volume '" + std::string(name.text) + "' redefined");
+        }
+        const Token&           type = token("a volume type");
+        const std::string_view t = type.text;
+        uint32_t               result = 0;
+
+        if (t == "sphere") {
+            const Vector c = vector("a center");
+            const float  r = number("a radius");
+            result = intern(NodeKey{t}.add(c).add(r), [&] {
+                return VolumeScalarSphere::create(c, r);
+            });
+        }
+        else if (t == "box") {
+            const Vector c = vector("a center");
+            const Vector b = vector("a size");
+            const float  e = number("an exponent");
+            result = intern(NodeKey{t}.add(c).add(b).add(e), [&] {
+                return VolumeScalarBox::create(c, b, e);
+            });
+        }
+        else if (t == "ellipse" || t == "torus") {
+            const Vector  c = vector("a center");
+            const Vector  a = vector(t == "torus" ? "a normal" : "a stretch");
+            const float   r1 = number("a radius");
+            const float   r2 = number("a radius");
+            const NodeKey k = NodeKey{t}.add(c).add(a).add(r1).add(r2);
+            result = intern(k, [&]() -> VolumeScalar::Ptr {
+                if (t == "torus") {
+                    return VolumeScalarTorus::create(c, a, r1, r2);
+                }
+                return VolumeScalarEllipse::create(c, a, r1, r2);
+            });
+        }
+        else if (t == "union" || t == "intersection") {
+            // a b c ... folds into ((a b) c) ...
+            result = nodeIndex();
+            do {
+                const VolumeScalar::Ptr  a = m_nodes[result];
+                const VolumeScalar::Ptr& b = node();
+                const NodeKey            k = NodeKey{t}.add(a).add(b);
+                result = intern(k, [&]() -> VolumeScalar::Ptr {
+                    if (t == "union") {
+                        return std::make_shared<VolumeScalarUnion>(a, b);
+                    }
+                    return std::make_shared<VolumeScalarIntersection>(a, b);
+                });
+            } while (!atEnd());
+        }
+        else if (t == "cutout") {
+            const VolumeScalar::Ptr  a = node();
+            const VolumeScalar::Ptr& b = node();
+            result = intern(NodeKey{t}.add(a).add(b), [&] {
+                return std::make_shared<VolumeScalarCutout>(a, b);
+            });
+        }
+        else if (t == "shell") {
+            const VolumeScalar::Ptr& a = node();
+            const float              thickness = number("a thickness");
+            result = intern(NodeKey{t}.add(a).add(thickness), [&] {
+                return std::make_shared<VolumeScalarShell>(a, thickness);
+            });
+        }
+        else if (t == "translate") {
+            const VolumeScalar::Ptr& a = node();
+            const Vector             offset = vector("an offset");
+            result = intern(NodeKey{t}.add(a).add(offset), [&] {
+                return VolumeScalarTransform::createTranslation(a, offset);
+            });
+        }
+        else if (t == "rotate") {
+            const VolumeScalar::Ptr& a = node();
+            const size_t             axisToken = m_next;
+            const Vector             axis = vector("an axis");
+            const float              degrees = number("an angle");
+            if (axis.magnitude() == 0) {
+                fail(m_tokens[axisToken], "zero rotation axis");
+            }
+            result = intern(NodeKey{t}.add(a).add(axis).add(degrees), [&] {
+                return VolumeScalarTransform::createRotation(a, axis, degrees);
+            });
+        }
+        else if (t == "scale") {
+            const VolumeScalar::Ptr& a = node();
+            const float              factor = positive("a scale factor");
+            result = intern(NodeKey{t}.add(a).add(factor), [&] {
+                return VolumeScalarTransform::createScale(a, factor);
+            });
+        }
+        else if (t == "fbm" || t == "pyroclastic") {
+            const VolumeScalar::Ptr& a = node();
+            const float              amplitude = number("an amplitude");
+            NoiseParams              params;
+            params.frequency = number("a frequency");
+            params.octaves = (unsigned)positiveInteger("an octave count",
+                                                       UINT32_MAX);
+            params.seed = atEnd() ? 0 : (uint32_t)integer("a seed", UINT32_MAX);
+            const NodeKey k = NodeKey{t}
+                                  .add(a)
+                                  .add(amplitude)
+                                  .add(params.frequency)
+                                  .add(params.octaves)
+                                  .add(params.seed);
+            result = intern(k, [&] {
+                return t == "fbm" ? VolumeScalarNoise::createFBm(
+                                        a, amplitude, params)
+                                  : VolumeScalarNoise::createPyroclastic(
+                                        a, amplitude, params);
+            });
+        }
+        else if (t == "wisp") {
+            Wisp wisp;
+            wisp.center = vector("a center");
+            wisp.radius = positive("a radius");
+            wisp.count = (size_t)positiveInteger("a particle count", SIZE_MAX);
+            wisp.density = number("a density");
+            const float voxelSize = positive("a voxel size");
+            const NodeKey k = NodeKey{t}
+                                  .add(wisp.center)
+                                  .add(wisp.radius)
+                                  .add((double)wisp.count)
+                                  .add(wisp.density)
+                                  .add(voxelSize);
+            result = intern(k, [&] {
+                const VolumeScalarWisp::Ptr v = VolumeScalarWisp::create(
+                    wisp, voxelSize);
+                m_scene->wisps.push_back(v);
+                return v;
+            });
+        }
+        else if (t == "paged") {
+            // relative to the directory of the scene file
+            const Token&                path = token("a brick file");
+            const std::filesystem::path file = std::filesystem::path(m_name)
+                                                   .parent_path() /
+                                               path.text;
+            const float budget = positive("a cache budget in MiB");
+            NodeKey     k = NodeKey{t}.add(budget);
+            k.path = file.string();
+            result = intern(k, [&] {
+                const VolumeScalarPagedGrid::Ptr v =
+                    VolumeScalarPagedGrid::open(file.string(),
+                                                (size_t)(budget * (1 << 20)));
+                if (!v) {
+                    fail(path,
+                         "cannot open brick file '" + file.string() + "'");
+                }
+                return v;
+            });
+        }
+        else {
+            fail(type, "unknown volume type '" + std::string(t) + "'");
+        }
+        m_nameIndex.insert(nameHash(name.text), (uint32_t)m_names.size());
+        m_names.push_back(Name{name.text, result});
+    }
+
+    void volume()
+    {
+        const VolumeScalar::Ptr& v = node();
+        Color                    color(1, 1, 1, 1);
+        if (!atEnd()) {
+            const Vector rgb = vector("a color");
+            color = Color(rgb.X(), rgb.Y(), rgb.Z(), 1);
+        }
+        m_scene->volumes.push_back(v);
+        m_scene->colors.push_back(color);
+    }
+
+    void light()
+    {
+        const Token& type = token("point or directional");
+        if (type.text != "point" && type.text != "directional") {
+            fail(type,
+                 "expected point or directional, found '" +
+                     std::string(type.text) + "'");
+        }
+        const Vector p = vector(type.text == "point" ? "a position"
+                                                     : "a direction");
+        const Vector rgb = vector("a color");
+        const Color  color(rgb.X(), rgb.Y(), rgb.Z(), 1);
+        const float  intensity = atEnd() ? 1.f : number("an intensity");
+        m_scene->lights.push_back(
+            type.text == "point"
+                ? Light::createPoint(p, color, intensity)
+                : Light::createDirectional(p, color, intensity));
+    }
+
+    void camera()
+    {
+        CameraDescription cam = m_scene->camera.value_or(CameraDescription{});
+        do {
+            const Token& key = token("a camera parameter");
+            if (key.text == "eye") {
+                cam.eye = vector("a position");
+            }
+            else if (key.text == "target") {
+                cam.target = vector("a position");
+            }
+            else if (key.text == "up") {
+                cam.up = vector("a direction");
+            }
+            else if (key.text == "fov") {
+                cam.fov = positive("a field of view");
+            }
+            else if (key.text == "near") {
+                cam.nearPlane = positive("a distance");
+            }
+            else if (key.text == "far") {
+                cam.farPlane = positive("a distance");
+            }
+            else {
+                fail(key,
+                     "unknown camera parameter '" + std::string(key.text) +
+                         "'");
+            }
+        } while (!atEnd());
+        m_scene->camera = cam;
+    }
+
+    void setting()
+    {
+        const Token& key = token("a setting");
+        for (const SettingEntry& entry : kSettings) {
+            if (entry.key == key.text) {
+                const float value = number("a value");
+                if (value < 0) {
+                    fail(m_tokens[m_next - 1], "negative value");
+                }
+                if (m_settings) {
+                    entry.apply(*m_settings, value);
+                }
+                return;
+            }
+        }
+        fail(key, "unknown setting '" + std::string(key.text) + "'");
+    }
+
+    std::string_view   m_text;
+    const std::string& m_name;
+    RenderSetting*     m_settings;
+    SceneFile::Ptr     m_scene;
+
+    size_t             m_pos{0};
+    size_t             m_line{0};
+    size_t             m_lineEnd{0}; // column just past the last token
+    std::vector<Token> m_tokens;
+    size_t             m_next{0};
+
+    // defined names, pointing into m_text, and the node each refers to
+    struct Name
+    {
+        std::string_view name;
+        uint32_t         node;
+    };
+    std::vector<Name> m_names;
+    IndexTable        m_nameIndex;
+    // unique nodes and what they were built from, see intern()
+    std::vector<VolumeScalar::Ptr> m_nodes;
+    std::vector<NodeKey>           m_nodeKeys;
+    IndexTable                     m_nodeIndex;
+};
+
+} // namespace
+
+SceneFile::Ptr SceneFile::parse(std::string_view   text,
+                                const std::string& name,
+                                RenderSetting*     settings)
+{
+    return Parser(text, name, settings).run();
+}
+
+SceneFile::Ptr SceneFile::load(const std::string& path, RenderSetting* settings)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw SceneFileError(path, 0, 0, "cannot open the file");
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    return parse(text.str(), path, settings);
+}
+
+} // namespace ciel
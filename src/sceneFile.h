@@ -0,0 +1,115 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Text scene description.
+//
+//  One statement per line, '#' comments to the end of the
+//  line:
+//
+//    <name> = <type> <args...>   define a volume node
+//    volume <name> [r g b]       render a node, with a color
+//    light point|directional x y z r g b [intensity]
+//    camera eye x y z target x y z up x y z fov f near f far f
+//    set <setting> <value>       a RenderSetting
+//
+//  Node types (children are names defined above):
+//
+//    sphere      cx cy cz radius
+//    box         cx cy cz bx by bz exponent
+//    ellipse     cx cy cz sx sy sz radius1 radius2
+//    torus       cx cy cz nx ny nz radius1 radius2
+//    union / intersection  a b [c ...]
+//    cutout      a b
+//    shell       a thickness
+//    translate   a x y z
+//    rotate      a ax ay az degrees
+//    scale       a factor
+//    fbm / pyroclastic     a amplitude frequency octaves [seed]
+//    wisp        cx cy cz radius particles density voxelSize
+//    paged       path budgetMiB
+//                a brick file (see VolumeScalarPagedGrid), the
+//                path relative to the scene file
+//
+//  The file is parsed in a single pass straight into the
+//  volume graph. Identical subgraphs, whether named once
+//  and referenced or written out twice, become one node.
+//
+// -------------------------------------------------------
+
+#include "light.h"
+#include "renderSetting.h"
+#include "volume/volumeBase.h"
+#include "volume/volumeScalarWisp.h"
+
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ciel {
+
+// A scene file that does not parse. what() reads "name:line:column: message",
+// or "name: message" without a line.
+class SceneFileError : public std::runtime_error
+{
+public:
+    SceneFileError(const std::string& name,
+                   size_t             line,
+                   size_t             column,
+                   const std::string& message)
+    : std::runtime_error(
+          line == 0 ? name + ": " + message
+                    : name + ":" + std::to_string(line) + ":" +
+                          std::to_string(column) + ": " + message)
+    , mLine(line)
+    , mColumn(column)
+    {
+    }
+
+    size_t line() const { return mLine; }     // 1 based, 0 if none
+    size_t column() const { return mColumn; } // 1 based, 0 if none
+
+private:
+    size_t mLine;
+    size_t mColumn;
+};
+
+// The defaults are the built-in scene's camera
+struct CameraDescription
+{
+    Vector eye{0, 0, -5};
+    Vector target{0, 0, 0};
+    Vector up{0, 1, 0};
+    float  fov{40};
+    float  nearPlane{0.1};
+    float  farPlane{10};
+};
+
+struct SceneFile
+{
+    using Ptr = std::shared_ptr<SceneFile>;
+    using ConstPtr = std::shared_ptr<const SceneFile>;
+
+    std::vector<VolumeScalar::Ptr>     volumes;
+    std::vector<Color>                 colors; // one per volume
+    std::vector<Light::Ptr>            lights;
+    std::optional<CameraDescription>   camera;
+    // every wisp node, wherever it is in the graph, to be splatted before
+    // rendering (see Scene::initMap())
+    std::vector<VolumeScalarWisp::Ptr> wisps;
+    size_t                             nodeCount{0}; // after deduplication
+
+    // Parses scene text, `name` is what errors refer to it as. `set`
+    // statements are applied to `settings` if given and checked either way.
+    // Throws SceneFileError.
+    static Ptr parse(std::string_view   text,
+                     const std::string& name = "<scene>",
+                     RenderSetting*     settings = nullptr);
+    // Reads and parses the file at `path`
+    static Ptr load(const std::string& path, RenderSetting* settings = nullptr);
+};
+
+} // namespace ciel
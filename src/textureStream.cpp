@@ -0,0 +1,136 @@
+#include "textureStream.h"
+
+#ifdef __APPLE__
+#include <OpenGL/gl3.h> // macOS openGL library
+#endif
+
+#include <cstring>
+
+namespace ciel {
+
+TextureStream::TextureStream(size_t bufferBytes)
+: m_bufferBytes(bufferBytes)
+{
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glGenBuffers(kRingSize, m_buffers);
+    for (unsigned i = 0; i < kRingSize; i++) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[i]);
+        glBufferData(
+            GL_PIXEL_UNPACK_BUFFER, m_bufferBytes, nullptr, GL_STREAM_DRAW);
+        m_bufferSizes[i] = m_bufferBytes;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureStream::~TextureStream()
+{
+    glDeleteBuffers(kRingSize, m_buffers);
+    glDeleteTextures(1, &m_texture);
+}
+
+void TextureStream::push(std::vector<TileUpdate>& tiles)
+{
+    for (TileUpdate& tile : tiles) {
+        if (tile.imageW != m_width || tile.imageH != m_height) {
+            resize(tile.imageW, tile.imageH);
+        }
+        m_pending.push_back(std::move(tile));
+    }
+    tiles.clear();
+}
+
+size_t TextureStream::upload()
+{
+    if (m_pending.empty()) {
+        return 0;
+    }
+
+    // the tiles that fit in one buffer, at least one
+    size_t count = 0;
+    size_t bytes = 0;
+    while (count < m_pending.size() &&
+           (count == 0 ||
+            bytes + m_pending[count].rgba.size() <= m_bufferBytes)) {
+        bytes += m_pending[count].rgba.size();
+        count++;
+    }
+
+    const size_t slot = m_next;
+    m_next = (m_next + 1) % kRingSize;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[slot]);
+    if (bytes > m_bufferSizes[slot]) {
+        // a tile larger than this buffer, grow it once; later uploads
+        // through it reuse the storage
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        m_bufferSizes[slot] = bytes;
+    }
+    // invalidating lets the driver hand out fresh memory instead of waiting
+    // for a transfer from this buffer that is still in flight
+    char* mapped = static_cast<char*>(glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER,
+        0,
+        bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (!mapped) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return 0;
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        const std::vector<uint8_t>& rgba = m_pending[i].rgba;
+        std::memcpy(mapped + offset, rgba.data(), rgba.size());
+        offset += rgba.size();
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // texture row 0 is the bottom, as in the pixmap
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        const Tile& tile = m_pending[i].tile;
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        0,
+                        tile.x0,
+                        tile.y0,
+                        tile.width(),
+                        tile.height(),
+                        GL_RGBA,
+                        GL_UNSIGNED_BYTE,
+                        reinterpret_cast<const void*>(offset));
+        offset += m_pending[i].rgba.size();
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    m_pending.erase(m_pending.begin(), m_pending.begin() + count);
+    return count;
+}
+
+void TextureStream::resize(unsigned width, unsigned height)
+{
+    m_width = width;
+    m_height = height;
+    m_pending.clear();
+
+    // black until the tiles of the new size come in
+    const std::vector<uint8_t> black((size_t)width * height * 4, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_RGBA8,
+                 width,
+                 height,
+                 0,
+                 GL_RGBA,
+                 GL_UNSIGNED_BYTE,
+                 black.data());
+}
+
+} // namespace ciel
@@ -0,0 +1,67 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  The display texture of CielApp, updated tile by tile.
+//
+//  push() queues TileUpdates (RGBA8) from RenderThread,
+//  upload() copies as many as fit into the next pixel
+//  buffer object of a small ring and updates their
+//  rectangles with glTexSubImage2D from it. The copy to the
+//  texture then runs on the GL side from the buffer while
+//  the next frame fills another one, so the GL thread never
+//  waits on a transfer, and every upload call is bounded by
+//  one buffer.
+//
+//  Needs GL 3.0 (glMapBufferRange), Mesa's software
+//  rasterizers included.
+//
+// -------------------------------------------------------
+
+#include "renderThread.h"
+
+#include <GLFW/glfw3.h>
+#include <deque>
+#include <vector>
+
+namespace ciel {
+
+class TextureStream
+{
+public:
+    static constexpr unsigned kRingSize = 3;
+
+    // Creates the texture and buffers in the current GL context. Each upload
+    // moves at most `bufferBytes` (more if a single tile is larger).
+    explicit TextureStream(size_t bufferBytes = 4 << 20);
+    ~TextureStream();
+
+    TextureStream(const TextureStream&) = delete;
+    TextureStream& operator=(const TextureStream&) = delete;
+
+    // Queues the tiles, emptying `tiles`. A tile of another image size than
+    // the texture resizes it and drops the queued tiles of the old size.
+    void push(std::vector<TileUpdate>& tiles);
+    // Uploads queued tiles through the next buffer of the ring. Returns the
+    // number of tiles uploaded.
+    size_t upload();
+
+    GLuint   texture() const { return m_texture; }
+    unsigned width() const { return m_width; }
+    unsigned height() const { return m_height; }
+
+private:
+    void resize(unsigned width, unsigned height);
+
+    GLuint m_texture{0};
+    GLuint m_buffers[kRingSize]{};
+    size_t m_bufferSizes[kRingSize]{}; // allocated, grown by large tiles
+    size_t m_bufferBytes{0};           // filled per upload
+    size_t m_next{0};                  // buffer of the next upload
+
+    unsigned               m_width{0};
+    unsigned               m_height{0};
+    std::deque<TileUpdate> m_pending;
+};
+
+} // namespace ciel
@@ -0,0 +1,85 @@
+#include "tile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace ciel {
+
+namespace {
+
+// interleave the lower 16 bits of x and y
+uint32_t mortonCode(uint32_t x, uint32_t y)
+{
+    auto spread = [](uint32_t v) {
+        v &= 0x0000ffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+} // namespace
+
+std::vector<Tile> makeTiles(unsigned  imageW,
+                            unsigned  imageH,
+                            unsigned  tileSize,
+                            TileOrder order)
+{
+    tileSize = std::max(tileSize, 1u);
+    const unsigned nTileX = (imageW + tileSize - 1) / tileSize;
+    const unsigned nTileY = (imageH + tileSize - 1) / tileSize;
+
+    // tile index (tx, ty) with the sort key of the requested order
+    struct Entry
+    {
+        unsigned tx, ty;
+        double   key0, key1;
+    };
+    std::vector<Entry> entries;
+    entries.reserve(nTileX * nTileY);
+
+    const double cx = (nTileX - 1) * 0.5;
+    const double cy = (nTileY - 1) * 0.5;
+    for (unsigned ty = 0; ty < nTileY; ty++) {
+        for (unsigned tx = 0; tx < nTileX; tx++) {
+            Entry e{tx, ty, 0, 0};
+            switch (order) {
+            case TileOrder::Scanline:
+                e.key0 = ty * nTileX + tx;
+                break;
+            case TileOrder::Morton:
+                e.key0 = mortonCode(tx, ty);
+                break;
+            case TileOrder::Spiral:
+                // ring around the center, then angle within the ring
+                e.key0 = std::max(std::abs(tx - cx), std::abs(ty - cy));
+                e.key1 = std::atan2(ty - cy, tx - cx);
+                break;
+            }
+            entries.push_back(e);
+        }
+    }
+
+    std::stable_sort(
+        entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.key0 != b.key0 ? a.key0 < b.key0 : a.key1 < b.key1;
+        });
+
+    std::vector<Tile> tiles;
+    tiles.reserve(entries.size());
+    for (const Entry& e : entries) {
+        const unsigned x0 = e.tx * tileSize;
+        const unsigned y0 = e.ty * tileSize;
+        tiles.push_back(Tile{x0,
+                             y0,
+                             std::min(x0 + tileSize, imageW),
+                             std::min(y0 + tileSize, imageH)});
+    }
+    return tiles;
+}
+
+} // namespace ciel
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "renderSetting.h"
+
+#include <vector>
+
+namespace ciel {
+
+// A rectangular block of pixels [x0, x1) x [y0, y1)
+struct Tile
+{
+    unsigned x0, y0;
+    unsigned x1, y1;
+
+    unsigned width() const { return x1 - x0; }
+    unsigned height() const { return y1 - y0; }
+    unsigned pixelCount() const { return width() * height(); }
+};
+
+// Splits the image into tiles of tileSize (edge tiles may be smaller),
+// sorted in the given order.
+std::vector<Tile> makeTiles(unsigned  imageW,
+                            unsigned  imageH,
+                            unsigned  tileSize,
+                            TileOrder order);
+
+} // namespace ciel
@@ -0,0 +1,155 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Dense voxel grids.
+//
+//  GridLayout maps a node-centered lattice of nx * ny * nz
+//  samples onto a world space box: node (0, 0, 0) sits on
+//  bound.min() and node (nx-1, ny-1, nz-1) on bound.max().
+//  DenseGrid<T> owns the samples, x varies fastest.
+//
+// -------------------------------------------------------
+
+#include "math/bbox.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace ciel {
+
+struct GridLayout
+{
+    GridLayout() = default;
+    GridLayout(const BBox& tBound, unsigned tNx, unsigned tNy, unsigned tNz)
+    : bound(tBound)
+    , nx(std::max(tNx, 2u))
+    , ny(std::max(tNy, 2u))
+    , nz(std::max(tNz, 2u))
+    {
+        const Vector size = bound.size();
+        voxelSize = Vector(size.X() / (nx - 1),
+                           size.Y() / (ny - 1),
+                           size.Z() / (nz - 1));
+        invVoxelSize = Vector(voxelSize.X() > 0 ? 1.f / voxelSize.X() : 0.f,
+                              voxelSize.Y() > 0 ? 1.f / voxelSize.Y() : 0.f,
+                              voxelSize.Z() > 0 ? 1.f / voxelSize.Z() : 0.f);
+    }
+
+    // Cubic voxels, `resolution` nodes along the longest side of the box
+    static GridLayout fromResolution(const BBox& tBound, unsigned resolution)
+    {
+        const Vector size = tBound.size();
+        const float  longest = std::max({size.X(), size.Y(), size.Z()});
+        const float  voxel = longest / (std::max(resolution, 2u) - 1);
+        auto         nodes = [voxel](float length) {
+            return voxel > 0 ? (unsigned)std::ceil(length / voxel) + 1 : 2u;
+        };
+        return GridLayout(
+            tBound, nodes(size.X()), nodes(size.Y()), nodes(size.Z()));
+    }
+
+    size_t voxelCount() const { return (size_t)nx * ny * nz; }
+    size_t index(unsigned i, unsigned j, unsigned k) const
+    {
+        return ((size_t)k * ny + j) * nx + i;
+    }
+    Vector position(unsigned i, unsigned j, unsigned k) const
+    {
+        return bound.min() + Vector(i * voxelSize.X(),
+                                    j * voxelSize.Y(),
+                                    k * voxelSize.Z());
+    }
+
+    // Trilinear interpolation of `data` laid out by this grid.
+    // Points outside the bound return `background`.
+    template<typename T>
+    T sample(const T* data, const Vector& p, const T& background) const
+    {
+        if (!bound.contains(p)) {
+            return background;
+        }
+
+        const Vector d = p - bound.min();
+        const Vector g(d.X() * invVoxelSize.X(),
+                       d.Y() * invVoxelSize.Y(),
+                       d.Z() * invVoxelSize.Z());
+        const unsigned i = std::min((unsigned)g.X(), nx - 2);
+        const unsigned j = std::min((unsigned)g.Y(), ny - 2);
+        const unsigned k = std::min((unsigned)g.Z(), nz - 2);
+        const float    tx = g.X() - i;
+        const float    ty = g.Y() - j;
+        const float    tz = g.Z() - k;
+
+        const size_t sy = nx;
+        const size_t sz = (size_t)nx * ny;
+        const T*     c = data + index(i, j, k);
+
+        const T c00 = c[0] * (1 - tx) + c[1] * tx;
+        const T c10 = c[sy] * (1 - tx) + c[sy + 1] * tx;
+        const T c01 = c[sz] * (1 - tx) + c[sz + 1] * tx;
+        const T c11 = c[sz + sy] * (1 - tx) + c[sz + sy + 1] * tx;
+        const T c0 = c00 * (1 - ty) + c10 * ty;
+        const T c1 = c01 * (1 - ty) + c11 * ty;
+        return c0 * (1 - tz) + c1 * tz;
+    }
+
+    BBox     bound;
+    unsigned nx{2}, ny{2}, nz{2};
+    Vector   voxelSize;
+    Vector   invVoxelSize;
+};
+
+template<typename T>
+class DenseGrid
+{
+public:
+    DenseGrid() = default;
+    DenseGrid(const GridLayout& layout, const T& value = T{})
+    : m_layout(layout)
+    , m_data(layout.voxelCount(), value)
+    {
+    }
+
+    const GridLayout& layout() const { return m_layout; }
+    T*                data() { return m_data.data(); }
+    const T*          data() const { return m_data.data(); }
+
+    T& at(unsigned i, unsigned j, unsigned k)
+    {
+        return m_data[m_layout.index(i, j, k)];
+    }
+    const T& at(unsigned i, unsigned j, unsigned k) const
+    {
+        return m_data[m_layout.index(i, j, k)];
+    }
+
+    T sample(const Vector& p, const T& background) const
+    {
+        return m_layout.sample(m_data.data(), p, background);
+    }
+
+    // Sets every node to f(position), in parallel over z slices
+    template<typename F>
+    void fill(F&& f)
+    {
+        const GridLayout& l = m_layout;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif // _OPENMP
+        for (unsigned k = 0; k < l.nz; k++) {
+            for (unsigned j = 0; j < l.ny; j++) {
+                for (unsigned i = 0; i < l.nx; i++) {
+                    m_data[l.index(i, j, k)] = f(l.position(i, j, k));
+                }
+            }
+        }
+    }
+
+private:
+    GridLayout     m_layout;
+    std::vector<T> m_data;
+};
+
+} // namespace ciel
@@ -0,0 +1,212 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Gradient noise and fractal Brownian motion.
+//
+//  The kernels are templated on the point type: a Vector
+//  gives one value, a VectorN gives N values computed in
+//  SIMD lanes with the lattice hashing done on integer
+//  SIMD registers, so a batch of points costs about as
+//  much per packet as one point does.
+//
+//  The noise is a pure function of the point and the seed:
+//  the same seed gives the same field on every run and in
+//  every lane layout.
+//
+// -------------------------------------------------------
+
+#include "math/hash.h"
+#include "math/vectorN.h"
+
+#include <cmath>
+#include <cstdint>
+
+namespace ciel {
+
+// |gradientNoise()| never exceeds this
+inline constexpr float kNoiseBound = 1.5f;
+
+struct NoiseParams
+{
+    float    frequency{1};  // of the first octave
+    unsigned octaves{4};    // number of octaves
+    float    lacunarity{2}; // frequency ratio between octaves
+    float    gain{0.5};     // amplitude ratio between octaves
+    uint32_t seed{0};
+    Vector   offset;        // shifts the whole field
+
+    // |fbm()| never exceeds this
+    float bound() const
+    {
+        float sum = 0;
+        float amplitude = 1;
+        for (unsigned i = 0; i < octaves; i++) {
+            sum += amplitude;
+            amplitude *= std::abs(gain);
+        }
+        return sum * kNoiseBound;
+    }
+
+    uint64_t hash() const
+    {
+        uint64_t h = hashCombine(hashString("noise"), frequency);
+        h = hashCombine(h, (uint64_t)octaves);
+        h = hashCombine(hashCombine(h, lacunarity), gain);
+        return hashCombine(hashCombine(h, (uint64_t)seed), offset);
+    }
+};
+
+namespace noise {
+
+// Unsigned lattice coordinates matching a float or a FloatN
+template<typename S>
+struct UintOf
+{
+    using type = uint32_t;
+};
+template<int N>
+struct UintOf<FloatN<N>>
+{
+    using type = stdx::fixed_size_simd<uint32_t, N>;
+};
+template<typename S>
+using UintOf_t = typename UintOf<S>::type;
+
+// floor() by truncation, which baseline SSE2 has an instruction for while
+// floor() is a library call. |x| must stay below 2^31.
+inline float floorOf(float x)
+{
+    const float t = (float)(int32_t)x;
+    return t > x ? t - 1.f : t;
+}
+template<int N>
+FloatN<N> floorOf(const FloatN<N>& x)
+{
+    const FloatN<N> t = stdx::static_simd_cast<FloatN<N>>(
+        stdx::static_simd_cast<stdx::fixed_size_simd<int32_t, N>>(x));
+    return select(t > x, t - 1.f, t);
+}
+
+// x is integral (from floorOf), wraps negative values around
+inline uint32_t toUint(float x) { return (uint32_t)(int32_t)x; }
+template<int N>
+stdx::fixed_size_simd<uint32_t, N> toUint(const FloatN<N>& x)
+{
+    return stdx::static_simd_cast<stdx::fixed_size_simd<uint32_t, N>>(
+        stdx::static_simd_cast<stdx::fixed_size_simd<int32_t, N>>(x));
+}
+
+inline float toFloat(uint32_t x) { return (float)x; }
+template<int N>
+FloatN<N> toFloat(const stdx::fixed_size_simd<uint32_t, N>& x)
+{
+    return stdx::static_simd_cast<FloatN<N>>(
+        stdx::static_simd_cast<stdx::fixed_size_simd<int32_t, N>>(x));
+}
+
+// Lattice coordinates are hashed by multiplying each axis with its own odd
+// constant, xor-ing them and finalizing the result. The products of the
+// two corners along an axis differ by the constant, so they are computed
+// once per point rather than once per corner.
+inline constexpr uint32_t kLatticePrimes[3] = {
+    0x8da6b343u, 0xd8163841u, 0xcb1ab31fu};
+
+// lowbias32 finalizer of the xor of the axis products and the seed
+template<typename U>
+U hashLattice(const U& x, const U& y, const U& z, uint32_t seed)
+{
+    U h = x ^ y ^ z ^ U(seed * 0x9e3779b9u);
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+// Dot product of the corner's pseudo-random gradient, components in
+// [-1, 1] taken from three bytes of the hash, with the offset to it
+template<typename S, typename U>
+S gradientDot(const U& h, const S& dx, const S& dy, const S& dz)
+{
+    constexpr float scale = 2.f / 255.f;
+    const S         gx = toFloat(h & 0xffu) * scale - 1.f;
+    const S         gy = toFloat((h >> 8) & 0xffu) * scale - 1.f;
+    const S         gz = toFloat((h >> 16) & 0xffu) * scale - 1.f;
+    return gx * dx + gy * dy + gz * dz;
+}
+
+// quintic fade, zero first and second derivatives at 0 and 1
+template<typename S>
+S fade(const S& t)
+{
+    return t * t * t * (t * (t * 6.f - 15.f) + 10.f);
+}
+
+template<typename S>
+S lerp(const S& a, const S& b, const S& t)
+{
+    return a + (b - a) * t;
+}
+
+} // namespace noise
+
+// Perlin style gradient noise, zero on the integer lattice. V is a Vector
+// or a VectorN.
+template<typename V>
+ScalarOf_t<V> gradientNoise(const V& p, uint32_t seed)
+{
+    using S = ScalarOf_t<V>;
+    using U = noise::UintOf_t<S>;
+
+    const S x0 = noise::floorOf(p.X());
+    const S y0 = noise::floorOf(p.Y());
+    const S z0 = noise::floorOf(p.Z());
+    const S fx = p.X() - x0;
+    const S fy = p.Y() - y0;
+    const S fz = p.Z() - z0;
+    const U hx[2] = {noise::toUint(x0) * noise::kLatticePrimes[0],
+                     hx[0] + noise::kLatticePrimes[0]};
+    const U hy[2] = {noise::toUint(y0) * noise::kLatticePrimes[1],
+                     hy[0] + noise::kLatticePrimes[1]};
+    const U hz[2] = {noise::toUint(z0) * noise::kLatticePrimes[2],
+                     hz[0] + noise::kLatticePrimes[2]};
+
+    auto corner = [&](int dx, int dy, int dz) {
+        const U h = noise::hashLattice(hx[dx], hy[dy], hz[dz], seed);
+        return noise::gradientDot(
+            h, fx - (float)dx, fy - (float)dy, fz - (float)dz);
+    };
+
+    const S u = noise::fade(fx);
+    const S v = noise::fade(fy);
+    const S w = noise::fade(fz);
+    const S x00 = noise::lerp(corner(0, 0, 0), corner(1, 0, 0), u);
+    const S x10 = noise::lerp(corner(0, 1, 0), corner(1, 1, 0), u);
+    const S x01 = noise::lerp(corner(0, 0, 1), corner(1, 0, 1), u);
+    const S x11 = noise::lerp(corner(0, 1, 1), corner(1, 1, 1), u);
+    // each corner term is at most 3, halved to keep within kNoiseBound
+    return 0.5f * noise::lerp(noise::lerp(x00, x10, v),
+                              noise::lerp(x01, x11, v),
+                              w);
+}
+
+// Sum of params.octaves octaves of gradient noise, each with its own seed
+template<typename V>
+ScalarOf_t<V> fbm(const V& p, const NoiseParams& params)
+{
+    using S = ScalarOf_t<V>;
+    S     sum(0.f);
+    float frequency = params.frequency;
+    float amplitude = 1;
+    for (unsigned i = 0; i < params.octaves; i++) {
+        const V q = (p + params.offset) * frequency;
+        sum += amplitude * gradientNoise(q, params.seed + i * 0x632be5abu);
+        frequency *= params.lacunarity;
+        amplitude *= params.gain;
+    }
+    return sum;
+}
+
+} // namespace ciel
@@ -0,0 +1,70 @@
+#include "particles.h"
+
+#include <algorithm>
+
+namespace ciel {
+
+void mergeSplats(VolumeScalarSparseGrid&     grid,
+                 std::span<SplatAccumulator> accumulators)
+{
+    using Brick = SplatAccumulator::Brick;
+
+    // every thread's copy of every brick, grouped by brick
+    struct Entry
+    {
+        uint64_t                key;
+        std::unique_ptr<Brick>* brick; // slot in the thread's map
+    };
+    std::vector<Entry> entries;
+    size_t             total = 0;
+    for (SplatAccumulator& acc : accumulators) {
+        total += acc.brickCount();
+    }
+    entries.reserve(total);
+    for (SplatAccumulator& acc : accumulators) {
+        for (auto& [key, brick] : acc.bricks()) {
+            entries.push_back(Entry{key, &brick});
+        }
+    }
+    // stable, so copies are summed in thread order and the result does not
+    // depend on how the maps happen to iterate
+    std::stable_sort(entries.begin(),
+                     entries.end(),
+                     [](const Entry& a, const Entry& b) {
+                         return a.key < b.key;
+                     });
+    std::vector<size_t> groups; // first entry of each brick
+    for (size_t n = 0; n < entries.size(); n++) {
+        if (n == 0 || entries[n].key != entries[n - 1].key) {
+            groups.push_back(n);
+        }
+    }
+    const size_t bricks = groups.size();
+    groups.push_back(entries.size());
+
+    // each brick is summed into its first copy by one thread
+    std::vector<std::unique_ptr<Brick>> merged(bricks);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif // _OPENMP
+    for (size_t g = 0; g < bricks; g++) {
+        Brick* sum = entries[groups[g]].brick->get();
+        for (size_t n = groups[g] + 1; n < groups[g + 1]; n++) {
+            const Brick* other = entries[n].brick->get();
+            for (int v = 0; v < SplatAccumulator::Tree::kLeafSize; v++) {
+                sum->values[v] += other->values[v];
+            }
+        }
+    }
+
+    // hand the sums over to the grid, drop the other copies
+    for (size_t g = 0; g < bricks; g++) {
+        merged[g] = std::move(*entries[groups[g]].brick);
+    }
+    for (SplatAccumulator& acc : accumulators) {
+        acc.clear();
+    }
+    grid.accumulate(std::move(merged));
+}
+
+} // namespace ciel
@@ -0,0 +1,195 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Particle splatting into a sparse density grid.
+//
+//  Every thread splats its share of the particles into a
+//  private map of 8^3 bricks, so no two threads ever write
+//  the same float. The maps are then merged in parallel by
+//  brick: the copies of one brick from all threads are
+//  summed by a single thread and handed to the grid. Cost
+//  follows the particle count on the splat side and the
+//  touched bricks on the merge side, with no atomics in
+//  either.
+//
+// -------------------------------------------------------
+
+#include "noise.h" // floorOf
+#include "volumeScalarSparseGrid.h"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif // _OPENMP
+
+namespace ciel {
+
+struct Particle
+{
+    Vector position;
+    float  density{1}; // spread over the 8 voxels around position
+};
+
+// One thread's splats: density bricks by SparseGrid::leafKey()
+class SplatAccumulator
+{
+public:
+    using Tree = VolumeScalarSparseGrid::Tree;
+    using Brick = Tree::Leaf;
+
+    explicit SplatAccumulator(float voxelSize)
+    : m_invVoxelSize(1.f / voxelSize)
+    {
+    }
+
+    // Adds the particle's density to the 8 voxels around it, weighted
+    // trilinearly so that a sampled grid reproduces its position
+    void add(const Particle& particle)
+    {
+        const float   gx = particle.position.X() * m_invVoxelSize;
+        const float   gy = particle.position.Y() * m_invVoxelSize;
+        const float   gz = particle.position.Z() * m_invVoxelSize;
+        const Coord   c{(int32_t)noise::floorOf(gx),
+                      (int32_t)noise::floorOf(gy),
+                      (int32_t)noise::floorOf(gz)};
+        const float   tx = gx - c.i;
+        const float   ty = gy - c.j;
+        const float   tz = gz - c.k;
+        const float   w[2][3] = {{1 - tx, 1 - ty, 1 - tz}, {tx, ty, tz}};
+        constexpr int last = Tree::kLeafDim - 1;
+
+        if ((c.i & last) != last && (c.j & last) != last &&
+            (c.k & last) != last) {
+            // all 8 voxels in one brick
+            constexpr int sy = Tree::kLeafDim;
+            constexpr int sz = Tree::kLeafDim * Tree::kLeafDim;
+            float*        d = brick(c).values.data() + Brick::offset(c);
+            for (int n = 0; n < 8; n++) {
+                const int dx = n & 1, dy = (n >> 1) & 1, dz = n >> 2;
+                d[dz * sz + dy * sy + dx] += particle.density * w[dx][0] *
+                                             w[dy][1] * w[dz][2];
+            }
+            return;
+        }
+        for (int n = 0; n < 8; n++) {
+            const int   dx = n & 1, dy = (n >> 1) & 1, dz = n >> 2;
+            const Coord v{c.i + dx, c.j + dy, c.k + dz};
+            brick(v).values[Brick::offset(v)] += particle.density * w[dx][0] *
+                                                 w[dy][1] * w[dz][2];
+        }
+    }
+
+    size_t brickCount() const { return m_bricks.size(); }
+    std::unordered_map<uint64_t, std::unique_ptr<Brick>>& bricks()
+    {
+        return m_bricks;
+    }
+    void clear()
+    {
+        m_bricks.clear();
+        m_cache.fill(CacheSlot{});
+    }
+
+private:
+    // brick containing c, created empty on first touch. Particles are
+    // scattered over a few thousand bricks, so a direct mapped cache of
+    // them saves most of the hash map lookups.
+    Brick& brick(const Coord& c)
+    {
+        const uint64_t key = Tree::leafKey(c);
+        CacheSlot&     slot = m_cache[hashMix(key) & (kCacheSize - 1)];
+        if (slot.key != key) {
+            std::unique_ptr<Brick>& b = m_bricks[key];
+            if (!b) {
+                b = std::make_unique<Brick>();
+                b->origin = Tree::leafOrigin(c);
+                b->values.fill(0.f);
+            }
+            slot = CacheSlot{key, b.get()};
+        }
+        return *slot.brick;
+    }
+
+    static constexpr size_t kCacheSize = 4096;
+    struct CacheSlot
+    {
+        uint64_t key{~0ull};
+        Brick*   brick{nullptr};
+    };
+
+    float                                                m_invVoxelSize;
+    std::unordered_map<uint64_t, std::unique_ptr<Brick>> m_bricks;
+    std::array<CacheSlot, kCacheSize>                    m_cache;
+};
+
+// Sums the accumulators brick by brick, in parallel over bricks, and adds
+// the result to `grid` (see VolumeScalarSparseGrid::accumulate()). The
+// accumulators are emptied.
+void mergeSplats(VolumeScalarSparseGrid&     grid,
+                 std::span<SplatAccumulator> accumulators);
+
+// Splats `count` particles into `grid`. generate(first, out) fills `out`
+// with particles first, first + 1, ...; it is called from several threads
+// at once with disjoint ranges, so it must only depend on the index. Each
+// thread gets a fixed range of particles, so for a given thread count the
+// grid comes out the same on every run.
+template<typename F>
+void splatParticles(VolumeScalarSparseGrid& grid, size_t count, F&& generate)
+{
+    constexpr size_t kChunk = 1024; // particles per generate() call
+
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif // _OPENMP
+    std::vector<SplatAccumulator> accumulators;
+    accumulators.reserve(threads);
+    for (int t = 0; t < threads; t++) {
+        accumulators.emplace_back(grid.voxelSize());
+    }
+
+    const size_t chunks = (count + kChunk - 1) / kChunk;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif // _OPENMP
+    {
+        int thread = 0;
+#ifdef _OPENMP
+        thread = omp_get_thread_num();
+#endif // _OPENMP
+        SplatAccumulator& acc = accumulators[thread];
+        Particle          particles[kChunk];
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif // _OPENMP
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            const size_t first = chunk * kChunk;
+            const size_t n = std::min(kChunk, count - first);
+            generate(first, std::span<Particle>(particles, n));
+            for (size_t i = 0; i < n; i++) {
+                acc.add(particles[i]);
+            }
+        }
+    }
+    mergeSplats(grid, accumulators);
+}
+
+inline void splatParticles(VolumeScalarSparseGrid&   grid,
+                           std::span<const Particle> particles)
+{
+    splatParticles(grid,
+                   particles.size(),
+                   [particles](size_t first, std::span<Particle> out) {
+                       std::copy_n(
+                           particles.begin() + first, out.size(), out.begin());
+                   });
+}
+
+} // namespace ciel
@@ -0,0 +1,259 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Sparse hierarchical voxel grid (VDB style).
+//
+//  root (hash map) -> internal nodes of 16^3 slots -> leaf
+//  bricks of 8^3 voxels. A slot without a leaf holds a tile
+//  value that stands for its whole 8^3 region, and regions
+//  without an internal node read as the background value,
+//  so memory follows the occupied voxels rather than the
+//  bounding box.
+//
+//  Voxel (i, j, k) is a sample point; world space mapping
+//  is left to the owner of the grid.
+//
+// -------------------------------------------------------
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+namespace ciel {
+
+struct Coord
+{
+    int32_t i, j, k;
+};
+
+template<typename T>
+class SparseGrid
+{
+public:
+    static constexpr int kLeafLog2 = 3;     // 8^3 voxels per leaf
+    static constexpr int kInternalLog2 = 4; // 16^3 leaves per internal node
+    static constexpr int kLeafDim = 1 << kLeafLog2;
+    static constexpr int kLeafSize = kLeafDim * kLeafDim * kLeafDim;
+    static constexpr int kInternalDim = 1 << kInternalLog2;
+    static constexpr int kInternalSize = kInternalDim * kInternalDim *
+                                         kInternalDim;
+    static constexpr int kInternalShift = kLeafLog2 + kInternalLog2;
+
+    struct Leaf
+    {
+        Coord                    origin; // first voxel of the brick
+        std::array<T, kLeafSize> values;
+
+        static int offset(const Coord& c)
+        {
+            constexpr int mask = kLeafDim - 1;
+            return ((c.k & mask) << (2 * kLeafLog2)) |
+                   ((c.j & mask) << kLeafLog2) | (c.i & mask);
+        }
+    };
+
+    struct Internal
+    {
+        std::array<std::unique_ptr<Leaf>, kInternalSize> leaves;
+        std::array<T, kInternalSize>                     tiles;
+
+        static int offset(const Coord& c)
+        {
+            constexpr int mask = kInternalDim - 1;
+            return (((c.k >> kLeafLog2) & mask) << (2 * kInternalLog2)) |
+                   (((c.j >> kLeafLog2) & mask) << kInternalLog2) |
+                   ((c.i >> kLeafLog2) & mask);
+        }
+    };
+
+    explicit SparseGrid(const T& background = T{})
+    : m_background(background)
+    , m_id(s_nextId++)
+    {
+    }
+
+    const T& background() const { return m_background; }
+
+    // origin of the leaf brick containing c
+    static Coord leafOrigin(const Coord& c)
+    {
+        constexpr int32_t mask = ~(kLeafDim - 1);
+        return Coord{c.i & mask, c.j & mask, c.k & mask};
+    }
+
+    static uint64_t rootKey(const Coord& c)
+    {
+        constexpr uint64_t bias = 1u << 20;
+        constexpr uint64_t mask = (1u << 21) - 1;
+        return (((uint64_t)(c.i >> kInternalShift) + bias) & mask) |
+               ((((uint64_t)(c.j >> kInternalShift) + bias) & mask) << 21) |
+               ((((uint64_t)(c.k >> kInternalShift) + bias) & mask) << 42);
+    }
+    static uint64_t leafKey(const Coord& c)
+    {
+        constexpr uint64_t bias = 1u << 20;
+        constexpr uint64_t mask = (1u << 21) - 1;
+        return (((uint64_t)(c.i >> kLeafLog2) + bias) & mask) |
+               ((((uint64_t)(c.j >> kLeafLog2) + bias) & mask) << 21) |
+               ((((uint64_t)(c.k >> kLeafLog2) + bias) & mask) << 42);
+    }
+
+    const Internal* findInternal(const Coord& c) const
+    {
+        const auto it = m_root.find(rootKey(c));
+        return it == m_root.end() ? nullptr : it->second.get();
+    }
+    const Leaf* findLeaf(const Coord& c) const
+    {
+        const Internal* node = findInternal(c);
+        return node ? node->leaves[Internal::offset(c)].get() : nullptr;
+    }
+
+    T getValue(const Coord& c) const
+    {
+        const Internal* node = findInternal(c);
+        if (!node) {
+            return m_background;
+        }
+        const int   slot = Internal::offset(c);
+        const Leaf* leaf = node->leaves[slot].get();
+        return leaf ? leaf->values[Leaf::offset(c)] : node->tiles[slot];
+    }
+
+    // Not thread safe: these change the tree structure
+    Internal& touchInternal(const Coord& c)
+    {
+        std::unique_ptr<Internal>& node = m_root[rootKey(c)];
+        if (!node) {
+            node = std::make_unique<Internal>();
+            node->tiles.fill(m_background);
+            m_generation++;
+        }
+        return *node;
+    }
+    void setLeaf(std::unique_ptr<Leaf> leaf)
+    {
+        Internal& node = touchInternal(leaf->origin);
+        const int slot = Internal::offset(leaf->origin);
+        if (!node.leaves[slot]) {
+            m_leafCount++;
+        }
+        node.leaves[slot] = std::move(leaf);
+        m_generation++;
+    }
+    void setTile(const Coord& c, const T& value)
+    {
+        Internal& node = touchInternal(c);
+        const int slot = Internal::offset(c);
+        if (node.leaves[slot]) {
+            node.leaves[slot].reset();
+            m_leafCount--;
+        }
+        node.tiles[slot] = value;
+        m_generation++;
+    }
+
+    // Calls f(rootKey, internal node) for every internal node, in no
+    // particular order
+    template<typename F>
+    void forEachInternal(F&& f) const
+    {
+        for (const auto& [key, node] : m_root) {
+            f(key, *node);
+        }
+    }
+
+    size_t leafCount() const { return m_leafCount; }
+    size_t internalCount() const { return m_root.size(); }
+    size_t memoryUsage() const
+    {
+        return sizeof(*this) + m_root.size() * sizeof(Internal) +
+               m_leafCount * sizeof(Leaf);
+    }
+
+    // Changes whenever the tree structure changes, so that accessors know
+    // when their cached nodes are stale.
+    uint64_t generation() const { return m_generation; }
+    // Unique among the grids of the process, unlike the address, which a
+    // grid allocated after this one is freed may get again
+    uint64_t id() const { return m_id; }
+
+    // Read accessor that remembers the last leaf and internal node it went
+    // through. Consecutive lookups along a ray mostly land in the same brick
+    // and skip the hash map entirely. One accessor per thread.
+    class Accessor
+    {
+    public:
+        Accessor() = default;
+        explicit Accessor(const SparseGrid* grid) { bind(grid); }
+
+        void bind(const SparseGrid* grid)
+        {
+            m_grid = grid;
+            if (grid->id() != m_id || grid->generation() != m_generation) {
+                m_id = grid->id();
+                m_generation = grid->generation();
+                m_leaf = nullptr;
+                m_leafKey = ~0ull;
+                m_internal = nullptr;
+                m_rootKey = ~0ull;
+            }
+        }
+
+        // leaf containing c, or nullptr if it is a tile or background
+        const Leaf* leaf(const Coord& c)
+        {
+            const uint64_t key = leafKey(c);
+            if (key != m_leafKey) {
+                m_leafKey = key;
+                const Internal* node = internal(c);
+                m_leaf = node ? node->leaves[Internal::offset(c)].get()
+                              : nullptr;
+            }
+            return m_leaf;
+        }
+
+        T getValue(const Coord& c)
+        {
+            if (const Leaf* l = leaf(c)) {
+                return l->values[Leaf::offset(c)];
+            }
+            const Internal* node = internal(c);
+            return node ? node->tiles[Internal::offset(c)]
+                        : m_grid->background();
+        }
+
+    private:
+        const Internal* internal(const Coord& c)
+        {
+            const uint64_t key = rootKey(c);
+            if (key != m_rootKey) {
+                m_rootKey = key;
+                m_internal = m_grid->findInternal(c);
+            }
+            return m_internal;
+        }
+
+        const SparseGrid* m_grid{nullptr};
+        uint64_t          m_id{0}; // of m_grid, 0 before the first bind()
+        uint64_t          m_generation{0};
+        const Leaf*       m_leaf{nullptr};
+        uint64_t          m_leafKey{~0ull};
+        const Internal*   m_internal{nullptr};
+        uint64_t          m_rootKey{~0ull};
+    };
+
+private:
+    T                                                       m_background;
+    std::unordered_map<uint64_t, std::unique_ptr<Internal>> m_root;
+    size_t                                                  m_leafCount{0};
+    uint64_t                                                m_generation{0};
+    uint64_t                                                m_id{0};
+
+    static inline std::atomic<uint64_t> s_nextId{1};
+};
+
+} // namespace ciel
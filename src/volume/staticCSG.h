@@ -0,0 +1,267 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Compile-time CSG for scenes whose layout is known.
+//
+//  The tree is a type, e.g.
+//
+//      csg::Union<csg::Sphere,
+//                 csg::Cutout<csg::Box, csg::Torus>>
+//
+//  with every node held by value, so eval() compiles down
+//  to one inlined function: no shared_ptr, no virtual call.
+//  Leaves wrap the regular primitive classes and call them
+//  non-virtually, giving exactly the same values as the
+//  dynamic tree. csg::makeVolume() wraps a tree as a
+//  VolumeScalar::Ptr for the renderer.
+//
+// -------------------------------------------------------
+
+#include "volumeBase.h"
+#include "volumeScalarBox.h"
+#include "volumeScalarEllipse.h"
+#include "volumeScalarSphere.h"
+#include "volumeScalarTorus.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+namespace ciel::csg {
+
+// max / min of either floats or SIMD packets
+inline float maxOf(float a, float b) { return std::max(a, b); }
+inline float minOf(float a, float b) { return std::min(a, b); }
+template<typename T, typename Abi>
+stdx::simd<T, Abi> maxOf(const stdx::simd<T, Abi>& a,
+                         const stdx::simd<T, Abi>& b)
+{
+    return stdx::max(a, b);
+}
+template<typename T, typename Abi>
+stdx::simd<T, Abi> minOf(const stdx::simd<T, Abi>& a,
+                         const stdx::simd<T, Abi>& b)
+{
+    return stdx::min(a, b);
+}
+
+// A primitive volume class used by value. eval() takes a Vector or a
+// VectorP and calls the class' own eval() or evalPacket() directly.
+template<typename Volume>
+class Leaf
+{
+public:
+    template<typename... Args>
+    explicit Leaf(Args&&... args)
+    : m_volume(std::forward<Args>(args)...)
+    {
+    }
+
+    template<typename V>
+    ScalarOf_t<V> eval(const V& p) const
+    {
+        if constexpr (std::is_same_v<V, Vector>) {
+            return m_volume.Volume::eval(p);
+        }
+        else {
+            return m_volume.Volume::evalPacket(p);
+        }
+    }
+    BBox     bound() const { return m_volume.Volume::bound(); }
+    Interval evalInterval(const BBox& box) const
+    {
+        return m_volume.Volume::evalInterval(box);
+    }
+    uint64_t hash() const
+    {
+        return m_volume.Volume::hash();
+    }
+
+private:
+    Volume m_volume;
+};
+
+using Sphere = Leaf<VolumeScalarSphere>;
+using Box = Leaf<VolumeScalarBox>;
+using Torus = Leaf<VolumeScalarTorus>;
+using Ellipse = Leaf<VolumeScalarEllipse>;
+
+// Same operations as volumeScalarCSG.h
+template<typename A, typename B>
+class Union
+{
+public:
+    Union(A a, B b)
+    : m_a(std::move(a))
+    , m_b(std::move(b))
+    {
+    }
+
+    template<typename V>
+    ScalarOf_t<V> eval(const V& p) const
+    {
+        return maxOf(m_a.eval(p), m_b.eval(p));
+    }
+    BBox     bound() const { return m_a.bound().unite(m_b.bound()); }
+    Interval evalInterval(const BBox& box) const
+    {
+        return max(m_a.evalInterval(box), m_b.evalInterval(box));
+    }
+    uint64_t hash() const
+    {
+        return hashCombine(hashCombine(hashString("union"), m_a.hash()),
+                           m_b.hash());
+    }
+
+private:
+    A m_a;
+    B m_b;
+};
+
+template<typename A, typename B>
+class Intersection
+{
+public:
+    Intersection(A a, B b)
+    : m_a(std::move(a))
+    , m_b(std::move(b))
+    {
+    }
+
+    template<typename V>
+    ScalarOf_t<V> eval(const V& p) const
+    {
+        return minOf(m_a.eval(p), m_b.eval(p));
+    }
+    BBox     bound() const { return m_a.bound().intersect(m_b.bound()); }
+    Interval evalInterval(const BBox& box) const
+    {
+        return min(m_a.evalInterval(box), m_b.evalInterval(box));
+    }
+    uint64_t hash() const
+    {
+        return hashCombine(hashCombine(hashString("intersection"), m_a.hash()),
+                           m_b.hash());
+    }
+
+private:
+    A m_a;
+    B m_b;
+};
+
+template<typename A, typename B>
+class Cutout
+{
+public:
+    Cutout(A a, B b)
+    : m_a(std::move(a))
+    , m_b(std::move(b))
+    {
+    }
+
+    template<typename V>
+    ScalarOf_t<V> eval(const V& p) const
+    {
+        return minOf(m_a.eval(p), -1.f * m_b.eval(p));
+    }
+    BBox     bound() const { return m_a.bound(); }
+    Interval evalInterval(const BBox& box) const
+    {
+        return min(m_a.evalInterval(box), -m_b.evalInterval(box));
+    }
+    uint64_t hash() const
+    {
+        return hashCombine(hashCombine(hashString("cutout"), m_a.hash()),
+                           m_b.hash());
+    }
+
+private:
+    A m_a;
+    B m_b;
+};
+
+template<typename A>
+class Shell
+{
+public:
+    Shell(A a, float thickness)
+    : m_a(std::move(a))
+    , m_thickness(thickness)
+    {
+    }
+
+    template<typename V>
+    ScalarOf_t<V> eval(const V& p) const
+    {
+        const ScalarOf_t<V> value = m_a.eval(p);
+        return minOf(value + m_thickness / 2.f,
+                     -1.f * (value - m_thickness / 2.f));
+    }
+    BBox bound() const
+    {
+        return m_a.bound().expand(std::abs(m_thickness) / 2.f);
+    }
+    Interval evalInterval(const BBox& box) const
+    {
+        const Interval value = m_a.evalInterval(box);
+        return min(value + m_thickness / 2.f,
+                   -1.f * (value - m_thickness / 2.f));
+    }
+    uint64_t hash() const
+    {
+        return hashCombine(hashCombine(hashString("shell"), m_a.hash()),
+                           m_thickness);
+    }
+
+private:
+    A     m_a;
+    float m_thickness;
+};
+
+// A static tree behind the VolumeScalar interface. The virtual call is
+// paid once per eval(), evalPacket() or evalBatch(), not once per node.
+template<typename Expr>
+class VolumeScalarStatic : public VolumeScalar
+{
+public:
+    explicit VolumeScalarStatic(Expr expr)
+    : m_expr(std::move(expr))
+    {
+    }
+
+    float  eval(const Vector& p) const override { return m_expr.eval(p); }
+    FloatP evalPacket(const VectorP& p) const override
+    {
+        return m_expr.eval(p);
+    }
+    void evalBatch(std::span<const Vector> p,
+                   std::span<float>        out) const override
+    {
+        evalBatchByPackets(p, out, [this](const VectorP& q) {
+            return m_expr.eval(q);
+        });
+    }
+    BBox     bound() const override { return m_expr.bound(); }
+    Interval evalInterval(const BBox& box) const override
+    {
+        return m_expr.evalInterval(box);
+    }
+    uint64_t hash() const override
+    {
+        return m_expr.hash();
+    }
+
+    const Expr& expr() const { return m_expr; }
+
+private:
+    Expr m_expr;
+};
+
+template<typename Expr>
+VolumeScalar::Ptr makeVolume(Expr expr)
+{
+    return std::make_shared<VolumeScalarStatic<Expr>>(std::move(expr));
+}
+
+} // namespace ciel::csg
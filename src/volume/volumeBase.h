@@ -1,10 +1,18 @@
 #pragma once
 
+#include "math/bbox.h"
+#include "math/hash.h"
+#include "math/interval.h"
+#include "math/vectorN.h"
+
+#include <algorithm>
+#include <array>
 #include <memory> // shared_ptr
+#include <span>
+#include <type_traits>
 
 namespace ciel {
 
-class Vector;
 class Matrix;
 class Color;
 
@@ -26,12 +34,40 @@ struct DxDyType<Vector>
     typedef Matrix _DxDyType;
 };
 
+// SIMD packet of eval() results. Only scalar volumes have a packet type.
+template<typename T>
+struct PacketType
+{
+    typedef int _PacketType;
+};
+
+template<>
+struct PacketType<float>
+{
+    typedef FloatP _PacketType;
+};
+
+// Range of eval() over a region. Only scalar volumes have one.
+template<typename T>
+struct IntervalType
+{
+    typedef int _IntervalType;
+};
+
+template<>
+struct IntervalType<float>
+{
+    typedef Interval _IntervalType;
+};
+
 template<typename T>
 class VolumeBase
 {
 public:
     using volumeDataType = T;
     using volumeDxDyType = typename DxDyType<T>::_DxDyType;
+    using volumePacketType = typename PacketType<T>::_PacketType;
+    using volumeIntervalType = typename IntervalType<T>::_IntervalType;
     using Ptr = std::shared_ptr<VolumeBase<volumeDataType>>;
     using ConstPtr = std::shared_ptr<const VolumeBase<volumeDataType>>;
 
@@ -40,12 +76,63 @@ public:
         volumeDataType base{};
         return base;
     }
+    // eval() over a packet of points. The default evaluates lane by lane;
+    // volumes override it with a SIMD kernel.
+    virtual volumePacketType
+    evalPacket([[maybe_unused]] const VectorP &p) const
+    {
+        volumePacketType result{};
+        if constexpr (std::is_same_v<volumeDataType, float>) {
+            for (int i = 0; i < kPacketWidth; i++) {
+                result[i] = eval(p.lane(i));
+            }
+        }
+        return result;
+    }
+    // eval() over a batch of points, out[i] = eval(p[i]). One virtual call
+    // per batch instead of one per point; the default just loops.
+    virtual void evalBatch(std::span<const Vector> p,
+                           std::span<volumeDataType> out) const
+    {
+        for (size_t i = 0; i < p.size(); i++) {
+            out[i] = eval(p[i]);
+        }
+    }
     virtual volumeDxDyType dxdy([[maybe_unused]] const Vector &p) const
     {
         volumeDxDyType base{};
         return base;
     }
 
+    // World space box outside of which eval() is never positive.
+    // Volumes that can't tell return an infinite box.
+    virtual BBox bound() const { return BBox::infinite(); }
+
+    // Encloses eval(p) for every p in box, so that a region can be proven
+    // empty (hi <= 0) without sampling it. The default only knows that
+    // nothing outside bound() is positive.
+    virtual volumeIntervalType
+    evalInterval([[maybe_unused]] const BBox &box) const
+    {
+        volumeIntervalType result{};
+        if constexpr (std::is_same_v<volumeDataType, float>) {
+            result = box.intersect(bound()).isEmpty()
+                         ? Interval(-std::numeric_limits<float>::infinity(), 0)
+                         : Interval::infinite();
+        }
+        return result;
+    }
+
+    // Content hash: volumes with equal hashes evaluate the same. The default
+    // hashes the address, so a volume that can't describe its content only
+    // matches itself, and editing it in place goes unnoticed: replace such
+    // a volume instead. Volumes that are edited in place (the grids) fold
+    // in a version that every edit bumps.
+    virtual uint64_t hash() const
+    {
+        return hashMix((uint64_t)reinterpret_cast<uintptr_t>(this));
+    }
+
     static Ptr create()
     {
         return std::make_shared<VolumeBase<volumeDataType>>();
@@ -56,6 +143,41 @@ public:
     };
 };
 
+// Runs a packet kernel over a batch of points, kPacketWidth at a time, for
+// evalBatch() overrides. Unused lanes of the last packet repeat its last
+// point.
+template<typename F>
+void evalBatchByPackets(std::span<const Vector> p,
+                        std::span<float>        out,
+                        F&&                     kernel)
+{
+    for (size_t i = 0; i < p.size(); i += kPacketWidth) {
+        const size_t n = std::min<size_t>(kPacketWidth, p.size() - i);
+        VectorP      packet;
+        for (size_t l = 0; l < kPacketWidth; l++) {
+            packet.setLane(l, p[i + std::min(l, n - 1)]);
+        }
+        const FloatP values = kernel(packet);
+        if (n == kPacketWidth) {
+            values.copy_to(out.data() + i, stdx::element_aligned);
+        }
+        else {
+            for (size_t l = 0; l < n; l++) {
+                out[i + l] = values[l];
+            }
+        }
+    }
+}
+
+// Per axis range of p - origin for the points p of box, for evalInterval()
+inline std::array<Interval, 3> offsetIntervals(const BBox&   box,
+                                               const Vector& origin)
+{
+    return {Interval(box.min().X() - origin.X(), box.max().X() - origin.X()),
+            Interval(box.min().Y() - origin.Y(), box.max().Y() - origin.Y()),
+            Interval(box.min().Z() - origin.Z(), box.max().Z() - origin.Z())};
+}
+
 // type definitions
 using VolumeScalar = VolumeBase<float>;
 using VolumeVector = VolumeBase<Vector>;
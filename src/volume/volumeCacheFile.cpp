@@ -0,0 +1,186 @@
+#include "volumeCacheFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace ciel::cachefile {
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'I', 'E', 'L', 'V', 'O', 'L', '\0'};
+
+struct FileHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t chunkCount;
+    uint64_t sourceHash;
+    uint64_t reserved[5];
+};
+
+static_assert(sizeof(FileHeader) == 64);
+static_assert(sizeof(ChunkEntry) == 32);
+static_assert(sizeof(GridChunk) == 40);
+
+size_t align(size_t offset)
+{
+    return (offset + kChunkAlignment - 1) / kChunkAlignment * kChunkAlignment;
+}
+
+std::string tagName(const char tag[4]) { return std::string(tag, 4); }
+
+} // namespace
+
+GridChunk GridChunk::from(const GridLayout& layout, float background)
+{
+    GridChunk chunk{};
+    for (int a = 0; a < 3; a++) {
+        chunk.boundMin[a] = layout.bound.min()[a];
+        chunk.boundMax[a] = layout.bound.max()[a];
+    }
+    chunk.nodes[0] = layout.nx;
+    chunk.nodes[1] = layout.ny;
+    chunk.nodes[2] = layout.nz;
+    chunk.background = background;
+    return chunk;
+}
+
+GridLayout GridChunk::layout() const
+{
+    return GridLayout(BBox(Vector(boundMin[0], boundMin[1], boundMin[2]),
+                           Vector(boundMax[0], boundMax[1], boundMax[2])),
+                      nodes[0],
+                      nodes[1],
+                      nodes[2]);
+}
+
+bool write(const std::string&           path,
+           uint64_t                     sourceHash,
+           std::span<const ChunkSource> chunks)
+{
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kFormatVersion;
+    header.chunkCount = (uint32_t)chunks.size();
+    header.sourceHash = sourceHash;
+
+    std::vector<ChunkEntry> entries(chunks.size());
+    size_t offset = sizeof(FileHeader) + entries.size() * sizeof(ChunkEntry);
+    for (size_t c = 0; c < chunks.size(); c++) {
+        std::memcpy(entries[c].tag, chunks[c].tag, 4);
+        entries[c].version = chunks[c].version;
+        entries[c].offset = offset = align(offset);
+        entries[c].size = chunks[c].size;
+        offset += chunks[c].size;
+    }
+
+    const std::string temporary = path + ".tmp";
+    std::ofstream     file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "[ciel][cache] Failed to open " << temporary << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()),
+               entries.size() * sizeof(ChunkEntry));
+    const std::vector<char> padding(kChunkAlignment, 0);
+    for (size_t c = 0; c < chunks.size() && file; c++) {
+        file.write(padding.data(), entries[c].offset - (size_t)file.tellp());
+        chunks[c].write(file);
+        if ((size_t)file.tellp() != entries[c].offset + entries[c].size) {
+            file.setstate(std::ios::failbit);
+        }
+    }
+    file.close();
+    if (!file || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "[ciel][cache] Failed to write " << path << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+void readAt(int fd, void* data, size_t size, uint64_t offset)
+{
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        const ssize_t n = pread(fd, bytes, size, offset);
+        if (n <= 0) {
+            throw std::runtime_error("read failed");
+        }
+        bytes += n;
+        size -= n;
+        offset += n;
+    }
+}
+
+Table readTable(int fd, size_t fileSize)
+{
+    FileHeader header;
+    if (fileSize < sizeof(header)) {
+        throw std::runtime_error("not a volume cache file");
+    }
+    readAt(fd, &header, sizeof(header), 0);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("not a volume cache file");
+    }
+    if (header.version != kFormatVersion) {
+        throw std::runtime_error("unsupported format version " +
+                                 std::to_string(header.version));
+    }
+    if (header.chunkCount >
+        (fileSize - sizeof(header)) / sizeof(ChunkEntry)) {
+        throw std::runtime_error("truncated chunk table");
+    }
+
+    Table table;
+    table.sourceHash = header.sourceHash;
+    table.chunks.resize(header.chunkCount);
+    readAt(fd,
+           table.chunks.data(),
+           table.chunks.size() * sizeof(ChunkEntry),
+           sizeof(header));
+    for (const ChunkEntry& entry : table.chunks) {
+        if (entry.offset % kChunkAlignment != 0 || entry.offset > fileSize ||
+            entry.size > fileSize - entry.offset) {
+            throw std::runtime_error(tagName(entry.tag) +
+                                     " chunk out of bounds");
+        }
+    }
+    return table;
+}
+
+const ChunkEntry* Table::find(const char tag[4]) const
+{
+    for (const ChunkEntry& entry : chunks) {
+        if (std::memcmp(entry.tag, tag, 4) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const ChunkEntry& Table::require(const char tag[4],
+                                 uint32_t   version,
+                                 size_t     size) const
+{
+    const ChunkEntry* entry = find(tag);
+    if (!entry) {
+        throw std::runtime_error("missing the " + tagName(tag) + " chunk");
+    }
+    if (entry->version != version) {
+        throw std::runtime_error("unsupported " + tagName(tag) +
+                                 " chunk version " +
+                                 std::to_string(entry->version));
+    }
+    if (size != 0 && entry->size != size) {
+        throw std::runtime_error("bad " + tagName(tag) + " chunk size");
+    }
+    return *entry;
+}
+
+} // namespace ciel::cachefile
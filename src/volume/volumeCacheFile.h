@@ -0,0 +1,102 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Volume cache files, shared by VolumeScalarMappedGrid and
+//  VolumeScalarPagedGrid.
+//
+//  Native endianness (little endian on every platform we
+//  build for):
+//
+//    FileHeader          64 bytes: magic, format version,
+//                        chunk count, source hash
+//    ChunkEntry[count]   32 bytes each: tag, chunk version,
+//                        offset and size of the payload
+//    payloads            each at a multiple of
+//                        kChunkAlignment
+//
+//  Readers skip chunks they do not know, so new ones can be
+//  added without a format version bump; a chunk whose
+//  layout changes bumps its own version.
+//
+// -------------------------------------------------------
+
+#include "denseGrid.h"
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace ciel::cachefile {
+
+// Payloads are page aligned so that they map without a copy
+constexpr size_t   kChunkAlignment = 4096;
+constexpr uint32_t kFormatVersion = 1;
+
+struct ChunkEntry
+{
+    char     tag[4];
+    uint32_t version;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t reserved;
+};
+
+// Payload of "GRID", version 1: the layout of the nodes and the value
+// outside of them
+struct GridChunk
+{
+    static constexpr char     kTag[4] = {'G', 'R', 'I', 'D'};
+    static constexpr uint32_t kVersion = 1;
+
+    float    boundMin[3];
+    float    boundMax[3];
+    uint32_t nodes[3];
+    float    background;
+
+    static GridChunk from(const GridLayout& layout, float background);
+    GridLayout       layout() const;
+};
+
+// A chunk to write: `write` streams exactly `size` bytes
+struct ChunkSource
+{
+    const char*                        tag;
+    uint32_t                           version;
+    size_t                             size;
+    std::function<void(std::ostream&)> write;
+};
+
+// Writes the chunks to `path`, through a temporary file renamed over it so
+// readers never see a partial file. Returns false (and prints the reason)
+// on failure.
+bool write(const std::string&           path,
+           uint64_t                     sourceHash,
+           std::span<const ChunkSource> chunks);
+
+// Reads the header and chunk table of the open file `fd` of `fileSize`
+// bytes and checks that every chunk lies within the file. Throws
+// std::runtime_error with the reason if it is not a cache file of a
+// version we know.
+struct Table
+{
+    uint64_t                sourceHash{0};
+    std::vector<ChunkEntry> chunks;
+
+    // The chunk with `tag`, nullptr if there is none
+    const ChunkEntry* find(const char tag[4]) const;
+    // The chunk with `tag`, which must be there in `version` with a payload
+    // of `size` bytes (any size if 0), or else throws
+    const ChunkEntry& require(const char tag[4],
+                              uint32_t   version,
+                              size_t     size = 0) const;
+};
+Table readTable(int fd, size_t fileSize);
+
+// pread() of the whole range, throws on failure
+void readAt(int fd, void* data, size_t size, uint64_t offset);
+
+} // namespace ciel::cachefile
@@ -0,0 +1,37 @@
+#include "volumeColorGrid.h"
+
+#include <limits>
+
+namespace ciel {
+
+VolumeColorGrid::Ptr
+VolumeColorGrid::bake(std::span<const VolumeScalar::Ptr> volumes,
+                      std::span<const Color>             colors,
+                      const GridLayout&                  layout)
+{
+    Ptr grid = create(layout);
+    grid->m_grid.fill([&](const Vector& p) {
+        Color  sum(0, 0, 0, 0);
+        float  weight = 0;
+        float  closest = std::numeric_limits<float>::lowest();
+        size_t closestIndex = 0;
+        for (size_t i = 0; i < volumes.size(); i++) {
+            const float val = volumes[i]->eval(p);
+            if (val > 0) {
+                sum += colors[i] * val;
+                weight += val;
+            }
+            if (val > closest) {
+                closest = val;
+                closestIndex = i;
+            }
+        }
+        if (weight > 0) {
+            return sum / weight;
+        }
+        return volumes.empty() ? s_background : colors[closestIndex];
+    });
+    return grid;
+}
+
+} // namespace ciel
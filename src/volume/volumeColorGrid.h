@@ -0,0 +1,69 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  A color volume sampled on a dense grid.
+//
+//  Blends the colors of several scalar volumes by their
+//  density once, at bake time, so that coloring a sample
+//  of a multi-volume scene is one trilinear lookup instead
+//  of evaluating and weighting every volume.
+//
+// -------------------------------------------------------
+
+#include "denseGrid.h"
+#include "math/color.h"
+#include "volumeBase.h"
+
+#include <span>
+
+namespace ciel {
+
+class VolumeColorGrid : public VolumeColor
+{
+public:
+    VolumeColorGrid(const GridLayout& layout)
+    : m_grid(layout, s_background)
+    {
+    }
+
+    using Ptr = std::shared_ptr<VolumeColorGrid>;
+    using ConstPtr = std::shared_ptr<const VolumeColorGrid>;
+
+    Color eval(const Vector& p) const override
+    {
+        return m_grid.sample(p, s_background);
+    }
+    void evalBatch(std::span<const Vector> p,
+                   std::span<Color>        out) const override
+    {
+        for (size_t i = 0; i < p.size(); i++) {
+            out[i] = m_grid.sample(p[i], s_background);
+        }
+    }
+    BBox bound() const override { return m_grid.layout().bound; }
+
+    static Ptr create(const GridLayout& layout)
+    {
+        return std::make_shared<VolumeColorGrid>(layout);
+    }
+
+    // Each node gets the colors of `volumes` weighted by their density
+    // (positive values) there. Nodes outside every volume take the color of
+    // the closest one (largest value), so interpolation across a surface
+    // does not fade to some unrelated color. Nodes are baked in parallel.
+    static Ptr bake(std::span<const VolumeScalar::Ptr> volumes,
+                    std::span<const Color>             colors,
+                    const GridLayout&                  layout);
+
+    const DenseGrid<Color>& grid() const { return m_grid; }
+    DenseGrid<Color>&       grid() { return m_grid; }
+
+private:
+    // outside the grid, same as a scene without colors
+    static constexpr Color s_background{1, 1, 1, 1};
+
+    DenseGrid<Color> m_grid;
+};
+
+} // namespace ciel
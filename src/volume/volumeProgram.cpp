@@ -0,0 +1,343 @@
+#include "volumeProgram.h"
+
+#include "volumeScalarBox.h"
+#include "volumeScalarCSG.h"
+#include "volumeScalarEllipse.h"
+#include "volumeScalarSphere.h"
+#include "volumeScalarTorus.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace ciel {
+
+// Emits the instructions in post order, one value per node, then maps the
+// values onto as few registers as their lifetimes allow.
+class VolumeProgramCompiler
+{
+public:
+    explicit VolumeProgramCompiler(VolumeProgram& program)
+    : m_program(program)
+    {
+    }
+
+    void compile(const VolumeScalar::Ptr& root)
+    {
+        m_program.m_result = emitNode(root);
+        allocateRegisters();
+    }
+
+private:
+    using OpCode = VolumeProgram::OpCode;
+
+    uint16_t emit(OpCode op, uint16_t a = 0, uint16_t b = 0, uint32_t data = 0)
+    {
+        const size_t value = m_program.m_code.size();
+        if (value > std::numeric_limits<uint16_t>::max()) {
+            throw std::length_error("Volume program too large");
+        }
+        m_program.m_code.push_back(
+            VolumeProgram::Instruction{op, (uint16_t)value, a, b, data});
+        return (uint16_t)value;
+    }
+
+    uint32_t constants(std::initializer_list<float> values)
+    {
+        const uint32_t offset = (uint32_t)m_program.m_constants.size();
+        m_program.m_constants.insert(
+            m_program.m_constants.end(), values.begin(), values.end());
+        return offset;
+    }
+
+    uint16_t emitNode(const VolumeScalar::Ptr& node)
+    {
+        const auto found = m_values.find(node.get());
+        if (found != m_values.end()) {
+            return found->second;
+        }
+        const uint16_t value = emitNodeOnce(node);
+        m_values.emplace(node.get(), value);
+        return value;
+    }
+
+    uint16_t emitNodeOnce(const VolumeScalar::Ptr& node)
+    {
+        const VolumeScalar* v = node.get();
+        if (auto s = dynamic_cast<const VolumeScalarSphere*>(v)) {
+            const Vector c = s->center();
+            return emit(OpCode::Sphere,
+                        0,
+                        0,
+                        constants({c.X(), c.Y(), c.Z(), s->radius()}));
+        }
+        if (auto s = dynamic_cast<const VolumeScalarBox*>(v)) {
+            const Vector c = s->Center();
+            const Vector b = s->Bound();
+            return emit(OpCode::Box,
+                        0,
+                        0,
+                        constants({c.X(),
+                                   c.Y(),
+                                   c.Z(),
+                                   b.X(),
+                                   b.Y(),
+                                   b.Z(),
+                                   s->Exp()}));
+        }
+        if (auto s = dynamic_cast<const VolumeScalarTorus*>(v)) {
+            const Vector c = s->center();
+            const Vector n = s->normal();
+            return emit(OpCode::Torus,
+                        0,
+                        0,
+                        constants({c.X(),
+                                   c.Y(),
+                                   c.Z(),
+                                   n.X(),
+                                   n.Y(),
+                                   n.Z(),
+                                   s->radius1(),
+                                   s->radius2()}));
+        }
+        if (auto s = dynamic_cast<const VolumeScalarEllipse*>(v)) {
+            const Vector c = s->center();
+            const Vector n = s->stretch();
+            return emit(OpCode::Ellipse,
+                        0,
+                        0,
+                        constants({c.X(),
+                                   c.Y(),
+                                   c.Z(),
+                                   n.X(),
+                                   n.Y(),
+                                   n.Z(),
+                                   s->radius1(),
+                                   s->radius2()}));
+        }
+        if (auto s = dynamic_cast<const VolumeScalarUnion*>(v)) {
+            return emitBinary(OpCode::Union, s->field1(), s->field2());
+        }
+        if (auto s = dynamic_cast<const VolumeScalarIntersection*>(v)) {
+            return emitBinary(OpCode::Intersection, s->field1(), s->field2());
+        }
+        if (auto s = dynamic_cast<const VolumeScalarCutout*>(v)) {
+            return emitBinary(OpCode::Cutout, s->field1(), s->field2());
+        }
+        if (auto s = dynamic_cast<const VolumeScalarShell*>(v)) {
+            const uint16_t a = emitNode(s->field());
+            return emit(OpCode::Shell, a, a, constants({s->thickness()}));
+        }
+        if (auto s = dynamic_cast<const VolumeScalarProgram*>(v)) {
+            return emitNode(s->source());
+        }
+
+        // anything else is evaluated through its own eval()
+        m_program.m_volumes.push_back(node);
+        return emit(OpCode::Volume,
+                    0,
+                    0,
+                    (uint32_t)(m_program.m_volumes.size() - 1));
+    }
+
+    uint16_t emitBinary(OpCode                   op,
+                        const VolumeScalar::Ptr& field1,
+                        const VolumeScalar::Ptr& field2)
+    {
+        const uint16_t a = emitNode(field1);
+        const uint16_t b = emitNode(field2);
+        return emit(op, a, b);
+    }
+
+    static bool hasOperands(OpCode op) { return op >= OpCode::Union; }
+
+    // Values are numbered by the instruction producing them. A register is
+    // freed after the last instruction reading its value, and may be reused
+    // as the destination of that same instruction since the interpreter
+    // works element by element.
+    void allocateRegisters()
+    {
+        std::vector<VolumeProgram::Instruction>& code = m_program.m_code;
+
+        std::vector<size_t> lastUse(code.size(), 0);
+        for (size_t i = 0; i < code.size(); i++) {
+            if (hasOperands(code[i].op)) {
+                lastUse[code[i].a] = i;
+                lastUse[code[i].b] = i;
+            }
+        }
+        lastUse[m_program.m_result] = code.size();
+
+        std::vector<uint16_t> reg(code.size(), 0);
+        std::vector<uint16_t> freeRegisters;
+        uint16_t              registerCount = 0;
+        for (size_t i = 0; i < code.size(); i++) {
+            VolumeProgram::Instruction& in = code[i];
+            if (hasOperands(in.op)) {
+                const uint16_t a = in.a;
+                const uint16_t b = in.b;
+                in.a = reg[a];
+                in.b = reg[b];
+                if (lastUse[a] == i) {
+                    freeRegisters.push_back(reg[a]);
+                }
+                if (lastUse[b] == i && b != a) {
+                    freeRegisters.push_back(reg[b]);
+                }
+            }
+            if (freeRegisters.empty()) {
+                reg[i] = registerCount++;
+            }
+            else {
+                reg[i] = freeRegisters.back();
+                freeRegisters.pop_back();
+            }
+            in.dst = reg[i];
+        }
+        m_program.m_result = reg[m_program.m_result];
+        m_program.m_registerCount = registerCount;
+    }
+
+    VolumeProgram&                                    m_program;
+    std::unordered_map<const VolumeScalar*, uint16_t> m_values;
+};
+
+VolumeProgram VolumeProgram::compile(const VolumeScalar::Ptr& root)
+{
+    VolumeProgram program;
+    VolumeProgramCompiler(program).compile(root);
+    return program;
+}
+
+namespace {
+
+// Registers and point coordinates of one batch, per thread. An opaque
+// volume may run a program of its own, so there is one buffer per depth.
+thread_local std::deque<std::vector<float>> tRegisterStack;
+thread_local size_t                         tDepth = 0;
+
+struct DepthGuard
+{
+    DepthGuard() { tDepth++; }
+    ~DepthGuard() { tDepth--; }
+};
+
+} // namespace
+
+// The leaf loops follow the kernels of the volume classes operation for
+// operation, so that a compiled tree gives the same values.
+void VolumeProgram::run(const Vector* points, size_t count, float* out) const
+{
+    constexpr size_t B = kBatchSize;
+    if (tRegisterStack.size() <= tDepth) {
+        tRegisterStack.resize(tDepth + 1);
+    }
+    std::vector<float>& registers = tRegisterStack[tDepth];
+    DepthGuard          guard;
+    registers.resize((m_registerCount + 3) * B);
+    float* px = registers.data() + m_registerCount * B;
+    float* py = px + B;
+    float* pz = py + B;
+
+    for (size_t base = 0; base < count; base += B) {
+        const size_t n = std::min(B, count - base);
+        for (size_t l = 0; l < n; l++) {
+            px[l] = points[base + l].X();
+            py[l] = points[base + l].Y();
+            pz[l] = points[base + l].Z();
+        }
+
+        for (const Instruction& in : m_code) {
+            float* const       r = registers.data() + in.dst * B;
+            const float* const a = registers.data() + in.a * B;
+            const float* const b = registers.data() + in.b * B;
+            const float* const k = m_constants.data() + in.data;
+
+            switch (in.op) {
+            case OpCode::Sphere:
+                for (size_t l = 0; l < n; l++) {
+                    const float x = px[l] - k[0];
+                    const float y = py[l] - k[1];
+                    const float z = pz[l] - k[2];
+                    r[l] = k[3] - std::sqrt(x * x + y * y + z * z);
+                }
+                break;
+            case OpCode::Box:
+                for (size_t l = 0; l < n; l++) {
+                    const float x = std::max(
+                        std::abs(px[l] - k[0]) - k[3] + k[6], 0.f);
+                    const float y = std::max(
+                        std::abs(py[l] - k[1]) - k[4] + k[6], 0.f);
+                    const float z = std::max(
+                        std::abs(pz[l] - k[2]) - k[5] + k[6], 0.f);
+                    const float sign = std::sqrt(x * x + y * y + z * z) - k[6];
+                    r[l] = sign < std::numeric_limits<float>::epsilon() ? 1.f
+                                                                        : -sign;
+                }
+                break;
+            case OpCode::Torus:
+                for (size_t l = 0; l < n; l++) {
+                    const float x = px[l] - k[0];
+                    const float y = py[l] - k[1];
+                    const float z = pz[l] - k[2];
+                    const float d = x * k[3] + y * k[4] + z * k[5];
+                    const float xx = x - d * k[3];
+                    const float xy = y - d * k[4];
+                    const float xz = z - d * k[5];
+                    const float rr = (x * x + y * y + z * z) + k[6] * k[6] -
+                                     k[7] * k[7];
+                    r[l] = (4.f * k[6] * k[6] * (xx * xx + xy * xy + xz * xz)) -
+                           rr * rr;
+                }
+                break;
+            case OpCode::Ellipse:
+                for (size_t l = 0; l < n; l++) {
+                    const float x = px[l] - k[0];
+                    const float y = py[l] - k[1];
+                    const float z = pz[l] - k[2];
+                    const float Z = x * k[3] + y * k[4] + z * k[5];
+                    const float xx = x - Z * k[3];
+                    const float xy = y - Z * k[4];
+                    const float xz = z - Z * k[5];
+                    r[l] = (1.f - (Z * Z) / k[6] * k[6] -
+                            (xx * xx + xy * xy + xz * xz) / k[7] * k[7]);
+                }
+                break;
+            case OpCode::Volume: {
+                m_volumes[in.data]->evalBatch(
+                    std::span<const Vector>(points + base, n),
+                    std::span<float>(r, n));
+                break;
+            }
+            case OpCode::Union:
+                for (size_t l = 0; l < n; l++) {
+                    r[l] = std::max(a[l], b[l]);
+                }
+                break;
+            case OpCode::Intersection:
+                for (size_t l = 0; l < n; l++) {
+                    r[l] = std::min(a[l], b[l]);
+                }
+                break;
+            case OpCode::Cutout:
+                for (size_t l = 0; l < n; l++) {
+                    r[l] = std::min(a[l], -1.f * b[l]);
+                }
+                break;
+            case OpCode::Shell:
+                for (size_t l = 0; l < n; l++) {
+                    r[l] = std::min((a[l] + k[0] / 2.f),
+                                    -1.f * (a[l] - k[0] / 2.f));
+                }
+                break;
+            }
+        }
+
+        std::copy_n(registers.data() + m_result * B, n, out + base);
+    }
+}
+
+} // namespace ciel
@@ -0,0 +1,131 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  CSG trees compiled to a flat register program.
+//
+//  VolumeProgram::compile() walks a VolumeScalar graph once
+//  and emits one instruction per node (shared nodes only
+//  once). run() then interprets the instructions over a
+//  batch of points, each instruction being a tight loop
+//  over the whole batch instead of a virtual call per node
+//  per point. Volumes it does not know are kept as opaque
+//  calls to their eval().
+//
+// -------------------------------------------------------
+
+#include "volumeBase.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ciel {
+
+class VolumeProgram
+{
+public:
+    enum class OpCode : uint8_t
+    {
+        // leaves, constants at Instruction::data
+        Sphere,  // center, radius
+        Box,     // center, bound, exponent
+        Torus,   // center, normal, radius1, radius2
+        Ellipse, // center, stretch, radius1, radius2
+        Volume,  // opaque volume, index at Instruction::data
+        // operations on registers a and b
+        Union,        // max(a, b)
+        Intersection, // min(a, b)
+        Cutout,       // min(a, -b)
+        Shell,        // min(a + t / 2, -(a - t / 2)), t at data
+    };
+
+    struct Instruction
+    {
+        OpCode   op;
+        uint16_t dst;
+        uint16_t a, b;
+        uint32_t data;
+    };
+
+    // points per interpreter pass
+    static constexpr size_t kBatchSize = 64;
+
+    static VolumeProgram compile(const VolumeScalar::Ptr& root);
+
+    // out[i] = root->eval(points[i])
+    void run(const Vector* points, size_t count, float* out) const;
+
+    const std::vector<Instruction>& instructions() const { return m_code; }
+    unsigned registerCount() const { return m_registerCount; }
+
+private:
+    std::vector<Instruction>       m_code;
+    std::vector<float>             m_constants;
+    std::vector<VolumeScalar::Ptr> m_volumes;
+    unsigned                       m_registerCount{0};
+    uint16_t                       m_result{0};
+
+    friend class VolumeProgramCompiler;
+};
+
+// A VolumeScalar that evaluates through a compiled program
+class VolumeScalarProgram : public VolumeScalar
+{
+public:
+    VolumeScalarProgram(const VolumeScalar::Ptr& source)
+    : m_source(source)
+    , m_program(VolumeProgram::compile(source))
+    , m_bound(source->bound())
+    {
+    }
+
+    using Ptr = std::shared_ptr<VolumeScalarProgram>;
+    using ConstPtr = std::shared_ptr<const VolumeScalarProgram>;
+
+    float eval(const Vector& p) const override
+    {
+        float result;
+        m_program.run(&p, 1, &result);
+        return result;
+    }
+    FloatP evalPacket(const VectorP& p) const override
+    {
+        Vector points[kPacketWidth];
+        float  values[kPacketWidth];
+        for (int i = 0; i < kPacketWidth; i++) {
+            points[i] = p.lane(i);
+        }
+        m_program.run(points, kPacketWidth, values);
+        return FloatP(values, stdx::element_aligned);
+    }
+    void evalBatch(std::span<const Vector> p,
+                   std::span<float>        out) const override
+    {
+        m_program.run(p.data(), p.size(), out.data());
+    }
+    BBox     bound() const override { return m_bound; }
+    Interval evalInterval(const BBox& box) const override
+    {
+        return m_source->evalInterval(box);
+    }
+    uint64_t hash() const override
+    {
+        // same as the tree it was compiled from
+        return m_source->hash();
+    }
+
+    static Ptr create(const VolumeScalar::Ptr& source)
+    {
+        return std::make_shared<VolumeScalarProgram>(source);
+    }
+
+    const VolumeScalar::Ptr& source() const { return m_source; }
+    const VolumeProgram&     program() const { return m_program; }
+
+private:
+    const VolumeScalar::Ptr m_source;
+    const VolumeProgram     m_program;
+    const BBox              m_bound;
+};
+
+} // namespace ciel
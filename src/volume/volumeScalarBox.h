@@ -18,15 +18,14 @@ public:
     using Ptr = std::shared_ptr<VolumeScalarBox>;
     using ConstPtr = std::shared_ptr<const VolumeScalarBox>;
 
-    float eval(const Vector& p) const override
+    float  eval(const Vector& p) const override { return kernel(p); }
+    FloatP evalPacket(const VectorP& p) const override { return kernel(p); }
+    void   evalBatch(std::span<const Vector> p,
+                     std::span<float>        out) const override
     {
-        const Vector q = abs(p - m_center) - m_bound + m_exp;
-
-        // The original equation equals d == 0 to be "inside", but our renderer
-        // is (d > 0) == "inside" so we do a bit of hack.
-        //    return length(max(q, 0)) - m_exp;
-        float sign = length(max(q, 0)) - m_exp;
-        return sign < std::numeric_limits<float>::epsilon() ? 1 : -sign;
+        evalBatchByPackets(p, out, [this](const VectorP& q) {
+            return kernel(q);
+        });
     }
 
     [[deprecated("Not Implemented!")]] Vector
@@ -35,6 +34,30 @@ public:
         return Vector{};
     }
 
+    BBox bound() const override
+    {
+        return BBox::fromCenter(m_center, abs(m_bound));
+    }
+    Interval evalInterval(const BBox& box) const override
+    {
+        const auto [x, y, z] = offsetIntervals(box, m_center);
+        const Interval zero(0);
+        const Interval qx = max(abs(x) - m_bound.X() + m_exp, zero);
+        const Interval qy = max(abs(y) - m_bound.Y() + m_exp, zero);
+        const Interval qz = max(abs(z) - m_bound.Z() + m_exp, zero);
+        const Interval sign = sqrt(sqr(qx) + sqr(qy) + sqr(qz)) - m_exp;
+
+        // kernel() maps sign < epsilon to 1 and the rest to -sign
+        const float eps = std::numeric_limits<float>::epsilon();
+        return Interval(sign.hi < eps ? 1.f : -sign.hi,
+                        sign.lo < eps ? 1.f : -sign.lo);
+    }
+    uint64_t hash() const override
+    {
+        const uint64_t h = hashCombine(hashString("box"), m_center);
+        return hashCombine(hashCombine(h, m_bound), m_exp);
+    }
+
     static Ptr create(const Vector& center, const Vector& bound, float exponent)
     {
         return std::make_shared<VolumeScalarBox>(center, bound, exponent);
@@ -53,6 +76,19 @@ public:
     void   SetExp(float exp) { m_exp = exp; }
 
 private:
+    // shared by eval() and evalPacket(), V is Vector or VectorN
+    template<typename V>
+    ScalarOf_t<V> kernel(const V& p) const
+    {
+        const V q = abs(p - m_center) - m_bound + m_exp;
+
+        // The original equation equals d == 0 to be "inside", but our renderer
+        // is (d > 0) == "inside" so we do a bit of hack.
+        //    return length(max(q, 0)) - m_exp;
+        const ScalarOf_t<V> sign = length(max(q, 0)) - m_exp;
+        return select(sign < std::numeric_limits<float>::epsilon(), 1.f, -sign);
+    }
+
     Vector m_center;
     Vector m_bound;
     float  m_exp; // determines the edge curvature (base = 1)
@@ -13,6 +13,27 @@
 
 namespace ciel {
 
+// evalBatch() of a binary operation: both children are evaluated over
+// chunks of the batch and combined with op(a, b)
+template<typename Op>
+void evalBatchBinary(const VolumeScalar&     field1,
+                     const VolumeScalar&     field2,
+                     std::span<const Vector> p,
+                     std::span<float>        out,
+                     Op&&                    op)
+{
+    constexpr size_t chunk = 64;
+    float            other[chunk];
+    for (size_t i = 0; i < p.size(); i += chunk) {
+        const size_t n = std::min(chunk, p.size() - i);
+        field1.evalBatch(p.subspan(i, n), out.subspan(i, n));
+        field2.evalBatch(p.subspan(i, n), std::span<float>(other, n));
+        for (size_t l = 0; l < n; l++) {
+            out[i + l] = op(out[i + l], other[l]);
+        }
+    }
+}
+
 class VolumeScalarUnion : public VolumeScalar
 {
 public:
@@ -24,6 +45,33 @@ public:
     {
         return std::max(mField1->eval(p), mField2->eval(p));
     }
+    FloatP evalPacket(const VectorP& p) const override
+    {
+        return stdx::max(mField1->evalPacket(p), mField2->evalPacket(p));
+    }
+    void evalBatch(std::span<const Vector> p,
+                   std::span<float>        out) const override
+    {
+        evalBatchBinary(*mField1, *mField2, p, out, [](float a, float b) {
+            return std::max(a, b);
+        });
+    }
+    BBox bound() const override
+    {
+        return mField1->bound().unite(mField2->bound());
+    }
+    Interval evalInterval(const BBox& box) const override
+    {
+        return max(mField1->evalInterval(box), mField2->evalInterval(box));
+    }
+    uint64_t hash() const override
+    {
+        return hashCombine(hashCombine(hashString("union"), mField1->hash()),
+                           mField2->hash());
+    }
+
+    const VolumeScalar::Ptr& field1() const { return mField1; }
+    const VolumeScalar::Ptr& field2() const { return mField2; }
 
 private:
     const VolumeScalar::Ptr mField1;
@@ -42,6 +90,34 @@ public:
     {
         return std::min(mField1->eval(p), mField2->eval(p));
     }
+    FloatP evalPacket(const VectorP& p) const override
+    {
+        return stdx::min(mField1->evalPacket(p), mField2->evalPacket(p));
+    }
+    void evalBatch(std::span<const Vector> p,
+                   std::span<float>        out) const override
+    {
+        evalBatchBinary(*mField1, *mField2, p, out, [](float a, float b) {
+            return std::min(a, b);
+        });
+    }
+    BBox bound() const override
+    {
+        return mField1->bound().intersect(mField2->bound());
+    }
+    Interval evalInterval(const BBox& box) const override
+    {
+        return min(mField1->evalInterval(box), mField2->evalInterval(box));
+    }
+    uint64_t hash() const override
+    {
+        const uint64_t h = hashCombine(hashString("intersection"),
+                                       mField1->hash());
+        return hashCombine(h, mField2->hash());
+    }
+
+    const VolumeScalar::Ptr& field1() const { return mField1; }
+    const VolumeScalar::Ptr& field2() const { return mField2; }
 
 private:
     const VolumeScalar::Ptr mField1;
@@ -59,6 +135,31 @@ public:
     {
         return std::min(mField1->eval(p), -1.f * mField2->eval(p));
     }
+    FloatP evalPacket(const VectorP& p) const override
+    {
+        return stdx::min(mField1->evalPacket(p),
+                         -1.f * mField2->evalPacket(p));
+    }
+    void evalBatch(std::span<const Vector> p,
+                   std::span<float>        out) const override
+    {
+        evalBatchBinary(*mField1, *mField2, p, out, [](float a, float b) {
+            return std::min(a, -1.f * b);
+        });
+    }
+    BBox     bound() const override { return mField1->bound(); }
+    Interval evalInterval(const BBox& box) const override
+    {
+        return min(mField1->evalInterval(box), -mField2->evalInterval(box));
+    }
+    uint64_t hash() const override
+    {
+        return hashCombine(hashCombine(hashString("cutout"), mField1->hash()),
+                           mField2->hash());
+    }
+
+    const VolumeScalar::Ptr& field1() const { return mField1; }
+    const VolumeScalar::Ptr& field2() const { return mField2; }
 
 private:
     const VolumeScalar::Ptr mField1;
@@ -68,13 +169,51 @@ private:
 class VolumeScalarShell : public VolumeScalar
 {
 public:
-    VolumeScalarShell(VolumeScalar::Ptr tField1, float tThickness);
+    VolumeScalarShell(VolumeScalar::Ptr tField1, float tThickness)
+    : mField(tField1)
+    , mThickness(tThickness) {};
 
     float eval(const Vector& p) const override
     {
         return std::min((mField->eval(p) + mThickness / 2.f),
                         -1.f * (mField->eval(p) - mThickness / 2.f));
     }
+    FloatP evalPacket(const VectorP& p) const override
+    {
+        const FloatP value = mField->evalPacket(p);
+        return stdx::min((value + mThickness / 2.f),
+                         -1.f * (value - mThickness / 2.f));
+    }
+    void evalBatch(std::span<const Vector> p,
+                   std::span<float>        out) const override
+    {
+        mField->evalBatch(p, out);
+        for (float& value : out) {
+            value = std::min((value + mThickness / 2.f),
+                             -1.f * (value - mThickness / 2.f));
+        }
+    }
+    // The shell is positive where |field| < thickness / 2. Assuming a
+    // distance-like field (gradient magnitude <= 1) that stays within
+    // thickness / 2 of the field's own bound.
+    BBox bound() const override
+    {
+        return mField->bound().expand(std::abs(mThickness) / 2.f);
+    }
+    Interval evalInterval(const BBox& box) const override
+    {
+        const Interval value = mField->evalInterval(box);
+        return min((value + mThickness / 2.f),
+                   -1.f * (value - mThickness / 2.f));
+    }
+    uint64_t hash() const override
+    {
+        return hashCombine(hashCombine(hashString("shell"), mField->hash()),
+                           mThickness);
+    }
+
+    const VolumeScalar::Ptr& field() const { return mField; }
+    float                    thickness() const { return mThickness; }
 
 private:
     const VolumeScalar::Ptr mField;
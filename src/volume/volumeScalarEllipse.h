@@ -3,6 +3,8 @@
 #include "math/vector.h"
 #include "volumeBase.h"
 
+#include <algorithm>
+
 namespace ciel {
 
 class VolumeScalarEllipse : public VolumeScalar
@@ -22,14 +24,14 @@ public:
     using Ptr = std::shared_ptr<VolumeScalarEllipse>;
     using ConstPtr = std::shared_ptr<const VolumeScalarEllipse>;
 
-    float eval(const Vector& p) const override
+    float  eval(const Vector& p) const override { return kernel(p); }
+    FloatP evalPacket(const VectorP& p) const override { return kernel(p); }
+    void   evalBatch(std::span<const Vector> p,
+                     std::span<float>        out) const override
     {
-        Vector x = p - m_center;
-        float  Z = x * m_stretch;
-        Vector xp = x - Z * m_stretch;
-
-        return (1 - (Z * Z) / m_radius1 * m_radius1 -
-                (xp * xp) / m_radius2 * m_radius2);
+        evalBatchByPackets(p, out, [this](const VectorP& q) {
+            return kernel(q);
+        });
     }
     [[deprecated("Not Implemented!")]] Vector
     dxdy([[maybe_unused]] const Vector& p) const override
@@ -37,6 +39,38 @@ public:
         return Vector{};
     }
 
+    // Bounding sphere. Note that kernel() as written reduces to
+    // 1 - Z^2 - |xp|^2 (the radii cancel out), so this covers both the unit
+    // ball and the ellipsoid of the radii. The 1 - a + a^2 term accounts for
+    // a stretch vector shorter than 1.
+    BBox bound() const override
+    {
+        const float a = m_stretch * m_stretch;
+        const float r = std::max({std::abs(m_radius1),
+                                  std::abs(m_radius2),
+                                  1.f}) /
+                        std::sqrt(std::min(1.f, 1.f - a + a * a));
+        return BBox::fromCenter(m_center, Vector(r));
+    }
+    Interval evalInterval(const BBox& box) const override
+    {
+        const auto [x, y, z] = offsetIntervals(box, m_center);
+        const Interval Z = x * m_stretch.X() + y * m_stretch.Y() +
+                           z * m_stretch.Z();
+        const Interval xpx = x - Z * m_stretch.X();
+        const Interval xpy = y - Z * m_stretch.Y();
+        const Interval xpz = z - Z * m_stretch.Z();
+
+        return (1.f - sqr(Z) / m_radius1 * m_radius1 -
+                (sqr(xpx) + sqr(xpy) + sqr(xpz)) / m_radius2 * m_radius2);
+    }
+    uint64_t hash() const override
+    {
+        const uint64_t h = hashCombine(hashString("ellipse"), m_center);
+        return hashCombine(hashCombine(hashCombine(h, m_stretch), m_radius1),
+                           m_radius2);
+    }
+
     static Ptr create(const Vector& tCenter,
                       const Vector& tStretch,
                       float         tRadius1,
@@ -58,10 +92,24 @@ public:
     Vector stretch() const { return m_stretch; }
     void   setCenter(const Vector& center) { m_center = center; }
     void   setStretch(const Vector& stretch) { m_stretch = stretch; }
+    float  radius1() const { return m_radius1; }
+    float  radius2() const { return m_radius2; }
     void   setRadius1(float radius) { m_radius1 = radius; }
     void   setRadius2(float radius) { m_radius2 = radius; }
 
 private:
+    // shared by eval() and evalPacket(), V is Vector or VectorN
+    template<typename V>
+    ScalarOf_t<V> kernel(const V& p) const
+    {
+        const V             x = p - m_center;
+        const ScalarOf_t<V> Z = x * m_stretch;
+        const V             xp = x - Z * m_stretch;
+
+        return (1.f - (Z * Z) / m_radius1 * m_radius1 -
+                (xp * xp) / m_radius2 * m_radius2);
+    }
+
     Vector m_center;
     Vector m_stretch;
     float  m_radius1;
@@ -0,0 +1,221 @@
+#include "volumeScalarGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace ciel {
+
+VolumeScalarGrid::Ptr
+VolumeScalarGrid::bake(const VolumeScalar::Ptr& source,
+                       const BBox&              bound,
+                       unsigned                 resolution)
+{
+    return bake(source, GridLayout::fromResolution(bound, resolution));
+}
+
+VolumeScalarGrid::Ptr VolumeScalarGrid::bake(const VolumeScalar::Ptr& source,
+                                             const GridLayout&        layout)
+{
+    Ptr               grid = create(layout);
+    const GridLayout& l = layout;
+    DenseGrid<float>& g = grid->grid();
+
+    // one evalBatch() per row of nodes, so that sources with a SIMD kernel
+    // (noise, CSG, programs) bake a packet at a time
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif // _OPENMP
+    for (unsigned k = 0; k < l.nz; k++) {
+        std::vector<Vector> row(l.nx);
+        for (unsigned j = 0; j < l.ny; j++) {
+            for (unsigned i = 0; i < l.nx; i++) {
+                row[i] = l.position(i, j, k);
+            }
+            source->evalBatch(row, std::span<float>(&g.at(0, j, k), l.nx));
+        }
+    }
+    grid->updateRanges();
+    return grid;
+}
+
+VolumeScalarGrid::Ptr
+VolumeScalarGrid::bake(const VolumeScalar::Ptr& source,
+                       unsigned                 resolution)
+{
+    const BBox bound = source->bound();
+    if (bound.isEmpty() || bound.isInfinite()) {
+        return nullptr;
+    }
+    return bake(source, bound, resolution);
+}
+
+uint64_t VolumeScalarGrid::hash() const
+{
+    // a second caller waits for the first one's hash instead of racing it
+    std::lock_guard<std::mutex> lock(m_hashMutex);
+    if (m_hashVersion == m_version) {
+        return m_hash;
+    }
+
+    // slices in parallel, then their hashes in order
+    const GridLayout&     l = m_grid.layout();
+    const size_t          slice = (size_t)l.nx * l.ny;
+    std::vector<uint64_t> slices(l.nz);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif // _OPENMP
+    for (unsigned k = 0; k < l.nz; k++) {
+        const float* nodes = m_grid.data() + k * slice;
+        uint64_t     h = 0;
+        for (size_t n = 0; n < slice; n++) {
+            h = hashCombine(h, nodes[n]);
+        }
+        slices[k] = h;
+    }
+
+    uint64_t h = hashCombine(hashString("grid"), l.bound.min());
+    h = hashCombine(h, l.bound.max());
+    h = hashCombine(h, (uint64_t)l.nx);
+    h = hashCombine(h, (uint64_t)l.ny);
+    h = hashCombine(h, (uint64_t)l.nz);
+    h = hashCombine(h, m_background);
+    for (const uint64_t s : slices) {
+        h = hashCombine(h, s);
+    }
+    m_hash = h;
+    m_hashVersion = m_version;
+    return h;
+}
+
+void GridRanges::resize(const GridLayout& layout)
+{
+    const unsigned n[3] = {layout.nx, layout.ny, layout.nz};
+    for (int a = 0; a < 3; a++) {
+        m_blocks[a] = std::max(1u, (n[a] - 1 + kBlockSize - 1) / kBlockSize);
+    }
+    m_ranges.assign((size_t)m_blocks[0] * m_blocks[1] * m_blocks[2],
+                    Interval());
+}
+
+bool GridRanges::assign(const GridLayout&         layout,
+                        std::span<const Interval> ranges)
+{
+    resize(layout);
+    if (ranges.size() != m_ranges.size()) {
+        m_ranges.clear();
+        return false;
+    }
+    std::copy(ranges.begin(), ranges.end(), m_ranges.begin());
+    return true;
+}
+
+void GridRanges::build(const GridLayout& layout, const float* nodes)
+{
+    resize(layout);
+    const GridLayout& l = layout;
+    const unsigned    n[3] = {l.nx, l.ny, l.nz};
+
+    // a block holds the nodes on both of its faces, as its cells read them
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif // _OPENMP
+    for (unsigned bk = 0; bk < m_blocks[2]; bk++) {
+        for (unsigned bj = 0; bj < m_blocks[1]; bj++) {
+            for (unsigned bi = 0; bi < m_blocks[0]; bi++) {
+                const unsigned b[3] = {bi, bj, bk};
+                unsigned       lo[3], hi[3];
+                for (int a = 0; a < 3; a++) {
+                    lo[a] = b[a] * kBlockSize;
+                    hi[a] = std::min(lo[a] + kBlockSize, n[a] - 1);
+                }
+                float vMin = std::numeric_limits<float>::max();
+                float vMax = std::numeric_limits<float>::lowest();
+                for (unsigned k = lo[2]; k <= hi[2]; k++) {
+                    for (unsigned j = lo[1]; j <= hi[1]; j++) {
+                        for (unsigned i = lo[0]; i <= hi[0]; i++) {
+                            const float v = nodes[l.index(i, j, k)];
+                            vMin = std::min(vMin, v);
+                            vMax = std::max(vMax, v);
+                        }
+                    }
+                }
+                m_ranges[((size_t)bk * m_blocks[1] + bj) * m_blocks[0] + bi] =
+                    Interval(vMin, vMax);
+            }
+        }
+    }
+}
+
+// Trilinear interpolation stays within the values of the cell's nodes, so
+// the nodes of the cells overlapping the box bound it
+Interval GridRanges::evalInterval(const GridLayout& layout,
+                                  const float*      nodes,
+                                  const BBox&       box,
+                                  float             background) const
+{
+    const GridLayout& l = layout;
+    const BBox        overlap = box.intersect(l.bound);
+    if (overlap.isEmpty()) {
+        return Interval(background);
+    }
+
+    unsigned lo[3], hi[3];
+    size_t   count = 1;
+    for (int a = 0; a < 3; a++) {
+        const unsigned n = a == 0 ? l.nx : (a == 1 ? l.ny : l.nz);
+        const float    g0 = (overlap.min()[a] - l.bound.min()[a]) *
+                         l.invVoxelSize[a];
+        const float    g1 = (overlap.max()[a] - l.bound.min()[a]) *
+                         l.invVoxelSize[a];
+        lo[a] = std::min((unsigned)std::max(std::floor(g0), 0.f), n - 1);
+        hi[a] = std::min((unsigned)std::max(std::ceil(g1), 0.f), n - 1);
+        count *= hi[a] - lo[a] + 1;
+    }
+
+    Interval result(std::numeric_limits<float>::max(),
+                    std::numeric_limits<float>::lowest());
+    if (count <= s_maxIntervalNodes) {
+        for (unsigned k = lo[2]; k <= hi[2]; k++) {
+            for (unsigned j = lo[1]; j <= hi[1]; j++) {
+                for (unsigned i = lo[0]; i <= hi[0]; i++) {
+                    result = hull(result, Interval(nodes[l.index(i, j, k)]));
+                }
+            }
+        }
+    }
+    else {
+        if (m_ranges.empty()) {
+            return Interval::infinite();
+        }
+        // the blocks holding the cells of the node range
+        count = 1;
+        for (int a = 0; a < 3; a++) {
+            lo[a] = std::min(lo[a] / kBlockSize, m_blocks[a] - 1);
+            hi[a] = std::clamp(hi[a] > 0 ? (hi[a] - 1) / kBlockSize : 0,
+                               lo[a],
+                               m_blocks[a] - 1);
+            count *= hi[a] - lo[a] + 1;
+        }
+        if (count > s_maxIntervalBlocks) {
+            return Interval::infinite();
+        }
+        for (unsigned k = lo[2]; k <= hi[2]; k++) {
+            for (unsigned j = lo[1]; j <= hi[1]; j++) {
+                for (unsigned i = lo[0]; i <= hi[0]; i++) {
+                    result = hull(
+                        result,
+                        m_ranges[((size_t)k * m_blocks[1] + j) * m_blocks[0] +
+                                 i]);
+                }
+            }
+        }
+    }
+    // parts of the box outside the grid read as background
+    if (!l.bound.contains(box.min()) || !l.bound.contains(box.max())) {
+        result = hull(result, Interval(background));
+    }
+    return result;
+}
+
+} // namespace ciel
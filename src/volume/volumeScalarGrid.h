@@ -0,0 +1,157 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  A scalar volume sampled on a dense grid.
+//
+//  Any VolumeScalar can be baked into it once, after which
+//  eval() costs a single trilinear lookup no matter how
+//  expensive the source was (CSG trees, noise, ...).
+//
+// -------------------------------------------------------
+
+#include "denseGrid.h"
+#include "volumeBase.h"
+
+#include <limits>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace ciel {
+
+// Value range of each block of kBlockSize^3 cells of a float grid, for
+// interval bounds over boxes that would touch too many nodes to scan. Does
+// not own the nodes, so it serves grids in memory and mapped from files.
+class GridRanges
+{
+public:
+    static constexpr unsigned kBlockSize = 4;
+
+    // Scans the nodes of a grid laid out by `layout`
+    void build(const GridLayout& layout, const float* nodes);
+    // Takes ranges built before, false if they do not fit `layout`
+    bool assign(const GridLayout& layout, std::span<const Interval> ranges);
+    std::span<const Interval> ranges() const { return m_ranges; }
+
+    // Exact over the nodes for small boxes, over the block ranges for
+    // larger ones. Parts of the box outside the grid read as `background`.
+    Interval evalInterval(const GridLayout& layout,
+                          const float*      nodes,
+                          const BBox&       box,
+                          float             background) const;
+
+private:
+    // evalInterval() scans at most this many nodes, or else this many
+    // blocks. Larger boxes get an unbounded interval.
+    static constexpr size_t s_maxIntervalNodes = 64;
+    static constexpr size_t s_maxIntervalBlocks = 512;
+
+    void resize(const GridLayout& layout);
+
+    unsigned              m_blocks[3]{0, 0, 0};
+    std::vector<Interval> m_ranges;
+};
+
+class VolumeScalarGrid : public VolumeScalar
+{
+public:
+    VolumeScalarGrid(const GridLayout& layout)
+    : m_grid(layout, s_background)
+    {
+    }
+
+    using Ptr = std::shared_ptr<VolumeScalarGrid>;
+    using ConstPtr = std::shared_ptr<const VolumeScalarGrid>;
+
+    float eval(const Vector& p) const override
+    {
+        return m_grid.sample(p, m_background);
+    }
+    FloatP evalPacket(const VectorP& p) const override
+    {
+        FloatP result;
+        for (int i = 0; i < kPacketWidth; i++) {
+            result[i] = m_grid.sample(p.lane(i), m_background);
+        }
+        return result;
+    }
+    void evalBatch(std::span<const Vector> p,
+                   std::span<float>        out) const override
+    {
+        for (size_t i = 0; i < p.size(); i++) {
+            out[i] = m_grid.sample(p[i], m_background);
+        }
+    }
+    BBox bound() const override { return m_grid.layout().bound; }
+    // Exact over the nodes for small boxes, over the block ranges (see
+    // updateRanges()) for larger ones
+    Interval evalInterval(const BBox& box) const override
+    {
+        return m_ranges.evalInterval(
+            m_grid.layout(), m_grid.data(), box, m_background);
+    }
+    // Over the layout, background and nodes, so that equal grids match
+    // across runs. The nodes are hashed again after each edit, see
+    // updateRanges(). Safe to call from several threads.
+    uint64_t hash() const override;
+
+    static Ptr create(const GridLayout& layout)
+    {
+        return std::make_shared<VolumeScalarGrid>(layout);
+    }
+
+    // Samples `source` at every grid node, in parallel.
+    // `resolution` is the number of nodes along the longest side of `bound`.
+    static Ptr bake(const VolumeScalar::Ptr& source,
+                    const BBox&              bound,
+                    unsigned                 resolution);
+    static Ptr bake(const VolumeScalar::Ptr& source, const GridLayout& layout);
+    // Over the source's own bound, nullptr if it is unbounded
+    static Ptr bake(const VolumeScalar::Ptr& source, unsigned resolution);
+
+    // Sets every node to f(position), in parallel
+    template<typename F>
+    void fill(F&& f)
+    {
+        m_grid.fill(std::forward<F>(f));
+        updateRanges();
+    }
+
+    // Recomputes the value range of each block of GridRanges::kBlockSize^3
+    // cells that evalInterval() uses for large boxes and changes hash().
+    // fill() does it, call it after writing nodes through grid().
+    void updateRanges()
+    {
+        m_ranges.build(m_grid.layout(), m_grid.data());
+        m_version++;
+    }
+
+    const DenseGrid<float>& grid() const { return m_grid; }
+    DenseGrid<float>&       grid() { return m_grid; }
+    const GridRanges&       ranges() const { return m_ranges; }
+
+    // Value outside the grid bound. Defaults to the lowest float so that it
+    // reads as "empty" through any CSG operation.
+    float background() const { return m_background; }
+    void  setBackground(float background)
+    {
+        m_background = background;
+        m_version++;
+    }
+
+private:
+    static constexpr float s_background = std::numeric_limits<float>::lowest();
+
+    DenseGrid<float> m_grid;
+    float            m_background{s_background};
+    GridRanges       m_ranges;
+    uint64_t         m_version{0}; // bumped by every edit
+
+    // hash() as of m_hashVersion, guarded by m_hashMutex
+    mutable std::mutex m_hashMutex;
+    mutable uint64_t   m_hash{0};
+    mutable uint64_t   m_hashVersion{~0ull};
+};
+
+} // namespace ciel
@@ -0,0 +1,131 @@
+#include "volumeScalarMappedGrid.h"
+
+#include "volumeCacheFile.h"
+
+#include <fcntl.h>
+#include <iostream>
+#include <ostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ciel {
+
+namespace {
+
+constexpr char     kNodeTag[4] = {'N', 'O', 'D', 'E'};
+constexpr char     kRangeTag[4] = {'R', 'N', 'G', 'E'};
+constexpr uint32_t kNodeVersion = 1;
+constexpr uint32_t kRangeVersion = 1;
+
+static_assert(sizeof(Interval) == 2 * sizeof(float));
+
+} // namespace
+
+VolumeScalarMappedGrid::~VolumeScalarMappedGrid()
+{
+    if (m_mapping) {
+        munmap(m_mapping, m_size);
+    }
+}
+
+bool VolumeScalarMappedGrid::write(const std::string&      path,
+                                   const VolumeScalarGrid& grid,
+                                   uint64_t                sourceHash)
+{
+    using cachefile::GridChunk;
+    const GridLayout&               l = grid.grid().layout();
+    const GridChunk                 g = GridChunk::from(l, grid.background());
+    const std::span<const Interval> ranges = grid.ranges().ranges();
+    auto bytes = [](const void* data, size_t size) {
+        return [=](std::ostream& out) {
+            out.write(static_cast<const char*>(data), size);
+        };
+    };
+    const size_t                 nodeBytes = l.voxelCount() * sizeof(float);
+    const cachefile::ChunkSource chunks[] = {
+        {GridChunk::kTag,
+         GridChunk::kVersion,
+         sizeof(g),
+         bytes(&g, sizeof(g))},
+        {kNodeTag,
+         kNodeVersion,
+         nodeBytes,
+         bytes(grid.grid().data(), nodeBytes)},
+        {kRangeTag,
+         kRangeVersion,
+         ranges.size_bytes(),
+         bytes(ranges.data(), ranges.size_bytes())},
+    };
+    return cachefile::write(path, sourceHash, chunks);
+}
+
+VolumeScalarMappedGrid::Ptr VolumeScalarMappedGrid::open(
+    const std::string& path)
+{
+    using cachefile::GridChunk;
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "[ciel][cache] " << path << ": cannot open the file"
+                  << std::endl;
+        return nullptr;
+    }
+    Ptr grid(new VolumeScalarMappedGrid());
+    try {
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            throw std::runtime_error("cannot stat the file");
+        }
+        const cachefile::Table table = cachefile::readTable(fd, info.st_size);
+        const cachefile::ChunkEntry& gridEntry = table.require(
+            GridChunk::kTag, GridChunk::kVersion, sizeof(GridChunk));
+        GridChunk g;
+        cachefile::readAt(fd, &g, sizeof(g), gridEntry.offset);
+        grid->m_layout = g.layout();
+        grid->m_background = g.background;
+        grid->m_sourceHash = table.sourceHash;
+        const cachefile::ChunkEntry& nodeEntry = table.require(
+            kNodeTag,
+            kNodeVersion,
+            grid->m_layout.voxelCount() * sizeof(float));
+
+        // the mapping stays valid once the descriptor is closed
+        grid->m_size = info.st_size;
+        void* mapping = mmap(
+            nullptr, grid->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("cannot map the file");
+        }
+        grid->m_mapping = mapping;
+        const char* bytes = static_cast<const char*>(mapping);
+        grid->m_nodes = reinterpret_cast<const float*>(bytes +
+                                                       nodeEntry.offset);
+
+        // the ranges are small, a copy saves scanning every node; without
+        // them (or of another version) they are rebuilt, which reads the
+        // whole file
+        const cachefile::ChunkEntry* rangeEntry = table.find(kRangeTag);
+        const bool ranges = rangeEntry &&
+                            rangeEntry->version == kRangeVersion &&
+                            grid->m_ranges.assign(
+                                grid->m_layout,
+                                std::span<const Interval>(
+                                    reinterpret_cast<const Interval*>(
+                                        bytes + rangeEntry->offset),
+                                    rangeEntry->size / sizeof(Interval)));
+        if (!ranges) {
+            grid->m_ranges.build(grid->m_layout, grid->m_nodes);
+        }
+    }
+    catch (const std::exception& e) {
+        ::close(fd);
+        std::cerr << "[ciel][cache] " << path << ": " << e.what() << std::endl;
+        return nullptr;
+    }
+    ::close(fd);
+    return grid;
+}
+
+} // namespace ciel
@@ -0,0 +1,97 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  A dense scalar grid sampled straight from a memory
+//  mapped cache file.
+//
+//  write() stores a baked VolumeScalarGrid in a binary
+//  file, open() maps one back in. Nothing is read or
+//  copied up front: the nodes are sampled in place and the
+//  OS pages them in as rays touch them, so reusing a bake
+//  costs milliseconds however large it is.
+//
+//  The file (see volumeCacheFile.h) holds the chunks
+//  "GRID" the layout and background, "NODE" the node
+//  values (x fastest) and "RNGE" the GridRanges blocks.
+//
+// -------------------------------------------------------
+
+#include "volumeScalarGrid.h"
+
+#include <cstdint>
+#include <string>
+
+namespace ciel {
+
+class VolumeScalarMappedGrid : public VolumeScalar
+{
+public:
+    using Ptr = std::shared_ptr<VolumeScalarMappedGrid>;
+    using ConstPtr = std::shared_ptr<const VolumeScalarMappedGrid>;
+
+    VolumeScalarMappedGrid(const VolumeScalarMappedGrid&) = delete;
+    VolumeScalarMappedGrid& operator=(const VolumeScalarMappedGrid&) = delete;
+    ~VolumeScalarMappedGrid();
+
+    // Writes `grid` to `path`, tagged with `sourceHash`, the content hash of
+    // what was baked. The file is written next to `path` and renamed over
+    // it, so readers never see a partial file. Returns false (and prints the
+    // reason) on failure.
+    static bool write(const std::string&      path,
+                      const VolumeScalarGrid& grid,
+                      uint64_t                sourceHash);
+    // Maps the file at `path`. Returns nullptr (and prints the reason) if it
+    // cannot be read or is not a cache file of a version we know.
+    static Ptr open(const std::string& path);
+
+    float eval(const Vector& p) const override
+    {
+        return m_layout.sample(m_nodes, p, m_background);
+    }
+    FloatP evalPacket(const VectorP& p) const override
+    {
+        FloatP result;
+        for (int i = 0; i < kPacketWidth; i++) {
+            result[i] = m_layout.sample(m_nodes, p.lane(i), m_background);
+        }
+        return result;
+    }
+    void evalBatch(std::span<const Vector> p,
+                   std::span<float>        out) const override
+    {
+        for (size_t i = 0; i < p.size(); i++) {
+            out[i] = m_layout.sample(m_nodes, p[i], m_background);
+        }
+    }
+    BBox     bound() const override { return m_layout.bound; }
+    Interval evalInterval(const BBox& box) const override
+    {
+        return m_ranges.evalInterval(m_layout, m_nodes, box, m_background);
+    }
+    // Bakes of the same source (and resolution, if part of the source hash)
+    // are the same grid
+    uint64_t hash() const override
+    {
+        return hashCombine(hashString("mappedGrid"), m_sourceHash);
+    }
+
+    const GridLayout& layout() const { return m_layout; }
+    const float*      nodes() const { return m_nodes; }
+    float             background() const { return m_background; }
+    uint64_t          sourceHash() const { return m_sourceHash; }
+    size_t            mappedBytes() const { return m_size; }
+
+private:
+    VolumeScalarMappedGrid() = default;
+
+    void*        m_mapping{nullptr};
+    size_t       m_size{0};
+    const float* m_nodes{nullptr}; // into the mapping
+    GridLayout   m_layout;
+    float        m_background{0};
+    uint64_t     m_sourceHash{0};
+    GridRanges   m_ranges;
+};
+
+} // namespace ciel
@@ -0,0 +1,135 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Procedural noise displacement of a scalar volume.
+//
+//  FBm adds fractal noise to the base field, softening
+//  its surface into a cloud. Pyroclastic adds the absolute
+//  value of it, so the surface only billows outward, the
+//  way smoke and explosions are usually modelled.
+//
+//  Noise is costly to evaluate, so evalBatch() runs it a
+//  packet at a time (see noise.h), and for repeated renders
+//  the volume is best baked into a grid.
+//
+// -------------------------------------------------------
+
+#include "noise.h"
+#include "volumeBase.h"
+
+#include <cmath>
+
+namespace ciel {
+
+class VolumeScalarNoise : public VolumeScalar
+{
+public:
+    enum class Mode
+    {
+        FBm,        // base + amplitude * fbm(p)
+        Pyroclastic // base + amplitude * |fbm(p)|
+    };
+
+    VolumeScalarNoise(VolumeScalar::Ptr  tField,
+                      Mode               tMode,
+                      float              tAmplitude,
+                      const NoiseParams& tParams)
+    : mField(tField)
+    , mMode(tMode)
+    , mAmplitude(tAmplitude)
+    , mParams(tParams)
+    {
+    }
+
+    using Ptr = std::shared_ptr<VolumeScalarNoise>;
+    using ConstPtr = std::shared_ptr<const VolumeScalarNoise>;
+
+    static Ptr createFBm(VolumeScalar::Ptr  field,
+                         float              amplitude,
+                         const NoiseParams& params = {})
+    {
+        return std::make_shared<VolumeScalarNoise>(
+            field, Mode::FBm, amplitude, params);
+    }
+    static Ptr createPyroclastic(VolumeScalar::Ptr  field,
+                                 float              amplitude,
+                                 const NoiseParams& params = {})
+    {
+        return std::make_shared<VolumeScalarNoise>(
+            field, Mode::Pyroclastic, amplitude, params);
+    }
+
+    float eval(const Vector& p) const override
+    {
+        return mField->eval(p) + displacement(p);
+    }
+    FloatP evalPacket(const VectorP& p) const override
+    {
+        return mField->evalPacket(p) + displacement(p);
+    }
+    void evalBatch(std::span<const Vector> p,
+                   std::span<float>        out) const override
+    {
+        mField->evalBatch(p, out);
+        // on the stack: a noise volume under the field may be evaluating
+        // its own batch at the same time
+        constexpr size_t chunk = 64;
+        float            noise[chunk];
+        for (size_t i = 0; i < p.size(); i += chunk) {
+            const size_t n = std::min(chunk, p.size() - i);
+            evalBatchByPackets(p.subspan(i, n),
+                               std::span<float>(noise, n),
+                               [this](const VectorP& q) {
+                                   return displacement(q);
+                               });
+            for (size_t l = 0; l < n; l++) {
+                out[i + l] += noise[l];
+            }
+        }
+    }
+    // Assuming a distance-like base field (gradient magnitude <= 1), the
+    // surface moves out by at most the largest displacement
+    BBox bound() const override
+    {
+        return mField->bound().expand(std::abs(mAmplitude) * mParams.bound());
+    }
+    Interval evalInterval(const BBox& box) const override
+    {
+        const float bound = mParams.bound();
+        const Interval noise = mMode == Mode::FBm ? Interval(-bound, bound)
+                                                  : Interval(0, bound);
+        return mField->evalInterval(box) + noise * mAmplitude;
+    }
+    uint64_t hash() const override
+    {
+        uint64_t h = hashCombine(hashString("noise"), mField->hash());
+        h = hashCombine(hashCombine(h, (uint64_t)mMode), mAmplitude);
+        return hashCombine(h, mParams.hash());
+    }
+
+    const VolumeScalar::Ptr& field() const { return mField; }
+    Mode                     mode() const { return mMode; }
+    float                    amplitude() const { return mAmplitude; }
+    const NoiseParams&       params() const { return mParams; }
+
+private:
+    // shared by eval() and evalPacket(), V is Vector or VectorN
+    template<typename V>
+    ScalarOf_t<V> displacement(const V& p) const
+    {
+        const ScalarOf_t<V> n = fbm(p, mParams);
+        if (mMode == Mode::FBm) {
+            return mAmplitude * n;
+        }
+        using std::abs;
+        return mAmplitude * abs(n);
+    }
+
+    const VolumeScalar::Ptr mField;
+    const Mode              mMode;
+    const float             mAmplitude;
+    const NoiseParams       mParams;
+};
+
+} // namespace ciel
@@ -0,0 +1,516 @@
+#include "volumeScalarPagedGrid.h"
+
+#include "volumeCacheFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fcntl.h>
+#include <iostream>
+#include <ostream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ciel {
+
+namespace {
+
+constexpr char     kBrickTag[4] = {'B', 'R', 'C', 'K'};
+constexpr char     kTableTag[4] = {'B', 'T', 'A', 'B'};
+constexpr uint32_t kBrickVersion = 1;
+constexpr uint32_t kTableVersion = 1;
+
+constexpr size_t kBrickStride =
+    (VolumeScalarPagedGrid::kBrickBytes +
+     VolumeScalarPagedGrid::kBrickAlignment - 1) /
+    VolumeScalarPagedGrid::kBrickAlignment *
+    VolumeScalarPagedGrid::kBrickAlignment;
+
+// bricks sampled at once by write()
+constexpr size_t kWriteBatch = 64;
+
+// payload of "BTAB", version 1: a header, then one entry per brick
+struct TableHeader
+{
+    uint32_t brickSize;
+    uint32_t bricks[3];
+    uint64_t brickStride;
+};
+struct TableEntry
+{
+    float    lo, hi;
+    uint64_t slot;
+};
+
+static_assert(sizeof(TableHeader) == 24);
+static_assert(sizeof(TableEntry) == 16);
+
+std::atomic<uint64_t> s_nextId{1};
+
+unsigned bricksAlong(unsigned nodes)
+{
+    const unsigned B = VolumeScalarPagedGrid::kBrickSize;
+    return std::max(1u, (nodes - 1 + B - 1) / B);
+}
+
+} // namespace
+
+VolumeScalarPagedGrid::~VolumeScalarPagedGrid()
+{
+    if (m_prefetcher.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            m_stop = true;
+        }
+        m_queueReady.notify_one();
+        m_prefetcher.join();
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+bool VolumeScalarPagedGrid::write(const std::string&  path,
+                                  const VolumeScalar& source,
+                                  const GridLayout&   layout,
+                                  uint64_t            sourceHash,
+                                  float               background)
+{
+    using cachefile::GridChunk;
+    const GridLayout& l = layout;
+    const unsigned    n[3] = {l.nx, l.ny, l.nz};
+    const unsigned    counts[3] = {
+        bricksAlong(l.nx), bricksAlong(l.ny), bricksAlong(l.nz)};
+    const size_t bricks = (size_t)counts[0] * counts[1] * counts[2];
+
+    const GridChunk         g = GridChunk::from(l, background);
+    const TableHeader       header{
+        kBrickSize, {counts[0], counts[1], counts[2]}, kBrickStride};
+    std::vector<TableEntry> table(bricks);
+
+    // Bricks are sampled kWriteBatch at a time, in parallel, and written
+    // in order. Single valued bricks are skipped over, which leaves holes
+    // in the file where the file system supports them.
+    auto writeBricks = [&](std::ostream& out) {
+        std::vector<float> batch(kWriteBatch * kBrickBytes / sizeof(float));
+        uint64_t           slot = 0;
+        for (size_t first = 0; first < bricks; first += kWriteBatch) {
+            const size_t count = std::min(kWriteBatch, bricks - first);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif // _OPENMP
+            for (size_t b = 0; b < count; b++) {
+                const size_t   index = first + b;
+                const unsigned bi = index % counts[0];
+                const unsigned bj = index / counts[0] % counts[1];
+                const unsigned bk = index / counts[0] / counts[1];
+                float* nodes = batch.data() + b * kBrickBytes / sizeof(float);
+                // nodes past the grid repeat its last ones, no cell reads
+                // them
+                std::vector<Vector> row(kBrickNodes);
+                for (unsigned k = 0; k < kBrickNodes; k++) {
+                    for (unsigned j = 0; j < kBrickNodes; j++) {
+                        for (unsigned i = 0; i < kBrickNodes; i++) {
+                            row[i] = l.position(
+                                std::min(bi * kBrickSize + i, n[0] - 1),
+                                std::min(bj * kBrickSize + j, n[1] - 1),
+                                std::min(bk * kBrickSize + k, n[2] - 1));
+                        }
+                        source.evalBatch(
+                            row,
+                            std::span<float>(
+                                nodes + (k * kBrickNodes + j) * kBrickNodes,
+                                kBrickNodes));
+                    }
+                }
+                const auto [lo, hi] = std::minmax_element(
+                    nodes, nodes + kBrickBytes / sizeof(float));
+                table[index] = TableEntry{*lo, *hi, 0};
+            }
+            for (size_t b = 0; b < count; b++) {
+                TableEntry& entry = table[first + b];
+                const bool  last = first + b + 1 == bricks;
+                // the last slot is always written so the chunk is whole
+                if (entry.lo == entry.hi && !last) {
+                    entry.slot = BrickInfo::kConstant;
+                    out.seekp(kBrickStride, std::ios::cur);
+                    slot++;
+                    continue;
+                }
+                entry.slot = entry.lo == entry.hi ? BrickInfo::kConstant
+                                                  : slot;
+                out.write(reinterpret_cast<const char*>(batch.data() +
+                                                        b * kBrickBytes /
+                                                            sizeof(float)),
+                          kBrickBytes);
+                out.seekp(kBrickStride - kBrickBytes, std::ios::cur);
+                if (last) {
+                    // a hole at the very end would not extend the file
+                    out.seekp(-1, std::ios::cur);
+                    out.put(0);
+                }
+                slot++;
+            }
+        }
+    };
+    auto bytes = [](const void* data, size_t size) {
+        return [=](std::ostream& out) {
+            out.write(static_cast<const char*>(data), size);
+        };
+    };
+
+    const cachefile::ChunkSource chunks[] = {
+        {GridChunk::kTag,
+         GridChunk::kVersion,
+         sizeof(g),
+         bytes(&g, sizeof(g))},
+        {kBrickTag, kBrickVersion, bricks * kBrickStride, writeBricks},
+        // after the bricks, which fill it in
+        {kTableTag,
+         kTableVersion,
+         sizeof(header) + bricks * sizeof(TableEntry),
+         [&](std::ostream& out) {
+             bytes(&header, sizeof(header))(out);
+             bytes(table.data(), bricks * sizeof(TableEntry))(out);
+         }},
+    };
+    return cachefile::write(path, sourceHash, chunks);
+}
+
+VolumeScalarPagedGrid::Ptr VolumeScalarPagedGrid::open(const std::string& path,
+                                                       size_t budgetBytes)
+{
+    using cachefile::GridChunk;
+
+    Ptr grid(new VolumeScalarPagedGrid());
+    grid->m_fd = ::open(path.c_str(), O_RDONLY);
+    try {
+        struct stat info;
+        if (grid->m_fd < 0 || fstat(grid->m_fd, &info) != 0) {
+            throw std::runtime_error("cannot open the file");
+        }
+        const int              fd = grid->m_fd;
+        const cachefile::Table table = cachefile::readTable(fd, info.st_size);
+        const cachefile::ChunkEntry& gridEntry = table.require(
+            GridChunk::kTag, GridChunk::kVersion, sizeof(GridChunk));
+        GridChunk g;
+        cachefile::readAt(fd, &g, sizeof(g), gridEntry.offset);
+        grid->m_layout = g.layout();
+        grid->m_background = g.background;
+        grid->m_sourceHash = table.sourceHash;
+
+        const unsigned counts[3] = {bricksAlong(grid->m_layout.nx),
+                                    bricksAlong(grid->m_layout.ny),
+                                    bricksAlong(grid->m_layout.nz)};
+        const size_t   bricks = (size_t)counts[0] * counts[1] * counts[2];
+        const cachefile::ChunkEntry& tableEntry = table.require(
+            kTableTag,
+            kTableVersion,
+            sizeof(TableHeader) + bricks * sizeof(TableEntry));
+        const cachefile::ChunkEntry& brickEntry = table.require(
+            kBrickTag, kBrickVersion, bricks * kBrickStride);
+        TableHeader header;
+        cachefile::readAt(fd, &header, sizeof(header), tableEntry.offset);
+        if (header.brickSize != kBrickSize ||
+            header.brickStride != kBrickStride ||
+            !std::equal(counts, counts + 3, header.bricks)) {
+            throw std::runtime_error("brick table does not match the grid");
+        }
+        std::vector<TableEntry> entries(bricks);
+        cachefile::readAt(fd,
+                          entries.data(),
+                          bricks * sizeof(TableEntry),
+                          tableEntry.offset + sizeof(header));
+
+        std::copy(counts, counts + 3, grid->m_bricks3);
+        grid->m_bricks.resize(bricks);
+        for (size_t b = 0; b < bricks; b++) {
+            const TableEntry& e = entries[b];
+            if (e.slot != BrickInfo::kConstant && e.slot >= bricks) {
+                throw std::runtime_error("brick slot out of bounds");
+            }
+            grid->m_bricks[b] = BrickInfo{Interval(e.lo, e.hi), e.slot};
+        }
+        grid->m_brickOffset = brickEntry.offset;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[ciel][cache] " << path << ": " << e.what() << std::endl;
+        return nullptr;
+    }
+
+    grid->m_id = s_nextId++;
+    grid->m_budget = budgetBytes;
+    grid->m_state = std::make_unique<std::atomic<uint8_t>[]>(
+        grid->m_bricks.size());
+    grid->m_prefetcher = std::thread(&VolumeScalarPagedGrid::prefetchLoop,
+                                     grid.get());
+    return grid;
+}
+
+float VolumeScalarPagedGrid::eval(const Vector& p) const
+{
+    const GridLayout& l = m_layout;
+    if (!l.bound.contains(p)) {
+        return m_background;
+    }
+
+    const Vector d = p - l.bound.min();
+    const Vector g(d.X() * l.invVoxelSize.X(),
+                   d.Y() * l.invVoxelSize.Y(),
+                   d.Z() * l.invVoxelSize.Z());
+    const unsigned i = std::min((unsigned)g.X(), l.nx - 2);
+    const unsigned j = std::min((unsigned)g.Y(), l.ny - 2);
+    const unsigned k = std::min((unsigned)g.Z(), l.nz - 2);
+    const float    tx = g.X() - i;
+    const float    ty = g.Y() - j;
+    const float    tz = g.Z() - k;
+
+    const unsigned   bi = i / kBrickSize, bj = j / kBrickSize;
+    const unsigned   bk = k / kBrickSize;
+    const uint32_t   index = brickIndex(bi, bj, bk);
+    const BrickInfo& info = m_bricks[index];
+    if (info.slot == BrickInfo::kConstant) {
+        return info.range.lo;
+    }
+
+    const size_t sy = kBrickNodes;
+    const size_t sz = kBrickNodes * kBrickNodes;
+    const float* c = brickNodes(index) +
+                     ((k - bk * kBrickSize) * sz +
+                      (j - bj * kBrickSize) * sy + (i - bi * kBrickSize));
+
+    const float c00 = c[0] * (1 - tx) + c[1] * tx;
+    const float c10 = c[sy] * (1 - tx) + c[sy + 1] * tx;
+    const float c01 = c[sz] * (1 - tx) + c[sz + 1] * tx;
+    const float c11 = c[sz + sy] * (1 - tx) + c[sz + sy + 1] * tx;
+    const float c0 = c00 * (1 - ty) + c10 * ty;
+    const float c1 = c01 * (1 - ty) + c11 * ty;
+    return c0 * (1 - tz) + c1 * tz;
+}
+
+// Hull of the ranges of the bricks holding the cells the box overlaps
+Interval VolumeScalarPagedGrid::evalInterval(const BBox& box) const
+{
+    const GridLayout& l = m_layout;
+    const BBox        overlap = box.intersect(l.bound);
+    if (overlap.isEmpty()) {
+        return Interval(m_background);
+    }
+
+    unsigned lo[3], hi[3];
+    size_t   count = 1;
+    for (int a = 0; a < 3; a++) {
+        const unsigned n = a == 0 ? l.nx : (a == 1 ? l.ny : l.nz);
+        const float    g0 = (overlap.min()[a] - l.bound.min()[a]) *
+                         l.invVoxelSize[a];
+        const float    g1 = (overlap.max()[a] - l.bound.min()[a]) *
+                         l.invVoxelSize[a];
+        const unsigned cell0 = std::min(
+            (unsigned)std::max(std::floor(g0), 0.f), n - 2);
+        const unsigned cell1 = std::min(
+            (unsigned)std::max(std::ceil(g1) - 1, 0.f), n - 2);
+        lo[a] = cell0 / kBrickSize;
+        hi[a] = std::max(cell1 / kBrickSize, lo[a]);
+        count *= hi[a] - lo[a] + 1;
+    }
+    if (count > s_maxIntervalBricks) {
+        return Interval::infinite();
+    }
+
+    Interval result(std::numeric_limits<float>::max(),
+                    std::numeric_limits<float>::lowest());
+    for (unsigned k = lo[2]; k <= hi[2]; k++) {
+        for (unsigned j = lo[1]; j <= hi[1]; j++) {
+            for (unsigned i = lo[0]; i <= hi[0]; i++) {
+                result = hull(result, m_bricks[brickIndex(i, j, k)].range);
+            }
+        }
+    }
+    // parts of the box outside the grid read as background
+    if (!l.bound.contains(box.min()) || !l.bound.contains(box.max())) {
+        result = hull(result, Interval(m_background));
+    }
+    return result;
+}
+
+const float* VolumeScalarPagedGrid::brickNodes(uint32_t index) const
+{
+    // Samples along a ray stay in a brick for several steps: only a change
+    // of brick goes through the shared cache and its lock. The brick is
+    // shared, so eviction cannot free it under a thread still reading it.
+    struct LastBrick
+    {
+        uint64_t                     owner{0};
+        uint32_t                     index{0};
+        std::shared_ptr<const Brick> brick;
+    };
+    thread_local LastBrick last;
+    if (last.owner != m_id || last.index != index) {
+        last.brick = acquire(index);
+        last.owner = m_id;
+        last.index = index;
+    }
+    return last.brick->data();
+}
+
+std::shared_ptr<const VolumeScalarPagedGrid::Brick>
+VolumeScalarPagedGrid::acquire(uint32_t index) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto                  it = m_resident.find(index);
+        if (it != m_resident.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second.brick;
+        }
+    }
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return insert(index, load(index));
+}
+
+std::shared_ptr<const VolumeScalarPagedGrid::Brick>
+VolumeScalarPagedGrid::load(uint32_t index) const
+{
+    auto brick = std::make_shared<Brick>(kBrickBytes / sizeof(float));
+    try {
+        cachefile::readAt(m_fd,
+                          brick->data(),
+                          kBrickBytes,
+                          m_brickOffset + m_bricks[index].slot * kBrickStride);
+        m_bytesRead.fetch_add(kBrickBytes, std::memory_order_relaxed);
+    }
+    catch (const std::exception& e) {
+        // rendering goes on with the brick empty
+        if (!m_readFailed.exchange(true)) {
+            std::cerr << "[ciel][cache] Brick " << index << ": " << e.what()
+                      << ", further failures are not reported" << std::endl;
+        }
+        std::fill(brick->begin(), brick->end(), m_background);
+    }
+    return brick;
+}
+
+std::shared_ptr<const VolumeScalarPagedGrid::Brick>
+VolumeScalarPagedGrid::insert(uint32_t                     index,
+                              std::shared_ptr<const Brick> brick) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto [it, inserted] = m_resident.try_emplace(index);
+    if (!inserted) {
+        return it->second.brick;
+    }
+    m_lru.push_front(index);
+    it->second = Resident{std::move(brick), m_lru.begin()};
+    m_state[index].store(Loaded, std::memory_order_relaxed);
+
+    while (m_lru.size() > 1 && m_lru.size() * kBrickBytes > m_budget) {
+        const uint32_t victim = m_lru.back();
+        m_lru.pop_back();
+        m_resident.erase(victim);
+        m_state[victim].store(Absent, std::memory_order_relaxed);
+        m_evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+    return it->second.brick;
+}
+
+void VolumeScalarPagedGrid::prefetch(const Vector& origin,
+                                     const Vector& direction,
+                                     float         tNear,
+                                     float         tFar) const
+{
+    const GridLayout& l = m_layout;
+    float             t0 = tNear, t1 = tFar;
+    if (!l.bound.intersectRay(origin, direction, t0, t1)) {
+        return;
+    }
+
+    // half a brick at a time, bricks only clipped at a corner may be missed
+    const float brickLength = kBrickSize * std::min({l.voxelSize.X(),
+                                                     l.voxelSize.Y(),
+                                                     l.voxelSize.Z()});
+    const float dt = 0.5f * brickLength / direction.magnitude();
+    uint32_t    previous = UINT32_MAX;
+    size_t      queued = 0;
+    for (float t = t0; t <= t1 && dt > 0; t += dt) {
+        const Vector   d = origin + t * direction - l.bound.min();
+        unsigned       b[3];
+        const unsigned n[3] = {l.nx, l.ny, l.nz};
+        for (int a = 0; a < 3; a++) {
+            const float g = std::max(d[a] * l.invVoxelSize[a], 0.f);
+            b[a] = std::min((unsigned)g, n[a] - 2) / kBrickSize;
+        }
+        const uint32_t index = brickIndex(b[0], b[1], b[2]);
+        if (index == previous ||
+            m_bricks[index].slot == BrickInfo::kConstant) {
+            continue;
+        }
+        previous = index;
+
+        uint8_t absent = Absent;
+        if (!m_state[index].compare_exchange_strong(absent, Queued)) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            if (m_queue.size() >= s_maxQueued) {
+                m_state[index].store(Absent, std::memory_order_relaxed);
+                break;
+            }
+            m_queue.push_back(index);
+        }
+        queued++;
+    }
+    if (queued > 0) {
+        m_queueReady.notify_one();
+    }
+}
+
+void VolumeScalarPagedGrid::prefetchLoop()
+{
+    while (true) {
+        uint32_t index;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_queueReady.wait(lock,
+                              [this] { return m_stop || !m_queue.empty(); });
+            if (m_stop) {
+                return;
+            }
+            index = m_queue.front();
+            m_queue.pop_front();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_resident.count(index)) {
+                continue;
+            }
+        }
+        insert(index, load(index));
+        m_prefetched.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+VolumeScalarPagedGrid::CacheStats VolumeScalarPagedGrid::stats() const
+{
+    CacheStats stats;
+    stats.hits = m_hits.load();
+    stats.misses = m_misses.load();
+    stats.prefetched = m_prefetched.load();
+    stats.evictions = m_evictions.load();
+    stats.bytesRead = m_bytesRead.load();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stats.residentBytes = m_lru.size() * kBrickBytes;
+    return stats;
+}
+
+void VolumeScalarPagedGrid::resetStats()
+{
+    m_hits = 0;
+    m_misses = 0;
+    m_prefetched = 0;
+    m_evictions = 0;
+    m_bytesRead = 0;
+}
+
+} // namespace ciel
@@ -0,0 +1,205 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  A dense scalar grid paged in from disk brick by brick,
+//  for volumes larger than memory.
+//
+//  write() samples a source into bricks of kBrickSize^3
+//  cells (plus the nodes on their far faces, so a brick
+//  interpolates on its own) without ever holding the whole
+//  grid. open() reads only the brick table: bricks are
+//  loaded with pread() when a sample first lands in them
+//  and kept in an LRU cache within a byte budget, the least
+//  recently used ones are dropped to make room. Bricks of a
+//  single value are never stored or loaded.
+//
+//  prefetch() queues the bricks along a ray for a
+//  background thread to load ahead of the march.
+//
+//  The file (see volumeCacheFile.h) holds the chunks
+//  "GRID" the layout and background, "BRCK" the bricks,
+//  one per kBrickAlignment slot, and "BTAB" the value range
+//  and slot of every brick.
+//
+// -------------------------------------------------------
+
+#include "volumeBase.h"
+#include "denseGrid.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ciel {
+
+class VolumeScalarPagedGrid : public VolumeScalar
+{
+public:
+    static constexpr unsigned kBrickSize = 16;                 // cells
+    static constexpr unsigned kBrickNodes = kBrickSize + 1;    // per side
+    static constexpr size_t   kBrickBytes = kBrickNodes * kBrickNodes *
+                                          kBrickNodes * sizeof(float);
+    static constexpr size_t   kBrickAlignment = 4096;
+    static constexpr float    kOutside = std::numeric_limits<float>::lowest();
+
+    using Ptr = std::shared_ptr<VolumeScalarPagedGrid>;
+    using ConstPtr = std::shared_ptr<const VolumeScalarPagedGrid>;
+
+    // Brick cache counters, since open() or the last resetStats()
+    struct CacheStats
+    {
+        size_t hits{0};       // brick lookups that found it resident
+        size_t misses{0};     // brick lookups that had to load it
+        size_t prefetched{0}; // bricks loaded in the background
+        size_t evictions{0};  // bricks dropped for the budget
+        size_t bytesRead{0};
+        size_t residentBytes{0}; // now
+    };
+
+    VolumeScalarPagedGrid(const VolumeScalarPagedGrid&) = delete;
+    VolumeScalarPagedGrid& operator=(const VolumeScalarPagedGrid&) = delete;
+    ~VolumeScalarPagedGrid();
+
+    // Samples `source` on the nodes of `layout` into a brick file at
+    // `path`, tagged with `sourceHash`. Memory use is a few dozen bricks
+    // whatever the grid size. Returns false (and prints the reason) on
+    // failure.
+    static bool write(const std::string&  path,
+                      const VolumeScalar& source,
+                      const GridLayout&   layout,
+                      uint64_t            sourceHash,
+                      float               background = kOutside);
+    // Opens a brick file, caching at most `budgetBytes` of bricks (but at
+    // least one). Returns nullptr (and prints the reason) if it cannot be
+    // read or is not a brick file of a version we know.
+    static Ptr open(const std::string& path, size_t budgetBytes);
+
+    float  eval(const Vector& p) const override;
+    FloatP evalPacket(const VectorP& p) const override
+    {
+        FloatP result;
+        for (int i = 0; i < kPacketWidth; i++) {
+            result[i] = eval(p.lane(i));
+        }
+        return result;
+    }
+    void evalBatch(std::span<const Vector> p,
+                   std::span<float>        out) const override
+    {
+        for (size_t i = 0; i < p.size(); i++) {
+            out[i] = eval(p[i]);
+        }
+    }
+    BBox bound() const override { return m_layout.bound; }
+    // From the brick table alone, nothing is loaded
+    Interval evalInterval(const BBox& box) const override;
+    uint64_t hash() const override
+    {
+        return hashCombine(hashString("pagedGrid"), m_sourceHash);
+    }
+
+    // Queues the bricks that origin + t * direction crosses for t in
+    // [tNear, tFar], nearest first, to be loaded in the background.
+    // Bricks already resident or queued are skipped.
+    void prefetch(const Vector& origin,
+                  const Vector& direction,
+                  float         tNear,
+                  float         tFar) const;
+
+    CacheStats stats() const;
+    void       resetStats();
+
+    const GridLayout& layout() const { return m_layout; }
+    size_t            budget() const { return m_budget; }
+    size_t            brickCount() const { return m_bricks.size(); }
+    uint64_t          sourceHash() const { return m_sourceHash; }
+
+private:
+    using Brick = std::vector<float>; // kBrickNodes^3, x fastest
+
+    // A brick in the file: its value range and slot in the BRCK chunk, or
+    // kConstant if every node holds range.lo
+    struct BrickInfo
+    {
+        static constexpr uint64_t kConstant = UINT64_MAX;
+
+        Interval range;
+        uint64_t slot;
+    };
+    struct Resident
+    {
+        std::shared_ptr<const Brick>  brick;
+        std::list<uint32_t>::iterator lru;
+    };
+    enum BrickState : uint8_t
+    {
+        Absent,
+        Queued,
+        Loaded
+    };
+
+    VolumeScalarPagedGrid() = default;
+
+    uint32_t brickIndex(unsigned bi, unsigned bj, unsigned bk) const
+    {
+        return (bk * m_bricks3[1] + bj) * m_bricks3[0] + bi;
+    }
+    // Nodes of brick `index`, through a per-thread last brick
+    const float*                 brickNodes(uint32_t index) const;
+    std::shared_ptr<const Brick> acquire(uint32_t index) const;
+    std::shared_ptr<const Brick> load(uint32_t index) const;
+    // Makes `brick` resident, or returns the one another thread loaded
+    // first, and evicts down to the budget. Takes m_mutex.
+    std::shared_ptr<const Brick>
+    insert(uint32_t index, std::shared_ptr<const Brick> brick) const;
+    void                         prefetchLoop();
+
+    // identifies the volume in the per-thread last brick
+    uint64_t m_id{0};
+
+    int                    m_fd{-1};
+    GridLayout             m_layout;
+    float                  m_background{0};
+    uint64_t               m_sourceHash{0};
+    unsigned               m_bricks3[3]{0, 0, 0};
+    std::vector<BrickInfo> m_bricks;
+    uint64_t               m_brickOffset{0}; // of the BRCK chunk
+    size_t                 m_budget{0};
+
+    // the cache, most recently used first in m_lru
+    mutable std::mutex                              m_mutex;
+    mutable std::unordered_map<uint32_t, Resident>  m_resident;
+    mutable std::list<uint32_t>                     m_lru;
+    mutable std::unique_ptr<std::atomic<uint8_t>[]> m_state; // BrickState
+
+    // evalInterval() hulls at most this many bricks, larger boxes get an
+    // unbounded interval
+    static constexpr size_t s_maxIntervalBricks = 4096;
+
+    // background loading, see prefetch()
+    static constexpr size_t         s_maxQueued = 1024;
+    mutable std::mutex              m_queueMutex;
+    mutable std::condition_variable m_queueReady;
+    mutable std::deque<uint32_t>    m_queue;
+    bool                            m_stop{false};
+    std::thread                     m_prefetcher;
+
+    mutable std::atomic<size_t> m_hits{0};
+    mutable std::atomic<size_t> m_misses{0};
+    mutable std::atomic<size_t> m_prefetched{0};
+    mutable std::atomic<size_t> m_evictions{0};
+    mutable std::atomic<size_t> m_bytesRead{0};
+    mutable std::atomic<bool>   m_readFailed{false};
+};
+
+} // namespace ciel
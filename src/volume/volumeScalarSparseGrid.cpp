@@ -0,0 +1,406 @@
+#include "volumeScalarSparseGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace ciel {
+
+namespace {
+
+constexpr int kLeafDim = VolumeScalarSparseGrid::Tree::kLeafDim;
+
+// Same combination as Scene::eval / Scene::bakeVolumes: densities add up,
+// outside a volume the closest (largest negative) value wins
+float combine(float a, float b)
+{
+    if (a > 0 || b > 0) {
+        return std::max(a, 0.f) + std::max(b, 0.f);
+    }
+    return std::max(a, b);
+}
+
+int32_t floorIndex(float x) { return (int32_t)std::floor(x); }
+
+} // namespace
+
+VolumeScalarSparseGrid::VolumeScalarSparseGrid(float voxelSize,
+                                               float bandVoxels)
+: m_tree(-bandVoxels * voxelSize)
+, m_voxelSize(voxelSize)
+, m_invVoxelSize(1.f / voxelSize)
+, m_activeMin{std::numeric_limits<int32_t>::max(),
+              std::numeric_limits<int32_t>::max(),
+              std::numeric_limits<int32_t>::max()}
+, m_activeMax{std::numeric_limits<int32_t>::lowest(),
+              std::numeric_limits<int32_t>::lowest(),
+              std::numeric_limits<int32_t>::lowest()}
+{
+}
+
+// Trilinear interpolation between the 8 voxels around p. The accessor makes
+// the usual case, all 8 in the brick of the previous lookup, a few loads.
+float VolumeScalarSparseGrid::sample(Tree::Accessor& acc, const Vector& p) const
+{
+    const float   gx = p.X() * m_invVoxelSize;
+    const float   gy = p.Y() * m_invVoxelSize;
+    const float   gz = p.Z() * m_invVoxelSize;
+    const Coord   c{floorIndex(gx), floorIndex(gy), floorIndex(gz)};
+    const float   tx = gx - c.i;
+    const float   ty = gy - c.j;
+    const float   tz = gz - c.k;
+    constexpr int last = kLeafDim - 1;
+
+    float v[8];
+    if ((c.i & last) != last && (c.j & last) != last && (c.k & last) != last) {
+        // all 8 corners in one brick
+        const Tree::Leaf* leaf = acc.leaf(c);
+        if (!leaf) {
+            return acc.getValue(c); // tile or background
+        }
+        constexpr int sy = kLeafDim;
+        constexpr int sz = kLeafDim * kLeafDim;
+        const float*  d = leaf->values.data() + Tree::Leaf::offset(c);
+        v[0] = d[0];
+        v[1] = d[1];
+        v[2] = d[sy];
+        v[3] = d[sy + 1];
+        v[4] = d[sz];
+        v[5] = d[sz + 1];
+        v[6] = d[sz + sy];
+        v[7] = d[sz + sy + 1];
+    }
+    else {
+        for (int n = 0; n < 8; n++) {
+            v[n] = acc.getValue(
+                Coord{c.i + (n & 1), c.j + ((n >> 1) & 1), c.k + (n >> 2)});
+        }
+    }
+
+    const float c00 = v[0] * (1 - tx) + v[1] * tx;
+    const float c10 = v[2] * (1 - tx) + v[3] * tx;
+    const float c01 = v[4] * (1 - tx) + v[5] * tx;
+    const float c11 = v[6] * (1 - tx) + v[7] * tx;
+    const float c0 = c00 * (1 - ty) + c10 * ty;
+    const float c1 = c01 * (1 - ty) + c11 * ty;
+    return c0 * (1 - tz) + c1 * tz;
+}
+
+float VolumeScalarSparseGrid::eval(const Vector& p) const
+{
+    // one accessor per thread, reset whenever it sees another tree (told
+    // apart by id, not address) or this tree changed since its last lookup
+    thread_local Tree::Accessor acc;
+    acc.bind(&m_tree);
+    return sample(acc, p);
+}
+
+FloatP VolumeScalarSparseGrid::evalPacket(const VectorP& p) const
+{
+    thread_local Tree::Accessor acc;
+    acc.bind(&m_tree);
+    FloatP result;
+    for (int i = 0; i < kPacketWidth; i++) {
+        result[i] = sample(acc, p.lane(i));
+    }
+    return result;
+}
+
+void VolumeScalarSparseGrid::evalBatch(std::span<const Vector> p,
+                                       std::span<float>        out) const
+{
+    thread_local Tree::Accessor acc;
+    acc.bind(&m_tree);
+    for (size_t i = 0; i < p.size(); i++) {
+        out[i] = sample(acc, p[i]);
+    }
+}
+
+BBox VolumeScalarSparseGrid::bound() const
+{
+    if (m_activeMin.i > m_activeMax.i) {
+        return BBox();
+    }
+    // one voxel of margin for the interpolation
+    const Vector lo(m_activeMin.i - 1, m_activeMin.j - 1, m_activeMin.k - 1);
+    const Vector hi(m_activeMax.i + 1, m_activeMax.j + 1, m_activeMax.k + 1);
+    return BBox(lo * m_voxelSize, hi * m_voxelSize);
+}
+
+uint64_t VolumeScalarSparseGrid::hash() const
+{
+    // a second caller waits for the first one's hash instead of racing it
+    std::lock_guard<std::mutex> lock(m_hashMutex);
+    if (m_hashGeneration == m_tree.generation()) {
+        return m_hash;
+    }
+
+    // the root has no order, hash its nodes by key
+    std::vector<std::pair<uint64_t, const Tree::Internal*>> nodes;
+    m_tree.forEachInternal(
+        [&nodes](uint64_t key, const Tree::Internal& node) {
+            nodes.emplace_back(key, &node);
+        });
+    std::sort(nodes.begin(), nodes.end());
+
+    uint64_t h = hashCombine(hashString("sparseGrid"), m_voxelSize);
+    h = hashCombine(h, background());
+    for (const auto& [key, node] : nodes) {
+        h = hashCombine(h, key);
+        for (int slot = 0; slot < Tree::kInternalSize; slot++) {
+            const Tree::Leaf* leaf = node->leaves[slot].get();
+            h = hashCombine(h, (uint64_t)(leaf != nullptr));
+            if (!leaf) {
+                h = hashCombine(h, node->tiles[slot]);
+                continue;
+            }
+            for (const float value : leaf->values) {
+                h = hashCombine(h, value);
+            }
+        }
+    }
+    m_hash = h;
+    m_hashGeneration = m_tree.generation();
+    return h;
+}
+
+Interval VolumeScalarSparseGrid::evalInterval(const BBox& box) const
+{
+    // outside its bound the grid holds background or narrow band values
+    const BBox     active = box.intersect(bound());
+    const Interval outside(background(), 0);
+    if (active.isEmpty()) {
+        return outside;
+    }
+
+    // voxels of the cells overlapping the box
+    const Coord lo{floorIndex(active.min().X() * m_invVoxelSize),
+                   floorIndex(active.min().Y() * m_invVoxelSize),
+                   floorIndex(active.min().Z() * m_invVoxelSize)};
+    const Coord hi{floorIndex(active.max().X() * m_invVoxelSize) + 1,
+                   floorIndex(active.max().Y() * m_invVoxelSize) + 1,
+                   floorIndex(active.max().Z() * m_invVoxelSize) + 1};
+    const size_t voxels = (size_t)(hi.i - lo.i + 1) * (hi.j - lo.j + 1) *
+                          (hi.k - lo.k + 1);
+
+    thread_local Tree::Accessor acc;
+    acc.bind(&m_tree);
+    Interval result = outside;
+    if (voxels <= s_maxIntervalVoxels) {
+        for (int32_t k = lo.k; k <= hi.k; k++) {
+            for (int32_t j = lo.j; j <= hi.j; j++) {
+                for (int32_t i = lo.i; i <= hi.i; i++) {
+                    result = hull(result, Interval(acc.getValue({i, j, k})));
+                }
+            }
+        }
+        return result;
+    }
+
+    const Coord  blo = Tree::leafOrigin(lo);
+    const Coord  bhi = Tree::leafOrigin(hi);
+    const size_t bricks = (size_t)((bhi.i - blo.i) / kLeafDim + 1) *
+                          ((bhi.j - blo.j) / kLeafDim + 1) *
+                          ((bhi.k - blo.k) / kLeafDim + 1);
+    if (bricks > s_maxIntervalBricks) {
+        return Interval::infinite();
+    }
+    for (int32_t k = blo.k; k <= bhi.k; k += kLeafDim) {
+        for (int32_t j = blo.j; j <= bhi.j; j += kLeafDim) {
+            for (int32_t i = blo.i; i <= bhi.i; i += kLeafDim) {
+                const Coord o{i, j, k};
+                const auto  it = m_leafRanges.find(Tree::leafKey(o));
+                result = hull(result,
+                              it != m_leafRanges.end()
+                                  ? it->second
+                                  : Interval(acc.getValue(o)));
+            }
+        }
+    }
+    return result;
+}
+
+bool VolumeScalarSparseGrid::stamp(const VolumeScalar::Ptr& source)
+{
+    const BBox sourceBound = source->bound();
+    if (sourceBound.isInfinite()) {
+        return false;
+    }
+    if (sourceBound.isEmpty()) {
+        return true;
+    }
+
+    // bricks overlapping the bound grown by the narrow band
+    const BBox  bound = sourceBound.expand(-background());
+    const Coord lo = Tree::leafOrigin(Coord{
+        floorIndex(bound.min().X() * m_invVoxelSize),
+        floorIndex(bound.min().Y() * m_invVoxelSize),
+        floorIndex(bound.min().Z() * m_invVoxelSize)});
+    const Coord hi = Tree::leafOrigin(Coord{
+        floorIndex(bound.max().X() * m_invVoxelSize) + 1,
+        floorIndex(bound.max().Y() * m_invVoxelSize) + 1,
+        floorIndex(bound.max().Z() * m_invVoxelSize) + 1});
+
+    std::vector<Coord> origins;
+    for (int32_t k = lo.k; k <= hi.k; k += kLeafDim) {
+        for (int32_t j = lo.j; j <= hi.j; j += kLeafDim) {
+            for (int32_t i = lo.i; i <= hi.i; i += kLeafDim) {
+                origins.push_back(Coord{i, j, k});
+            }
+        }
+    }
+
+    // The tree is only read while stamping in parallel, the results are
+    // linked in afterwards
+    std::vector<BrickResult> results(origins.size());
+
+    const float floor = background();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif // _OPENMP
+    for (size_t n = 0; n < origins.size(); n++) {
+        const Coord& o = origins[n];
+
+        // Nothing to do if the source stays below the band over the whole
+        // brick: combining it leaves a tile or background as it is
+        const Vector corner(o.i * m_voxelSize, o.j * m_voxelSize,
+                            o.k * m_voxelSize);
+        if (!m_tree.findLeaf(o) &&
+            source->evalInterval(BBox(corner,
+                                      corner + Vector((kLeafDim - 1) *
+                                                      m_voxelSize)))
+                    .hi <= floor) {
+            continue;
+        }
+
+        // the whole brick in one batch
+        Vector points[Tree::kLeafSize];
+        float  values[Tree::kLeafSize];
+        for (int k = 0; k < kLeafDim; k++) {
+            for (int j = 0; j < kLeafDim; j++) {
+                for (int i = 0; i < kLeafDim; i++) {
+                    const Coord c{o.i + i, o.j + j, o.k + k};
+                    points[Tree::Leaf::offset(c)] = Vector(c.i * m_voxelSize,
+                                                           c.j * m_voxelSize,
+                                                           c.k * m_voxelSize);
+                }
+            }
+        }
+        source->evalBatch(points, values);
+        results[n] = combineBrick(o, values);
+    }
+
+    linkBricks(origins, results);
+    return true;
+}
+
+void VolumeScalarSparseGrid::accumulate(
+    std::vector<std::unique_ptr<Tree::Leaf>> bricks)
+{
+    std::vector<Coord>       origins(bricks.size());
+    std::vector<BrickResult> results(bricks.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif // _OPENMP
+    for (size_t n = 0; n < bricks.size(); n++) {
+        origins[n] = bricks[n]->origin;
+        results[n] = combineBrick(origins[n], bricks[n]->values.data());
+        bricks[n].reset();
+    }
+    linkBricks(origins, results);
+}
+
+VolumeScalarSparseGrid::BrickResult
+VolumeScalarSparseGrid::combineBrick(const Coord& o, const float* values) const
+{
+    BrickResult       r;
+    const float       floor = background();
+    const Tree::Leaf* existing = m_tree.findLeaf(o);
+    const float       base = existing ? 0.f : m_tree.getValue(o);
+
+    auto leaf = std::make_unique<Tree::Leaf>();
+    leaf->origin = o;
+    bool  uniform = true;
+    float first = 0;
+    float vMin = std::numeric_limits<float>::max();
+    float vMax = std::numeric_limits<float>::lowest();
+    for (int k = 0; k < kLeafDim; k++) {
+        for (int j = 0; j < kLeafDim; j++) {
+            for (int i = 0; i < kLeafDim; i++) {
+                const Coord c{o.i + i, o.j + j, o.k + k};
+                const int   offset = Tree::Leaf::offset(c);
+                const float old = existing ? existing->values[offset] : base;
+                const float value = std::max(combine(old, values[offset]),
+                                             floor);
+                leaf->values[offset] = value;
+
+                if (offset == 0) {
+                    first = value;
+                }
+                uniform = uniform && value == first;
+                vMin = std::min(vMin, value);
+                vMax = std::max(vMax, value);
+                if (value > 0) {
+                    if (!r.active) {
+                        r.activeMin = r.activeMax = c;
+                        r.active = true;
+                    }
+                    r.activeMin = Coord{std::min(r.activeMin.i, c.i),
+                                        std::min(r.activeMin.j, c.j),
+                                        std::min(r.activeMin.k, c.k)};
+                    r.activeMax = Coord{std::max(r.activeMax.i, c.i),
+                                        std::max(r.activeMax.j, c.j),
+                                        std::max(r.activeMax.k, c.k)};
+                }
+            }
+        }
+    }
+
+    if (!uniform) {
+        r.leaf = std::move(leaf);
+        r.range = Interval(vMin, vMax);
+    }
+    else if (existing || first != base) {
+        r.isTile = true;
+        r.tile = first;
+    }
+    return r;
+}
+
+void VolumeScalarSparseGrid::linkBricks(std::span<const Coord> origins,
+                                        std::span<BrickResult> results)
+{
+    for (size_t n = 0; n < origins.size(); n++) {
+        BrickResult&   r = results[n];
+        const uint64_t key = Tree::leafKey(origins[n]);
+        if (r.leaf) {
+            m_tree.setLeaf(std::move(r.leaf));
+            m_leafRanges[key] = r.range;
+        }
+        else if (r.isTile) {
+            m_tree.setTile(origins[n], r.tile);
+            m_leafRanges.erase(key);
+        }
+        if (r.active) {
+            m_activeMin = Coord{std::min(m_activeMin.i, r.activeMin.i),
+                                std::min(m_activeMin.j, r.activeMin.j),
+                                std::min(m_activeMin.k, r.activeMin.k)};
+            m_activeMax = Coord{std::max(m_activeMax.i, r.activeMax.i),
+                                std::max(m_activeMax.j, r.activeMax.j),
+                                std::max(m_activeMax.k, r.activeMax.k)};
+        }
+    }
+}
+
+VolumeScalarSparseGrid::Ptr
+VolumeScalarSparseGrid::bake(const VolumeScalar::Ptr& source,
+                             float                    voxelSize,
+                             float                    bandVoxels)
+{
+    Ptr grid = create(voxelSize, bandVoxels);
+    grid->stamp(source);
+    return grid;
+}
+
+} // namespace ciel
@@ -0,0 +1,118 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  A scalar volume sampled on a sparse voxel tree.
+//
+//  Unlike VolumeScalarGrid it only stores bricks that are
+//  near or inside a volume, so fine voxels stay affordable
+//  for large, mostly empty scenes. Values further than the
+//  narrow band outside a surface collapse to background().
+//
+// -------------------------------------------------------
+
+#include "sparseGrid.h"
+#include "volumeBase.h"
+
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace ciel {
+
+class VolumeScalarSparseGrid : public VolumeScalar
+{
+public:
+    using Tree = SparseGrid<float>;
+
+    // Cubic voxels of `voxelSize`, voxel (0, 0, 0) at the world origin.
+    // Values are kept down to -bandVoxels * voxelSize outside a surface.
+    VolumeScalarSparseGrid(float voxelSize, float bandVoxels = 3.f);
+
+    using Ptr = std::shared_ptr<VolumeScalarSparseGrid>;
+    using ConstPtr = std::shared_ptr<const VolumeScalarSparseGrid>;
+
+    float  eval(const Vector& p) const override;
+    FloatP evalPacket(const VectorP& p) const override;
+    void   evalBatch(std::span<const Vector> p,
+                     std::span<float>        out) const override;
+    BBox   bound() const override;
+    // Over the voxels around the box for small boxes, over the value range
+    // of the bricks around it for larger ones
+    Interval evalInterval(const BBox& box) const override;
+    // Over the voxel size, background and stored voxels, so that equal
+    // grids match across runs. Hashed again after every stamp() or
+    // accumulate() that changes the tree. Safe to call from several
+    // threads.
+    uint64_t hash() const override;
+
+    static Ptr create(float voxelSize, float bandVoxels = 3.f)
+    {
+        return std::make_shared<VolumeScalarSparseGrid>(voxelSize, bandVoxels);
+    }
+
+    // Samples `source` into the bricks overlapping its bound, in parallel
+    // over bricks, and combines it with what is already stored: positive
+    // values add up (like the densities in Scene::eval), otherwise the
+    // larger one is kept. Bricks that come out uniform are stored as tiles.
+    // Returns false if the source is unbounded.
+    bool stamp(const VolumeScalar::Ptr& source);
+
+    // Adds density bricks, e.g. splatted particles (see particles.h), to
+    // the grid in parallel over bricks: each is combined with what is
+    // already stored like the values of stamp()
+    void accumulate(std::vector<std::unique_ptr<Tree::Leaf>> bricks);
+
+    // Stamps `source` into a new grid
+    static Ptr bake(const VolumeScalar::Ptr& source,
+                    float                    voxelSize,
+                    float                    bandVoxels = 3.f);
+
+    const Tree& tree() const { return m_tree; }
+    float       voxelSize() const { return m_voxelSize; }
+    float       background() const { return m_tree.background(); }
+    size_t      memoryUsage() const { return m_tree.memoryUsage(); }
+
+private:
+    float sample(Tree::Accessor& acc, const Vector& p) const;
+
+    // What a brick turned into once combined with the stored voxels
+    struct BrickResult
+    {
+        std::unique_ptr<Tree::Leaf> leaf;
+        Interval                    range;
+        bool                        isTile{false};
+        float                       tile{0};
+        Coord                       activeMin, activeMax;
+        bool                        active{false};
+    };
+    // Combines kLeafSize values, in Leaf::offset() order, with the brick at
+    // `origin`. Only reads the tree, so bricks can be combined in parallel.
+    BrickResult combineBrick(const Coord& origin, const float* values) const;
+    // Links the combined bricks into the tree and updates the ranges
+    void linkBricks(std::span<const Coord> origins,
+                    std::span<BrickResult> results);
+
+    // evalInterval() scans at most this many voxels, or else this many
+    // bricks. Larger boxes get an unbounded interval.
+    static constexpr size_t s_maxIntervalVoxels = 64;
+    static constexpr size_t s_maxIntervalBricks = 512;
+
+    Tree  m_tree;
+    float m_voxelSize;
+    float m_invVoxelSize;
+    // value range of each leaf brick, by Tree::leafKey()
+    std::unordered_map<uint64_t, Interval> m_leafRanges;
+    // index space box of the voxels with positive values
+    Coord m_activeMin;
+    Coord m_activeMax;
+
+    // hash() as of tree generation m_hashGeneration, guarded by
+    // m_hashMutex
+    mutable std::mutex m_hashMutex;
+    mutable uint64_t   m_hash{0};
+    mutable uint64_t   m_hashGeneration{~0ull};
+};
+
+} // namespace ciel
@@ -17,14 +17,34 @@ public:
     using Ptr = std::shared_ptr<VolumeScalarSphere>;
     using ConstPtr = std::shared_ptr<const VolumeScalarSphere>;
 
-    float eval(const Vector& p) const override
+    float  eval(const Vector& p) const override { return kernel(p); }
+    FloatP evalPacket(const VectorP& p) const override { return kernel(p); }
+    void   evalBatch(std::span<const Vector> p,
+                     std::span<float>        out) const override
     {
-        return (m_radius - length(p - m_center));
+        evalBatchByPackets(p, out, [this](const VectorP& q) {
+            return kernel(q);
+        });
     }
     Vector dxdy(const Vector& p) const override
     {
         return -1.f * (p - m_center) / Vector(p - m_center).magnitude();
     }
+    BBox bound() const override
+    {
+        return BBox::fromCenter(m_center, Vector(m_radius));
+    }
+    // exact: the nearest and farthest points of the box from the center
+    Interval evalInterval(const BBox& box) const override
+    {
+        const auto [x, y, z] = offsetIntervals(box, m_center);
+        return m_radius - sqrt(sqr(x) + sqr(y) + sqr(z));
+    }
+    uint64_t hash() const override
+    {
+        const uint64_t h = hashCombine(hashString("sphere"), m_center);
+        return hashCombine(h, m_radius);
+    }
 
     static Ptr create(const Vector& center, float radius)
     {
@@ -41,6 +61,13 @@ public:
     void   setRadius(float radius) { m_radius = radius; }
 
 private:
+    // shared by eval() and evalPacket(), V is Vector or VectorN
+    template<typename V>
+    ScalarOf_t<V> kernel(const V& p) const
+    {
+        return (m_radius - length(p - m_center));
+    }
+
     Vector m_center;
     float  m_radius;
 };
@@ -22,13 +22,14 @@ public:
     using Ptr = std::shared_ptr<VolumeScalarTorus>;
     using ConstPtr = std::shared_ptr<const VolumeScalarTorus>;
 
-    float eval(const Vector& p) const override
+    float  eval(const Vector& p) const override { return kernel(p); }
+    FloatP evalPacket(const VectorP& p) const override { return kernel(p); }
+    void   evalBatch(std::span<const Vector> p,
+                     std::span<float>        out) const override
     {
-        const Vector x = p - m_center;
-        const Vector xp = x - (x * m_normal) * m_normal;
-
-        return (4.0 * m_radius1 * m_radius1 * (xp * xp)) -
-               pow((x * x) + m_radius1 * m_radius1 - m_radius2 * m_radius2, 2);
+        evalBatchByPackets(p, out, [this](const VectorP& q) {
+            return kernel(q);
+        });
     }
     [[deprecated("Not Implemented!")]] Vector
     dxdy([[maybe_unused]] const Vector& p) const override
@@ -36,6 +37,35 @@ public:
         return Vector{};
     }
 
+    // bounding sphere of the torus, ignoring its orientation
+    BBox bound() const override
+    {
+        return BBox::fromCenter(m_center,
+                                Vector(std::abs(m_radius1) +
+                                       std::abs(m_radius2)));
+    }
+    Interval evalInterval(const BBox& box) const override
+    {
+        const auto [x, y, z] = offsetIntervals(box, m_center);
+        const Interval d = x * m_normal.X() + y * m_normal.Y() +
+                           z * m_normal.Z();
+        const Interval xpx = x - d * m_normal.X();
+        const Interval xpy = y - d * m_normal.Y();
+        const Interval xpz = z - d * m_normal.Z();
+        const Interval r = sqr(x) + sqr(y) + sqr(z) + m_radius1 * m_radius1 -
+                           m_radius2 * m_radius2;
+
+        const Interval xp = sqr(xpx) + sqr(xpy) + sqr(xpz);
+
+        return 4.f * m_radius1 * m_radius1 * xp - sqr(r);
+    }
+    uint64_t hash() const override
+    {
+        const uint64_t h = hashCombine(hashString("torus"), m_center);
+        return hashCombine(hashCombine(hashCombine(h, m_normal), m_radius1),
+                           m_radius2);
+    }
+
     static Ptr create(const Vector& tCenter,
                       const Vector& tNormal,
                       float         tRadius1,
@@ -57,10 +87,31 @@ public:
     Vector normal() const { return m_normal; }
     void   setCenter(const Vector& center) { m_center = center; }
     void   setNormal(const Vector& normal) { m_normal = normal; }
+    float  radius1() const { return m_radius1; }
+    float  radius2() const { return m_radius2; }
     void   setRadius1(float radius) { m_radius1 = radius; }
     void   setRadius2(float radius) { m_radius2 = radius; }
 
 private:
+    // shared by eval() and evalPacket(), V is Vector or VectorN
+    template<typename V>
+    ScalarOf_t<V> kernel(const V& p) const
+    {
+        const V x = p - m_center;
+        const V xp = x - (x * m_normal) * m_normal;
+        if constexpr (std::is_same_v<V, Vector>) {
+            // in double, as eval() always was, so its values don't change
+            return (4.0 * m_radius1 * m_radius1 * (xp * xp)) -
+                   pow((x * x) + m_radius1 * m_radius1 - m_radius2 * m_radius2,
+                       2);
+        }
+        else {
+            const ScalarOf_t<V> r = (x * x) + m_radius1 * m_radius1 -
+                                    m_radius2 * m_radius2;
+            return (4.f * m_radius1 * m_radius1 * (xp * xp)) - r * r;
+        }
+    }
+
     Vector m_center;
     Vector m_normal;
     float  m_radius1;
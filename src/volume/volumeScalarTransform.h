@@ -0,0 +1,201 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  A scalar volume moved, rotated and uniformly scaled.
+//
+//  Only similarity transforms: values are scaled along
+//  with the space, so a distance-like field stays one and
+//  bounds and intervals carry over. Transforms of a
+//  transform fold into a single node.
+//
+// -------------------------------------------------------
+
+#include "volumeBase.h"
+
+#include <cmath>
+#include <numbers>
+
+namespace ciel {
+
+class VolumeScalarTransform : public VolumeScalar
+{
+public:
+    // world = rotation * (scale * local) + translation, with `rotation`
+    // given by its rows. `scale` must be positive.
+    VolumeScalarTransform(VolumeScalar::Ptr tField,
+                          const Vector      tRotation[3],
+                          float             tScale,
+                          const Vector&     tTranslation)
+    : mField(tField)
+    , mRotation{tRotation[0], tRotation[1], tRotation[2]}
+    , mScale(tScale)
+    , mTranslation(tTranslation)
+    {
+        for (int i = 0; i < 3; i++) {
+            mInverse[i] = Vector(mRotation[0][i] / mScale,
+                                 mRotation[1][i] / mScale,
+                                 mRotation[2][i] / mScale);
+        }
+    }
+
+    using Ptr = std::shared_ptr<VolumeScalarTransform>;
+    using ConstPtr = std::shared_ptr<const VolumeScalarTransform>;
+
+    // Applies the transform to `field`, folding it into the field's own
+    // transform if it has one
+    static Ptr create(const VolumeScalar::Ptr& field,
+                      const Vector             rotation[3],
+                      float                    scale,
+                      const Vector&            translation)
+    {
+        const auto inner = std::dynamic_pointer_cast<VolumeScalarTransform>(
+            field);
+        if (!inner) {
+            return std::make_shared<VolumeScalarTransform>(
+                field, rotation, scale, translation);
+        }
+        Vector combined[3];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                combined[i][j] = rotation[i] *
+                                 Vector(inner->mRotation[0][j],
+                                        inner->mRotation[1][j],
+                                        inner->mRotation[2][j]);
+            }
+        }
+        return std::make_shared<VolumeScalarTransform>(
+            inner->mField,
+            combined,
+            scale * inner->mScale,
+            scale * apply(rotation, inner->mTranslation) + translation);
+    }
+    static Ptr createTranslation(const VolumeScalar::Ptr& field,
+                                 const Vector&            offset)
+    {
+        return create(field, kIdentity, 1.f, offset);
+    }
+    static Ptr createScale(const VolumeScalar::Ptr& field, float factor)
+    {
+        return create(field, kIdentity, factor, Vector(0, 0, 0));
+    }
+    // by `degrees` around `axis`, through the origin
+    static Ptr createRotation(const VolumeScalar::Ptr& field,
+                              const Vector&            axis,
+                              float                    degrees)
+    {
+        const Vector a = axis.unitvector();
+        const float  rad = degrees * std::numbers::pi_v<float> / 180.f;
+        const float  c = std::cos(rad);
+        const float  s = std::sin(rad);
+        const float  t = 1 - c;
+        const Vector rows[3] = {
+            Vector(t * a.X() * a.X() + c,
+                   t * a.X() * a.Y() - s * a.Z(),
+                   t * a.X() * a.Z() + s * a.Y()),
+            Vector(t * a.X() * a.Y() + s * a.Z(),
+                   t * a.Y() * a.Y() + c,
+                   t * a.Y() * a.Z() - s * a.X()),
+            Vector(t * a.X() * a.Z() - s * a.Y(),
+                   t * a.Y() * a.Z() + s * a.X(),
+                   t * a.Z() * a.Z() + c)};
+        return create(field, rows, 1.f, Vector(0, 0, 0));
+    }
+
+    float eval(const Vector& p) const override
+    {
+        return mField->eval(toLocal(p)) * mScale;
+    }
+    FloatP evalPacket(const VectorP& p) const override
+    {
+        const VectorP q = p - mTranslation;
+        const VectorP local(q * mInverse[0], q * mInverse[1], q * mInverse[2]);
+        return mField->evalPacket(local) * mScale;
+    }
+    void evalBatch(std::span<const Vector> p,
+                   std::span<float>        out) const override
+    {
+        // on the stack: a transform under the field evaluates its batch
+        // while this one is still in use
+        constexpr size_t chunk = 64;
+        Vector           local[chunk];
+        for (size_t i = 0; i < p.size(); i += chunk) {
+            const size_t n = std::min(chunk, p.size() - i);
+            for (size_t l = 0; l < n; l++) {
+                local[l] = toLocal(p[i + l]);
+            }
+            mField->evalBatch(std::span<const Vector>(local, n),
+                              out.subspan(i, n));
+        }
+        for (float& value : out) {
+            value *= mScale;
+        }
+    }
+    BBox bound() const override
+    {
+        const BBox b = mField->bound();
+        if (b.isEmpty() || b.isInfinite()) {
+            return b;
+        }
+        BBox result;
+        for (int n = 0; n < 8; n++) {
+            const Vector corner((n & 1 ? b.max() : b.min()).X(),
+                                (n & 2 ? b.max() : b.min()).Y(),
+                                (n & 4 ? b.max() : b.min()).Z());
+            const Vector p = mScale * apply(mRotation, corner) +
+                             mTranslation;
+            result = result.unite(BBox(p, p));
+        }
+        return result;
+    }
+    // over the local space box enclosing `box`
+    Interval evalInterval(const BBox& box) const override
+    {
+        if (box.isEmpty() || box.isInfinite()) {
+            return box.isEmpty() ? Interval(0) : Interval::infinite();
+        }
+        BBox local;
+        for (int n = 0; n < 8; n++) {
+            const Vector corner((n & 1 ? box.max() : box.min()).X(),
+                                (n & 2 ? box.max() : box.min()).Y(),
+                                (n & 4 ? box.max() : box.min()).Z());
+            const Vector p = toLocal(corner);
+            local = local.unite(BBox(p, p));
+        }
+        return mField->evalInterval(local) * mScale;
+    }
+    uint64_t hash() const override
+    {
+        uint64_t h = hashCombine(hashString("transform"), mField->hash());
+        for (const Vector& row : mRotation) {
+            h = hashCombine(h, row);
+        }
+        return hashCombine(hashCombine(h, mScale), mTranslation);
+    }
+
+    const VolumeScalar::Ptr& field() const { return mField; }
+    float                    scale() const { return mScale; }
+    const Vector&            translation() const { return mTranslation; }
+
+private:
+    static constexpr Vector kIdentity[3] = {
+        Vector(1, 0, 0), Vector(0, 1, 0), Vector(0, 0, 1)};
+
+    static Vector apply(const Vector rows[3], const Vector& v)
+    {
+        return Vector(rows[0] * v, rows[1] * v, rows[2] * v);
+    }
+
+    Vector toLocal(const Vector& p) const
+    {
+        return apply(mInverse, p - mTranslation);
+    }
+
+    const VolumeScalar::Ptr mField;
+    const Vector            mRotation[3];
+    const float             mScale;
+    const Vector            mTranslation;
+    Vector                  mInverse[3]; // rows of rotation^T / scale
+};
+
+} // namespace ciel
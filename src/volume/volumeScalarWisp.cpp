@@ -0,0 +1,86 @@
+#include "volumeScalarWisp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace ciel {
+
+namespace {
+
+// uniform in [0, 1) from 24 bits of h
+float unitFloat(uint64_t h) { return (float)(h & 0xffffff) * 0x1p-24f; }
+
+} // namespace
+
+void Wisp::generate(size_t              first,
+                    std::span<Particle> out,
+                    float               voxelSize) const
+{
+    // every particle carries an equal share of the ball's voxels
+    const float ballVolume = 4.f / 3.f * std::numbers::pi_v<float> * radius *
+                             radius * radius;
+    const float share = density * ballVolume /
+                        (voxelSize * voxelSize * voxelSize * (float)count);
+
+    // one noise field per displacement axis
+    NoiseParams axisNoise[3] = {noise, noise, noise};
+    for (uint32_t a = 0; a < 3; a++) {
+        axisNoise[a].seed = noise.seed + a * 0x5bd1e995u;
+    }
+
+    const uint64_t wispSeed = hashCombine(hashString("wisp"), (uint64_t)seed);
+    for (size_t i = 0; i < out.size(); i += kPacketWidth) {
+        const size_t n = std::min<size_t>(kPacketWidth, out.size() - i);
+
+        // a point in the unit ball: uniform direction, radius u^clump
+        VectorP ball;
+        for (size_t l = 0; l < kPacketWidth; l++) {
+            const size_t   index = first + i + std::min(l, n - 1);
+            const uint64_t h = hashCombine(wispSeed, (uint64_t)index);
+            const float    z = 1.f - 2.f * unitFloat(h);
+            const float    phi = 2.f * std::numbers::pi_v<float> *
+                                 unitFloat(h >> 24);
+            const float    r = std::pow(unitFloat(h >> 40), clump);
+            const float    s = std::sqrt(std::max(0.f, 1.f - z * z));
+            const Vector   d(s * std::cos(phi), s * std::sin(phi), z);
+            ball.setLane(l, r * d);
+        }
+
+        // displaced by noise, a packet at a time
+        const VectorP offset(fbm(ball, axisNoise[0]),
+                             fbm(ball, axisNoise[1]),
+                             fbm(ball, axisNoise[2]));
+        const VectorP p = (ball + offset * displacement) * radius;
+        for (size_t l = 0; l < n; l++) {
+            out[i + l] = Particle{center + p.lane(l), share};
+        }
+    }
+}
+
+uint64_t Wisp::hash() const
+{
+    uint64_t h = hashCombine(hashCombine(hashString("wisp"), center), radius);
+    h = hashCombine(hashCombine(h, (uint64_t)count), density);
+    h = hashCombine(hashCombine(h, clump), displacement);
+    return hashCombine(hashCombine(h, noise.hash()), (uint64_t)seed);
+}
+
+void VolumeScalarWisp::splat()
+{
+    if (m_grid) {
+        return;
+    }
+    // no narrow band: the background is 0 density, like the voxels that
+    // no particle reached
+    VolumeScalarSparseGrid::Ptr grid = VolumeScalarSparseGrid::create(
+        m_voxelSize, 0.f);
+    splatParticles(*grid,
+                   m_wisp.count,
+                   [this](size_t first, std::span<Particle> out) {
+                       m_wisp.generate(first, out, m_voxelSize);
+                   });
+    m_grid = grid;
+}
+
+} // namespace ciel
@@ -0,0 +1,117 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Wisps: clouds of particles splatted into a density grid.
+//
+//  Particles are scattered in a unit ball, pulled toward
+//  or away from its center by `clump`, pushed around by
+//  fractal noise and then placed at the wisp's center and
+//  radius. Millions of them give the soft, stringy look of
+//  smoke that implicit shapes don't.
+//
+//  Particles are generated on the fly from their index, so
+//  a wisp costs grid memory only, however many there are.
+//
+// -------------------------------------------------------
+
+#include "noise.h"
+#include "particles.h"
+#include "volumeScalarSparseGrid.h"
+
+namespace ciel {
+
+struct Wisp
+{
+    Vector center;
+    float  radius{1};
+    size_t count{1000000}; // particles
+    // Average density inside the wisp's ball, whatever count and voxel
+    // size are: each particle carries an equal share of it
+    float density{1};
+    // Radius of a particle is u^clump of the wisp's radius for uniform u.
+    // 1/3 fills the ball evenly, larger values pack the center.
+    float clump{1.f / 3.f};
+    // Noise displacement of the particles, relative to the radius
+    float       displacement{0.3};
+    NoiseParams noise;
+    uint32_t    seed{0};
+
+    // Particles first, first + 1, ... into `out`, see splatParticles()
+    void generate(size_t first, std::span<Particle> out, float voxelSize) const;
+    // Farthest a particle can get from the center
+    float extent() const { return radius * (1 + displacement * noise.bound()); }
+
+    uint64_t hash() const;
+};
+
+class VolumeScalarWisp : public VolumeScalar
+{
+public:
+    VolumeScalarWisp(const Wisp& tWisp, float tVoxelSize)
+    : m_wisp(tWisp)
+    , m_voxelSize(tVoxelSize)
+    {
+    }
+
+    using Ptr = std::shared_ptr<VolumeScalarWisp>;
+    using ConstPtr = std::shared_ptr<const VolumeScalarWisp>;
+
+    static Ptr create(const Wisp& wisp, float voxelSize)
+    {
+        return std::make_shared<VolumeScalarWisp>(wisp, voxelSize);
+    }
+
+    // Splats the particles into the grid, the first time only. Until then
+    // the wisp is empty. Not thread safe.
+    void splat();
+    bool isSplatted() const { return m_grid != nullptr; }
+
+    // 0 outside the splatted voxels
+    float eval(const Vector& p) const override
+    {
+        return m_grid ? m_grid->eval(p) : 0.f;
+    }
+    FloatP evalPacket(const VectorP& p) const override
+    {
+        return m_grid ? m_grid->evalPacket(p) : FloatP(0.f);
+    }
+    void evalBatch(std::span<const Vector> p,
+                   std::span<float>        out) const override
+    {
+        if (m_grid) {
+            m_grid->evalBatch(p, out);
+        }
+        else {
+            std::fill(out.begin(), out.end(), 0.f);
+        }
+    }
+    // From the parameters, so that it is known before splatting. Particles
+    // reach one voxel further through the splat.
+    BBox bound() const override
+    {
+        return BBox::fromCenter(m_wisp.center,
+                                Vector(m_wisp.extent() + m_voxelSize));
+    }
+    Interval evalInterval(const BBox& box) const override
+    {
+        return m_grid ? m_grid->evalInterval(box) : Interval(0);
+    }
+    uint64_t hash() const override
+    {
+        return hashCombine(hashCombine(hashString("wisp"), m_wisp.hash()),
+                           m_voxelSize);
+    }
+
+    const Wisp& wisp() const { return m_wisp; }
+    float       voxelSize() const { return m_voxelSize; }
+    // nullptr until splat()
+    const VolumeScalarSparseGrid::Ptr& grid() const { return m_grid; }
+
+private:
+    const Wisp                  m_wisp;
+    const float                 m_voxelSize;
+    VolumeScalarSparseGrid::Ptr m_grid;
+};
+
+} // namespace ciel
@@ -0,0 +1,159 @@
+// -------------------------------------------------------
+//
+//  eval(), evalBatch() and evalPacket() agree: the
+//  primitives, CSG over them, its compiled program, a grid
+//  baked from it and nested graphs (transforms over CSG
+//  over transforms, noise over noise) are evaluated all
+//  three ways, in batches shorter than a packet and longer
+//  than the chunks that evalBatch() overrides work in.
+//
+// -------------------------------------------------------
+
+#include "testUtil.h"
+#include "volume/volumeProgram.h"
+#include "volume/volumeScalarBox.h"
+#include "volume/volumeScalarCSG.h"
+#include "volume/volumeScalarEllipse.h"
+#include "volume/volumeScalarGrid.h"
+#include "volume/volumeScalarNoise.h"
+#include "volume/volumeScalarSphere.h"
+#include "volume/volumeScalarTorus.h"
+#include "volume/volumeScalarTransform.h"
+
+#include <cmath>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace ciel;
+
+namespace {
+
+constexpr size_t kBatchSizes[] = {1, 7, 64, 65, 200, 1000};
+constexpr size_t kMaxBatch = 1000; // the longest of kBatchSizes
+
+struct Case
+{
+    std::string       name;
+    VolumeScalar::Ptr volume;
+};
+
+std::vector<Case> makeCases()
+{
+    NoiseParams params;
+    params.frequency = 2;
+    params.octaves = 5;
+    params.seed = 3;
+    NoiseParams detail = params;
+    detail.frequency = 7;
+    detail.seed = 11;
+
+    const VolumeScalar::Ptr a = VolumeScalarBox::create(
+        Vector(0.3, 0, 0), Vector(0.4, 0.3, 0.5), 0.1);
+    const VolumeScalar::Ptr b = VolumeScalarSphere::create(Vector(-0.4, 0, 0),
+                                                           0.5);
+    const VolumeScalar::Ptr torus = VolumeScalarTorus::create(
+        Vector(0, 0.1, 0), Vector(1, 1, 0), 0.6, 0.15);
+    const VolumeScalar::Ptr ellipse = VolumeScalarEllipse::create(
+        Vector(0, 0.2, 0), Vector(1, 0, 0), 0.8, 0.4);
+    const VolumeScalar::Ptr csg = std::make_shared<VolumeScalarIntersection>(
+        std::make_shared<VolumeScalarShell>(
+            std::make_shared<VolumeScalarCutout>(
+                std::make_shared<VolumeScalarUnion>(a, b), torus),
+            0.2),
+        ellipse);
+    // translate(union(rotate(a), b))
+    const VolumeScalar::Ptr nested = VolumeScalarTransform::createTranslation(
+        std::make_shared<VolumeScalarUnion>(
+            VolumeScalarTransform::createRotation(a, Vector(0, 1, 1), 40), b),
+        Vector(0.1, -0.2, 0.3));
+
+    return {
+        {"box", a},
+        {"sphere", b},
+        {"torus", torus},
+        {"ellipse", ellipse},
+        {"csg", csg},
+        {"program", VolumeScalarProgram::create(csg)},
+        {"grid", VolumeScalarGrid::bake(csg, BBox(Vector(-1), Vector(1)), 40)},
+        {"fbm(fbm)",
+         VolumeScalarNoise::createFBm(
+             VolumeScalarNoise::createFBm(b, 0.3, params), 0.1, detail)},
+        {"pyroclastic(union(fbm, a))",
+         VolumeScalarNoise::createPyroclastic(
+             std::make_shared<VolumeScalarUnion>(
+                 VolumeScalarNoise::createFBm(b, 0.3, params), a),
+             0.2,
+             detail)},
+        {"translate(union(rotate(a), b))", nested},
+        {"program(scale(nested))",
+         VolumeScalarProgram::create(
+             VolumeScalarTransform::createScale(nested, 1.5))},
+        {"pyroclastic(rotate(fbm))",
+         VolumeScalarNoise::createPyroclastic(
+             VolumeScalarTransform::createRotation(
+                 VolumeScalarNoise::createFBm(nested, 0.2, params),
+                 Vector(1, 0, 1),
+                 25),
+             0.2,
+             detail)},
+    };
+}
+
+// equal up to the rounding of the SIMD arithmetic
+bool close(float a, float b)
+{
+    return std::abs(a - b) <= 1e-4f * (1 + std::abs(a));
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937                          random(2);
+    std::uniform_real_distribution<float> position(-1.5f, 1.5f);
+    std::vector<Vector>                   points(kMaxBatch);
+    for (Vector& p : points) {
+        p = Vector(position(random), position(random), position(random));
+    }
+
+    for (const Case& c : makeCases()) {
+        std::vector<float> reference(points.size());
+        for (size_t i = 0; i < points.size(); i++) {
+            reference[i] = c.volume->eval(points[i]);
+        }
+
+        for (size_t count : kBatchSizes) {
+            std::vector<float> batch(count);
+            c.volume->evalBatch(std::span<const Vector>(points.data(), count),
+                                batch);
+            size_t mismatches = 0;
+            for (size_t i = 0; i < count; i++) {
+                mismatches += !close(reference[i], batch[i]);
+            }
+            if (!CIEL_CHECK(mismatches == 0)) {
+                std::cerr << "    " << c.name << ": evalBatch() of " << count
+                          << " points, " << mismatches << " mismatches\n";
+            }
+        }
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i + kPacketWidth <= points.size();
+             i += kPacketWidth) {
+            VectorP packet;
+            for (size_t l = 0; l < kPacketWidth; l++) {
+                packet.setLane(l, points[i + l]);
+            }
+            const FloatP values = c.volume->evalPacket(packet);
+            for (size_t l = 0; l < kPacketWidth; l++) {
+                mismatches += !close(reference[i + l], values[l]);
+            }
+        }
+        if (!CIEL_CHECK(mismatches == 0)) {
+            std::cerr << "    " << c.name << ": evalPacket(), " << mismatches
+                      << " mismatches\n";
+        }
+    }
+    return test::result();
+}
@@ -0,0 +1,123 @@
+// -------------------------------------------------------
+//
+//  evalInterval() encloses eval(): random boxes of every
+//  scalar volume are sampled, corners included, and each
+//  sample has to lie inside the interval of its box.
+//
+// -------------------------------------------------------
+
+#include "testUtil.h"
+#include "volume/volumeProgram.h"
+#include "volume/volumeScalarBox.h"
+#include "volume/volumeScalarCSG.h"
+#include "volume/volumeScalarEllipse.h"
+#include "volume/volumeScalarGrid.h"
+#include "volume/volumeScalarNoise.h"
+#include "volume/volumeScalarSparseGrid.h"
+#include "volume/volumeScalarSphere.h"
+#include "volume/volumeScalarTorus.h"
+#include "volume/volumeScalarTransform.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ciel;
+
+namespace {
+
+constexpr int kBoxes = 200;  // per volume
+constexpr int kSamples = 64; // per box, besides the corners
+
+struct Case
+{
+    std::string       name;
+    VolumeScalar::Ptr volume;
+};
+
+std::vector<Case> makeCases()
+{
+    NoiseParams params;
+    params.frequency = 3;
+    params.octaves = 4;
+    params.seed = 5;
+
+    const VolumeScalar::Ptr sphere = VolumeScalarSphere::create(
+        Vector(-0.3, 0, 0), 0.6);
+    const VolumeScalar::Ptr box = VolumeScalarBox::create(
+        Vector(0.4, 0.1, 0), Vector(0.4, 0.3, 0.5), 0.1);
+    const VolumeScalar::Ptr torus = VolumeScalarTorus::create(
+        Vector(0, 0, 0.2), Vector(0, 1, 1), 0.6, 0.2);
+    const VolumeScalar::Ptr ellipse = VolumeScalarEllipse::create(
+        Vector(0, 0.2, 0), Vector(1, 0, 0), 0.8, 0.4);
+    const VolumeScalar::Ptr shape = std::make_shared<VolumeScalarUnion>(
+        sphere, std::make_shared<VolumeScalarCutout>(box, torus));
+    const VolumeScalar::Ptr csg = std::make_shared<VolumeScalarIntersection>(
+        std::make_shared<VolumeScalarShell>(shape, 0.2), ellipse);
+
+    return {
+        {"sphere", sphere},
+        {"box", box},
+        {"torus", torus},
+        {"ellipse", ellipse},
+        {"csg", csg},
+        {"program", VolumeScalarProgram::create(csg)},
+        {"transform",
+         VolumeScalarTransform::createTranslation(
+             VolumeScalarTransform::createScale(
+                 std::make_shared<VolumeScalarUnion>(
+                     VolumeScalarTransform::createRotation(
+                         box, Vector(1, 1, 0), 30),
+                     torus),
+                 1.5),
+             Vector(0.2, -0.1, 0.3))},
+        {"fbm", VolumeScalarNoise::createFBm(sphere, 0.3, params)},
+        {"pyroclastic",
+         VolumeScalarNoise::createPyroclastic(shape, 0.2, params)},
+        {"grid", VolumeScalarGrid::bake(shape, 48)},
+        {"sparseGrid", VolumeScalarSparseGrid::bake(sphere, 0.04)},
+    };
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937                          random(1);
+    std::uniform_real_distribution<float> position(-1.5f, 1.5f);
+    std::uniform_real_distribution<float> size(0.001f, 1.f);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    for (const Case& c : makeCases()) {
+        int outside = 0;
+        for (int b = 0; b < kBoxes; b++) {
+            const Vector lo(position(random), position(random),
+                            position(random));
+            const BBox     box(lo, lo + Vector(size(random), size(random),
+                                               size(random)));
+            const Interval range = c.volume->evalInterval(box);
+            for (int s = 0; s < kSamples + 8; s++) {
+                Vector t;
+                for (int k = 0; k < 3; k++) {
+                    // the corners first
+                    t[k] = s < 8 ? (float)((s >> k) & 1) : unit(random);
+                }
+                const Vector p(lo.X() + t.X() * (box.max().X() - lo.X()),
+                               lo.Y() + t.Y() * (box.max().Y() - lo.Y()),
+                               lo.Z() + t.Z() * (box.max().Z() - lo.Z()));
+                const float value = c.volume->eval(p);
+                // rounding of the eval() arithmetic
+                const float slack = 1e-4f * (1 + std::abs(value));
+                if (!(range.lo - slack <= value && value <= range.hi + slack)) {
+                    outside++;
+                }
+            }
+        }
+        if (!CIEL_CHECK(outside == 0)) {
+            std::cerr << "    " << c.name << ": " << outside
+                      << " samples outside their interval\n";
+        }
+    }
+    return test::result();
+}
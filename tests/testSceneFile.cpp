@@ -0,0 +1,111 @@
+// -------------------------------------------------------
+//
+//  SceneFile::parse(): the errors point at the offending
+//  token, and identical subgraphs become one node.
+//
+// -------------------------------------------------------
+
+#include "sceneFile.h"
+#include "testUtil.h"
+
+#include <string>
+#include <string_view>
+
+using namespace ciel;
+
+namespace {
+
+// Parses `text`, which has to fail at line:column with a message containing
+// `message`
+void checkError(std::string_view text,
+                size_t           line,
+                size_t           column,
+                std::string_view message)
+{
+    try {
+        SceneFile::parse(text, "t.ciel");
+        CIEL_CHECK(!"parsed a scene with an error");
+        std::cerr << "    " << text << '\n';
+    }
+    catch (const SceneFileError& e) {
+        const std::string what = e.what();
+        if (!CIEL_CHECK(e.line() == line && e.column() == column &&
+                        what.find(message) != std::string::npos)) {
+            std::cerr << "    got '" << what << "', expected " << line << ":"
+                      << column << " '" << message << "'\n";
+        }
+    }
+}
+
+size_t nodeCount(std::string_view text)
+{
+    return SceneFile::parse(text)->nodeCount;
+}
+
+} // namespace
+
+int main()
+{
+    // errors
+    checkError("a = sphere 0 0 0", 1, 17, "expected a radius");
+    checkError("a = sphere 0 0 x 1", 1, 16, "found 'x'");
+    checkError("a = sphere 0 0 0 1\nb = scale a 0", 2, 13, "must be positive");
+    checkError("a = sphere 0 0 0 1 2", 1, 20, "unexpected '2'");
+    checkError("a = cube 0 0 0 1", 1, 5, "unknown volume type 'cube'");
+    checkError(
+        "a = sphere 0 0 0 1\nb = union a c", 2, 13, "unknown volume 'c'");
+    checkError("a = sphere 0 0 0 1\na = sphere 0 0 0 2", 2, 1, "redefined");
+    checkError("a = sphere 0 0 0 1\n\nb = fbm a 0.1 2 2.5", 3, 17,
+               "expected an octave count, found '2.5'");
+    checkError("a = sphere 0 0 0 1\nb = fbm a 0.1 2 4 99999999999", 2, 19,
+               "a seed is too large");
+    checkError("a = sphere 0 0 0 1\nb = rotate a 0 0 0 45", 2, 14,
+               "zero rotation axis");
+    checkError("volume a", 1, 8, "unknown volume 'a'");
+    checkError("set rayDt -1", 1, 11, "negative value");
+    checkError("set nothing 1", 1, 5, "unknown setting 'nothing'");
+    checkError("  frobnicate", 1, 3, "unknown statement 'frobnicate'");
+
+    // a scene, with its settings applied
+    RenderSetting        settings;
+    const SceneFile::Ptr scene = SceneFile::parse(
+        "# comment\n"
+        "left  = sphere -0.5 0 0 0.5 # trailing comment\n"
+        "right = sphere  0.5 0 0 0.5\n"
+        "volume left 1 0 0\n"
+        "volume right\n"
+        "light point 0 -3 -2 1 1 1 0.5\n"
+        "set rayDt 0.02\n",
+        "<scene>",
+        &settings);
+    CIEL_CHECK(scene->volumes.size() == 2);
+    CIEL_CHECK(scene->colors.size() == 2);
+    CIEL_CHECK(scene->lights.size() == 1);
+    CIEL_CHECK(!scene->camera);
+    CIEL_CHECK(scene->nodeCount == 2);
+    CIEL_CHECK(settings.rayDt == 0.02f);
+
+    // deduplication: a subgraph written out twice, or named twice, is one
+    // node, and so is the volume rendered from either name
+    CIEL_CHECK(nodeCount("a = sphere 0 0 0 1\n"
+                         "b = sphere 0 0 0 1\n") == 1);
+    CIEL_CHECK(nodeCount("a = sphere 0 0 0 1\n"
+                         "b = sphere 0 0 0 2\n") == 2);
+    CIEL_CHECK(nodeCount("a = sphere 0 0 0 1\n"
+                         "b = translate a 1 0 0\n"
+                         "c = union b a\n"
+                         "d = sphere 0 0 0 1\n"
+                         "e = translate d 1 0 0\n"
+                         "f = union e d\n") == 3);
+    CIEL_CHECK(nodeCount("a = sphere 0 0 0 1\n"
+                         "n = fbm a 0.1 2 3 7\n"
+                         "m = fbm a 0.1 2 3 8\n") == 3);
+    const SceneFile::Ptr shared = SceneFile::parse("a = box 0 0 0 1 1 1 0.1\n"
+                                                   "b = box 0 0 0 1 1 1 0.1\n"
+                                                   "volume a\n"
+                                                   "volume b\n");
+    CIEL_CHECK(shared->volumes.size() == 2 &&
+               shared->volumes[0] == shared->volumes[1]);
+
+    return test::result();
+}
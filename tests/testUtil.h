@@ -0,0 +1,44 @@
+#pragma once
+
+// -------------------------------------------------------
+//
+//  Minimal helpers for the tests: CIEL_CHECK() reports a
+//  failed condition and carries on, main() returns
+//  ciel::test::result() so that ctest sees the failures.
+//
+// -------------------------------------------------------
+
+#include <cstdlib>
+#include <iostream>
+
+namespace ciel::test {
+
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline bool check(bool ok, const char* what, const char* file, int line)
+{
+    if (!ok) {
+        std::cerr << file << ":" << line << ": check failed: " << what
+                  << '\n';
+        failures()++;
+    }
+    return ok;
+}
+
+inline int result()
+{
+    if (failures() > 0) {
+        std::cerr << "[ciel][test] " << failures() << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace ciel::test
+
+#define CIEL_CHECK(condition)                                                  \
+    ciel::test::check((condition), #condition, __FILE__, __LINE__)